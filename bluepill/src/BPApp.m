@@ -10,10 +10,44 @@
 #import "BPApp.h"
 #import "bp/src/BPConstants.h"
 #import "bp/src/BPConfiguration.h"
+#import "bp/src/BPStats.h"
 #import "bp/src/BPUtils.h"
 
 @implementation BPApp
 
+/*!
+ @discussion Load one test bundle per key concurrently. dispatch_apply on a global queue keeps the
+ number of bundles being scanned at once bounded by the number of cores. Every load runs to
+ completion even if another one fails, and each is timed in BPStats next to the "Loading App" timer.
+ @param keys The bundle paths or names to load, in the order the results should be returned.
+ @param loader Loads the bundle for a key, returning nil and setting the error on failure.
+ @return One entry per key, in the same order: the loaded BPXCTestFile or the NSError it failed with.
+ */
++ (NSArray *)loadTestFilesForKeys:(NSArray<NSString *> *)keys
+                        withBlock:(BPXCTestFile *(^)(NSString *key, NSError **error))loader {
+    NSMutableArray *results = [[NSMutableArray alloc] initWithCapacity:keys.count];
+    for (NSUInteger i = 0; i < keys.count; i++) {
+        [results addObject:[NSNull null]];
+    }
+    dispatch_apply(keys.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+        @autoreleasepool {
+            NSString *key = keys[i];
+            NSString *timerName = LOAD_TEST_BUNDLE([key lastPathComponent]);
+            [[BPStats sharedStats] startTimer:timerName];
+            NSError *error;
+            id result = loader(key, &error);
+            [[BPStats sharedStats] endTimer:timerName withResult:result ? @"INFO" : @"ERROR"];
+            if (!result) {
+                result = error ?: [BPUtils BPError:__func__ andLine:__LINE__ withFormat:@"Could not load test bundle %@", key];
+            }
+            @synchronized (results) {
+                results[i] = result;
+            }
+        }
+    });
+    return results;
+}
+
 + (NSArray<BPXCTestFile *>*)testsFromAppBundle:(NSString *)appBundlePath
                              andTestBundlePath:(NSString *)testBundlePath
                             andUITargetAppPath:(NSString *)UITargetAppPath
@@ -46,19 +80,29 @@
     if (!allFiles && *errPtr) {
         return nil;
     };
-    NSMutableArray<BPXCTestFile *> *xcTestFiles = [[NSMutableArray alloc] init];
+    NSMutableArray<NSString *> *testBundlePaths = [[NSMutableArray alloc] init];
     for (NSString *filename in allFiles) {
         NSString *extension = [[filename pathExtension] lowercaseString];
         if ([extension isEqualToString:@"xctest"]) {
-            NSString *testBundlePath = [dirPath stringByAppendingPathComponent:filename];
-            BPXCTestFile *xcTestFile = [BPXCTestFile BPXCTestFileFromXCTestBundle:testBundlePath
-                                                                 andHostAppBundle:appBundlePath
-                                                               andUITargetAppPath:UITargetAppPath
-                                                                        withError:errPtr];
-            if (!xcTestFile) return nil;
-            [xcTestFiles addObject:xcTestFile];
+            [testBundlePaths addObject:[dirPath stringByAppendingPathComponent:filename]];
         }
     }
+    NSArray *results = [BPApp loadTestFilesForKeys:testBundlePaths withBlock:^BPXCTestFile *(NSString *testBundlePath, NSError **error) {
+        return [BPXCTestFile BPXCTestFileFromXCTestBundle:testBundlePath
+                                         andHostAppBundle:appBundlePath
+                                       andUITargetAppPath:UITargetAppPath
+                                                withError:error];
+    }];
+    NSMutableArray<BPXCTestFile *> *xcTestFiles = [[NSMutableArray alloc] init];
+    for (id result in results) {
+        if ([result isKindOfClass:[NSError class]]) {
+            if (errPtr) {
+                *errPtr = result;
+            }
+            return nil;
+        }
+        [xcTestFiles addObject:result];
+    }
     return xcTestFiles;
 }
 
@@ -71,21 +115,28 @@
     NSUInteger errorCount = 0;
     // We are reading an XCTestRun file's dictionary and returning an Array so we sort
     // the keys to produce a deterministic list. This helps make bluepill runs reproducible.
+    NSMutableArray<NSString *> *keys = [[NSMutableArray alloc] init];
     for (NSString *key in [xcTestRunDict.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
         if ([key isEqualToString:@"__xctestrun_metadata__"]) {
             // Xcode 10.1 introduced this in the xctestrun file format.
             continue;
         }
-        BPXCTestFile *xcTestFile = [BPXCTestFile BPXCTestFileFromDictionary:[xcTestRunDict objectForKey:key]
-                                                               withTestRoot:[xcTestRunPath stringByDeletingLastPathComponent]
-                                                               andXcodePath:xcodePath
-                                                                   andError:errPtr];
-        if (!xcTestFile) {
-            [BPUtils printInfo:ERROR withString:@"Failed to read data for %@", key];
+        [keys addObject:key];
+    }
+    NSString *testRoot = [xcTestRunPath stringByDeletingLastPathComponent];
+    NSArray *results = [BPApp loadTestFilesForKeys:keys withBlock:^BPXCTestFile *(NSString *key, NSError **error) {
+        return [BPXCTestFile BPXCTestFileFromDictionary:[xcTestRunDict objectForKey:key]
+                                           withTestRoot:testRoot
+                                           andXcodePath:xcodePath
+                                               andError:error];
+    }];
+    for (NSUInteger i = 0; i < keys.count; i++) {
+        if ([results[i] isKindOfClass:[NSError class]]) {
+            [BPUtils printInfo:ERROR withString:@"Failed to read data for %@: %@", keys[i], [results[i] localizedDescription]];
             errorCount++;
             continue;
         }
-        [allXCTestFiles addObject:xcTestFile];
+        [allXCTestFiles addObject:results[i]];
     }
     if (errorCount) {
         BP_SET_ERROR(errPtr, @"Failed to load some test bundles");
@@ -103,12 +154,18 @@
     if (config.tests != nil && config.tests.count != 0) {
         [BPUtils printInfo:INFO withString:@"Using test bundles"];
         NSMutableArray<BPXCTestFile *> *loadedTests = [[NSMutableArray alloc] initWithCapacity:config.tests.count];
-        for (NSString *testName in config.tests) {
+        NSArray *results = [BPApp loadTestFilesForKeys:config.tests.allKeys withBlock:^BPXCTestFile *(NSString *testName, NSError **error) {
             BPTestPlan *testPlan = [config.tests objectForKey:testName];
-            BPXCTestFile *xcTestFile = [BPXCTestFile BPXCTestFileFromBPTestPlan:testPlan withName:testName andError:errPtr];
-            if (*errPtr)
+            return [BPXCTestFile BPXCTestFileFromBPTestPlan:testPlan withName:testName andError:error];
+        }];
+        for (id result in results) {
+            if ([result isKindOfClass:[NSError class]]) {
+                if (errPtr) {
+                    *errPtr = result;
+                }
                 return nil;
-            [loadedTests addObject:xcTestFile];
+            }
+            [loadedTests addObject:result];
         }
 
         app.testBundles = loadedTests;
@@ -0,0 +1,66 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/*!
+ The results of one JUnit report, streamed through an event parser and ready to be merged.
+ Reports are independent of each other, so they can be parsed concurrently.
+ */
+@interface BPJUnitReport : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *url;
+// Set if the report couldn't be read completely. The test cases read before the error are still merged.
+@property (nonatomic, strong, readonly) NSError *error;
+// Number of testcase elements in the report, retries included.
+@property (nonatomic, assign, readonly) NSUInteger numTestCases;
+
+/*!
+ @discussion Parse a JUnit report. Safe to call from any thread.
+ @param url The report to parse.
+ @return The report, with error set if it couldn't be parsed.
+ */
++ (instancetype)reportWithContentsOfURL:(NSURL *)url;
+
+@end
+
+/*!
+ Merges JUnit reports into one.
+
+ Test suites are matched by name at the same level and test cases by (classname, name) through
+ hash maps, so merging is linear in the size of the reports. Later results of a test case go right
+ after its earlier ones, so merge the reports oldest first. The counts of every test suite are
+ recomputed when the merged report is written.
+ */
+@interface BPJUnitMerger : NSObject
+
+// Number of testcase elements merged so far, retries included.
+@property (nonatomic, assign, readonly) NSUInteger numTestCases;
+
+/*!
+ @discussion Create an empty merger.
+ @param name The name of the root testsuites element of the merged report.
+ */
+- (instancetype)initWithName:(NSString *)name;
+
+/*!
+ @discussion Merge a parsed report. Its results are moved, not copied, so a report can only be merged once.
+ @param report The report to merge.
+ */
+- (void)mergeReport:(BPJUnitReport *)report;
+
+/*!
+ @discussion Write the merged report in a single pass.
+ @param path Where to write the report. It's replaced atomically.
+ @param errPtr Set if the report can't be written.
+ @return YES on success.
+ */
+- (BOOL)writeToFile:(NSString *)path withError:(NSError **)errPtr;
+
+@end
@@ -0,0 +1,490 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPJUnitMerger.h"
+#import <sys/stat.h>
+#import "bp/src/BPUtils.h"
+
+// Flush the output to disk in chunks of this many characters.
+static const NSUInteger kOutputBufferSize = 64 * 1024;
+
+// NSXMLParser doesn't keep the attribute order: write the attributes JUnitReporter writes in its
+// order, followed by any others by name.
+static NSArray<NSString *> *orderedAttributeNames(NSString *elementName, NSDictionary<NSString *, NSString *> *attributes) {
+    static NSDictionary<NSString *, NSArray<NSString *> *> *knownOrders;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        knownOrders = @{
+            @"testsuites": @[@"name", @"tests", @"failures", @"errors", @"time"],
+            @"testsuite": @[@"tests", @"failures", @"errors", @"time", @"timestamp", @"name"],
+            @"testcase": @[@"classname", @"name", @"time"],
+            @"failure": @[@"type", @"message"],
+            @"error": @[@"type", @"message"],
+        };
+    });
+    NSArray<NSString *> *knownOrder = knownOrders[elementName] ?: @[];
+    NSMutableArray<NSString *> *names = [[NSMutableArray alloc] initWithCapacity:attributes.count];
+    for (NSString *name in knownOrder) {
+        if (attributes[name]) {
+            [names addObject:name];
+        }
+    }
+    for (NSString *name in [[attributes allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        if (![knownOrder containsObject:name]) {
+            [names addObject:name];
+        }
+    }
+    return names;
+}
+
+// An element of a report other than a test suite, e.g. a testcase and everything in it.
+@interface BPJUnitElement : NSObject
+@property (nonatomic, strong) NSString *name;
+@property (nonatomic, strong) NSDictionary<NSString *, NSString *> *attributes;
+@property (nonatomic, strong) NSArray<NSString *> *attributeNames;
+@property (nonatomic, strong) NSMutableArray<BPJUnitElement *> *children;
+@property (nonatomic, strong) NSMutableString *text;
+@end
+
+@implementation BPJUnitElement
+
+- (instancetype)initWithName:(NSString *)name attributes:(NSDictionary<NSString *, NSString *> *)attributes {
+    self = [super init];
+    if (self) {
+        self.name = name;
+        self.attributes = attributes;
+        self.attributeNames = orderedAttributeNames(name, attributes);
+        self.children = [[NSMutableArray alloc] init];
+        self.text = [[NSMutableString alloc] init];
+    }
+    return self;
+}
+
+- (BOOL)hasChildNamed:(NSString *)name {
+    for (BPJUnitElement *child in self.children) {
+        if ([child.name isEqualToString:name]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@end
+
+// A test suite (or the root testsuites element) with its children indexed by name.
+@interface BPJUnitSuite : NSObject
+@property (nonatomic, strong) NSString *elementName;
+@property (nonatomic, strong) NSMutableArray<NSString *> *attributeNames;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSString *> *attributes;
+// Child suites, groups of results of the same test case (NSMutableArray) and other elements, in order.
+@property (nonatomic, strong) NSMutableArray *children;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, BPJUnitSuite *> *suitesByName;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray<BPJUnitElement *> *> *testCasesByKey;
+@property (nonatomic, assign) NSUInteger tests;
+@property (nonatomic, assign) NSUInteger failures;
+@property (nonatomic, assign) NSUInteger errors;
+@property (nonatomic, assign) double time;
+@end
+
+@implementation BPJUnitSuite
+
+- (instancetype)initWithElementName:(NSString *)elementName {
+    self = [super init];
+    if (self) {
+        self.elementName = elementName;
+        self.attributeNames = [[NSMutableArray alloc] init];
+        self.attributes = [[NSMutableDictionary alloc] init];
+        self.children = [[NSMutableArray alloc] init];
+        self.suitesByName = [[NSMutableDictionary alloc] init];
+        self.testCasesByKey = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)setAttribute:(NSString *)name toValue:(NSString *)value {
+    if (!self.attributes[name]) {
+        [self.attributeNames addObject:name];
+    }
+    self.attributes[name] = value;
+}
+
+- (void)addResult:(BPJUnitElement *)testCase {
+    NSString *key = [NSString stringWithFormat:@"%@\n%@", testCase.attributes[@"classname"] ?: @"", testCase.attributes[@"name"] ?: @""];
+    NSMutableArray<BPJUnitElement *> *results = self.testCasesByKey[key];
+    if (!results) {
+        results = [[NSMutableArray alloc] init];
+        self.testCasesByKey[key] = results;
+        [self.children addObject:results];
+    }
+    [results addObject:testCase];
+}
+
+// Move the contents of a suite of another report into this one and return the number of test case
+// results moved. Suites new to this one are taken whole; of the suites both have, only the test cases are.
+- (NSUInteger)mergeSuite:(BPJUnitSuite *)other {
+    NSUInteger numTestCases = 0;
+    for (id child in other.children) {
+        if ([child isKindOfClass:[BPJUnitSuite class]]) {
+            BPJUnitSuite *otherSuite = child;
+            NSString *name = otherSuite.attributes[@"name"] ?: @"";
+            BPJUnitSuite *suite = self.suitesByName[name];
+            if (suite) {
+                numTestCases += [suite mergeSuite:otherSuite];
+            } else {
+                self.suitesByName[name] = otherSuite;
+                [self.children addObject:otherSuite];
+                numTestCases += [otherSuite numTestCases];
+            }
+        } else if ([child isKindOfClass:[NSArray class]]) {
+            for (BPJUnitElement *testCase in (NSArray<BPJUnitElement *> *)child) {
+                [self addResult:testCase];
+                numTestCases++;
+            }
+        }
+    }
+    return numTestCases;
+}
+
+- (NSUInteger)numTestCases {
+    NSUInteger numTestCases = 0;
+    for (id child in self.children) {
+        if ([child isKindOfClass:[BPJUnitSuite class]]) {
+            numTestCases += [(BPJUnitSuite *)child numTestCases];
+        } else if ([child isKindOfClass:[NSArray class]]) {
+            numTestCases += [(NSArray *)child count];
+        }
+    }
+    return numTestCases;
+}
+
+// Recompute the counts bottom up: a suite counts its own test cases, retries included, plus its child suites.
+- (void)updateCounts {
+    self.tests = 0;
+    self.failures = 0;
+    self.errors = 0;
+    self.time = 0.0;
+    for (id child in self.children) {
+        if ([child isKindOfClass:[BPJUnitSuite class]]) {
+            BPJUnitSuite *suite = child;
+            [suite updateCounts];
+            self.tests += suite.tests;
+            self.failures += suite.failures;
+            self.errors += suite.errors;
+            self.time += suite.time;
+        } else if ([child isKindOfClass:[NSArray class]]) {
+            for (BPJUnitElement *testCase in (NSArray<BPJUnitElement *> *)child) {
+                self.tests++;
+                self.failures += [testCase hasChildNamed:@"failure"] ? 1 : 0;
+                self.errors += [testCase hasChildNamed:@"error"] ? 1 : 0;
+                self.time += [testCase.attributes[@"time"] doubleValue];
+            }
+        }
+    }
+    [self setAttribute:@"tests" toValue:[NSString stringWithFormat:@"%lu", (unsigned long)self.tests]];
+    [self setAttribute:@"failures" toValue:[NSString stringWithFormat:@"%lu", (unsigned long)self.failures]];
+    [self setAttribute:@"errors" toValue:[NSString stringWithFormat:@"%lu", (unsigned long)self.errors]];
+    [self setAttribute:@"time" toValue:[NSString stringWithFormat:@"%f", self.time]];
+}
+
+@end
+
+@interface BPJUnitReport () <NSXMLParserDelegate>
+@property (nonatomic, strong, readwrite) NSURL *url;
+@property (nonatomic, strong, readwrite) NSError *error;
+@property (nonatomic, assign, readwrite) NSUInteger numTestCases;
+@property (nonatomic, strong) BPJUnitSuite *root;
+// Parser state.
+@property (nonatomic, strong) NSMutableArray<BPJUnitSuite *> *suiteStack;
+@property (nonatomic, strong) NSMutableArray<BPJUnitElement *> *elementStack;
+@property (nonatomic, assign) NSUInteger ignoredDepth;
+@end
+
+@implementation BPJUnitReport
+
++ (instancetype)reportWithContentsOfURL:(NSURL *)url {
+    BPJUnitReport *report = [[self alloc] init];
+    report.url = url;
+    report.root = [[BPJUnitSuite alloc] initWithElementName:@"testsuites"];
+    NSError *error;
+    [report parseWithError:&error];
+    report.error = error;
+    return report;
+}
+
+- (BOOL)parseWithError:(NSError **)errPtr {
+    NSInputStream *input = [NSInputStream inputStreamWithURL:self.url];
+    if (!input) {
+        BP_SET_ERROR(errPtr, @"Could not open %@", [self.url path]);
+        return NO;
+    }
+    self.suiteStack = [[NSMutableArray alloc] init];
+    self.elementStack = [[NSMutableArray alloc] init];
+    self.ignoredDepth = 0;
+
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithStream:input];
+    parser.delegate = self;
+    BOOL success = [parser parse];
+    if (!success) {
+        BP_SET_ERROR(errPtr, @"%@", [parser.parserError localizedDescription] ?: @"Unknown parse error");
+    }
+    self.suiteStack = nil;
+    self.elementStack = nil;
+    return success;
+}
+
+- (void)parser:(NSXMLParser *)parser
+didStartElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qName
+    attributes:(NSDictionary<NSString *, NSString *> *)attributeDict {
+    if (self.ignoredDepth > 0) {
+        self.ignoredDepth++;
+        return;
+    }
+    BPJUnitElement *parentElement = [self.elementStack lastObject];
+    if (parentElement) {
+        BPJUnitElement *element = [[BPJUnitElement alloc] initWithName:elementName attributes:attributeDict];
+        [parentElement.children addObject:element];
+        [self.elementStack addObject:element];
+        return;
+    }
+    BPJUnitSuite *parentSuite = [self.suiteStack lastObject];
+    if (!parentSuite) {
+        if ([elementName isEqualToString:@"testsuites"]) {
+            [self.suiteStack addObject:self.root];
+        } else {
+            self.ignoredDepth = 1;
+        }
+        return;
+    }
+    if ([elementName isEqualToString:@"testsuite"]) {
+        NSString *name = attributeDict[@"name"] ?: @"";
+        BPJUnitSuite *suite = parentSuite.suitesByName[name];
+        if (!suite) {
+            suite = [[BPJUnitSuite alloc] initWithElementName:elementName];
+            for (NSString *attribute in orderedAttributeNames(elementName, attributeDict)) {
+                [suite setAttribute:attribute toValue:attributeDict[attribute]];
+            }
+            parentSuite.suitesByName[name] = suite;
+            [parentSuite.children addObject:suite];
+        }
+        [self.suiteStack addObject:suite];
+    } else if (parentSuite != self.root) {
+        [self.elementStack addObject:[[BPJUnitElement alloc] initWithName:elementName attributes:attributeDict]];
+    } else {
+        self.ignoredDepth = 1;
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string {
+    [[self.elementStack lastObject].text appendString:string];
+}
+
+- (void)parser:(NSXMLParser *)parser foundCDATA:(NSData *)CDATABlock {
+    NSString *string = [[NSString alloc] initWithData:CDATABlock encoding:NSUTF8StringEncoding];
+    if (string) {
+        [[self.elementStack lastObject].text appendString:string];
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser
+ didEndElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qName {
+    if (self.ignoredDepth > 0) {
+        self.ignoredDepth--;
+        return;
+    }
+    BPJUnitElement *element = [self.elementStack lastObject];
+    if (!element) {
+        [self.suiteStack removeLastObject];
+        return;
+    }
+    [self.elementStack removeLastObject];
+    // Text is kept verbatim, except for the indentation between the children of an element.
+    if (element.children.count > 0
+        && [element.text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]].length == 0) {
+        [element.text setString:@""];
+    }
+    if (self.elementStack.count > 0) {
+        return;
+    }
+    // A complete child of a test suite.
+    BPJUnitSuite *suite = [self.suiteStack lastObject];
+    if ([element.name isEqualToString:@"testcase"]) {
+        [suite addResult:element];
+        self.numTestCases++;
+    } else {
+        [suite.children addObject:element];
+    }
+}
+
+@end
+
+@interface BPJUnitMerger ()
+@property (nonatomic, strong) BPJUnitSuite *root;
+@property (nonatomic, assign, readwrite) NSUInteger numTestCases;
+// Writer state.
+@property (nonatomic, strong) NSOutputStream *output;
+@property (nonatomic, strong) NSMutableString *buffer;
+@property (nonatomic, strong) NSError *writeError;
+@end
+
+@implementation BPJUnitMerger
+
+- (instancetype)initWithName:(NSString *)name {
+    self = [super init];
+    if (self) {
+        self.root = [[BPJUnitSuite alloc] initWithElementName:@"testsuites"];
+        [self.root setAttribute:@"name" toValue:name];
+    }
+    return self;
+}
+
+#pragma mark - Merging
+
+- (void)mergeReport:(BPJUnitReport *)report {
+    self.numTestCases += [self.root mergeSuite:report.root];
+    // The report's suites may now be part of the merged ones, it can't be merged again.
+    report.root = [[BPJUnitSuite alloc] initWithElementName:@"testsuites"];
+}
+
+#pragma mark - Writing
+
+- (BOOL)writeToFile:(NSString *)path withError:(NSError **)errPtr {
+    [self.root updateCounts];
+    NSString *tmpPath = [BPUtils mkstemp:path withError:errPtr];
+    if (!tmpPath) {
+        return NO;
+    }
+    self.output = [NSOutputStream outputStreamToFileAtPath:tmpPath append:NO];
+    [self.output open];
+    self.buffer = [[NSMutableString alloc] init];
+    self.writeError = nil;
+
+    [self write:@"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"];
+    [self writeSuite:self.root atDepth:0];
+    [self flush];
+    [self.output close];
+    self.output = nil;
+    self.buffer = nil;
+
+    if (self.writeError) {
+        BP_SET_ERROR(errPtr, @"Could not write %@: %@", path, [self.writeError localizedDescription]);
+        [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+        return NO;
+    }
+    // mkstemp creates the file readable by its owner only.
+    if (chmod([tmpPath fileSystemRepresentation], 0644) != 0
+        || rename([tmpPath fileSystemRepresentation], [path fileSystemRepresentation]) != 0) {
+        BP_SET_ERROR(errPtr, @"Could not write %@: %s", path, strerror(errno));
+        [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+        return NO;
+    }
+    return YES;
+}
+
+// Same layout as -[NSXMLDocument XMLDataWithOptions:NSXMLNodePrettyPrint].
+- (void)writeSuite:(BPJUnitSuite *)suite atDepth:(NSUInteger)depth {
+    [self writeIndent:depth];
+    [self writeStartTag:suite.elementName withAttributes:suite.attributes named:suite.attributeNames];
+    if (suite.children.count == 0) {
+        [self write:[NSString stringWithFormat:@"</%@>", suite.elementName]];
+        return;
+    }
+    for (id child in suite.children) {
+        [self write:@"\n"];
+        if ([child isKindOfClass:[BPJUnitSuite class]]) {
+            [self writeSuite:child atDepth:depth + 1];
+        } else if ([child isKindOfClass:[NSArray class]]) {
+            NSArray<BPJUnitElement *> *results = child;
+            for (NSUInteger i = 0; i < results.count; i++) {
+                if (i > 0) {
+                    [self write:@"\n"];
+                }
+                [self writeElement:results[i] atDepth:depth + 1];
+            }
+        } else {
+            [self writeElement:child atDepth:depth + 1];
+        }
+    }
+    [self write:@"\n"];
+    [self writeIndent:depth];
+    [self write:[NSString stringWithFormat:@"</%@>", suite.elementName]];
+}
+
+- (void)writeElement:(BPJUnitElement *)element atDepth:(NSUInteger)depth {
+    [self writeIndent:depth];
+    [self writeStartTag:element.name withAttributes:element.attributes named:element.attributeNames];
+    [self write:[self escape:element.text inAttribute:NO]];
+    if (element.children.count > 0) {
+        for (BPJUnitElement *child in element.children) {
+            [self write:@"\n"];
+            [self writeElement:child atDepth:depth + 1];
+        }
+        [self write:@"\n"];
+        [self writeIndent:depth];
+    }
+    [self write:[NSString stringWithFormat:@"</%@>", element.name]];
+}
+
+- (void)writeStartTag:(NSString *)name
+       withAttributes:(NSDictionary<NSString *, NSString *> *)attributes
+                named:(NSArray<NSString *> *)attributeNames {
+    [self write:@"<"];
+    [self write:name];
+    for (NSString *attribute in attributeNames) {
+        [self write:[NSString stringWithFormat:@" %@=\"%@\"", attribute, [self escape:attributes[attribute] inAttribute:YES]]];
+    }
+    [self write:@">"];
+}
+
+- (void)writeIndent:(NSUInteger)depth {
+    for (NSUInteger i = 0; i < depth; i++) {
+        [self write:@"    "];
+    }
+}
+
+- (NSString *)escape:(NSString *)string inAttribute:(BOOL)inAttribute {
+    if ([string rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"&<>\""]].location == NSNotFound) {
+        return string;
+    }
+    NSMutableString *escaped = [string mutableCopy];
+    [escaped replaceOccurrencesOfString:@"&" withString:@"&amp;" options:0 range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@"<" withString:@"&lt;" options:0 range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@">" withString:@"&gt;" options:0 range:NSMakeRange(0, escaped.length)];
+    if (inAttribute) {
+        [escaped replaceOccurrencesOfString:@"\"" withString:@"&quot;" options:0 range:NSMakeRange(0, escaped.length)];
+    }
+    return escaped;
+}
+
+- (void)write:(NSString *)string {
+    [self.buffer appendString:string];
+    if (self.buffer.length >= kOutputBufferSize) {
+        [self flush];
+    }
+}
+
+- (void)flush {
+    NSData *data = [self.buffer dataUsingEncoding:NSUTF8StringEncoding];
+    [self.buffer setString:@""];
+    const uint8_t *bytes = data.bytes;
+    NSUInteger written = 0;
+    while (!self.writeError && written < data.length) {
+        NSInteger n = [self.output write:bytes + written maxLength:data.length - written];
+        if (n <= 0) {
+            self.writeError = self.output.streamError ?: [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil];
+            break;
+        }
+        written += n;
+    }
+}
+
+@end
@@ -23,4 +23,13 @@
                          configuration:(BPConfiguration *)config
                               andError:(NSError **)errPtr;
 
+/*!
+ * @discussion The estimate used for tests missing from the time estimates file.
+ * @param config The configuration file for this bluepill-runner
+ * @param testTimes Mapping of a test name to it's estimated execution time
+ * @return config.defaultTestTime if set, otherwise the average of all the known estimates.
+ */
++ (double)defaultTestTimeWithConfig:(BPConfiguration *)config
+                          testTimes:(NSDictionary<NSString *, NSNumber *> *)testTimes;
+
 @end
@@ -10,6 +10,29 @@
 #import "bp/src/BPXCTestFile.h"
 #import "bp/src/BPUtils.h"
 #import "BPPacker.h"
+#import "BPTestHostOverhead.h"
+#import "BPTestTimeStore.h"
+
+// How the tests of one .xctest bundle are split into the bundles handed to the simulators.
+@interface BPBundlePlan : NSObject
+@property (nonatomic, strong) BPXCTestFile *xctFile;
+@property (nonatomic, strong) NSArray<NSString *> *tests;
+@property (nonatomic, assign) BOOL splittable;
+@property (nonatomic, assign) double overhead;
+@property (nonatomic, strong) NSArray<NSArray<NSString *> *> *chunks;
+@property (nonatomic, strong) NSArray<NSNumber *> *chunkTimes;
+@property (nonatomic, assign) double totalTime;
+@property (nonatomic, assign) double longestChunkTime;
+@property (nonatomic, readonly) NSUInteger numChunks;
+@end
+
+@implementation BPBundlePlan
+
+- (NSUInteger)numChunks {
+    return self.chunks.count;
+}
+
+@end
 
 @implementation BPPacker
 
@@ -17,14 +40,14 @@
                          configuration:(BPConfiguration *)config
                               andError:(NSError **)errPtr {
     NSArray<BPXCTestFile *> *packedBundles = nil;
-    if (config.testTimeEstimatesJsonFile) {
+    if (config.testTimeEstimatesJsonFile || config.testTimeStoreFile) {
         packedBundles = [self packTestsByTime:xcTestFiles configuration:config andError:errPtr];
         // Return if there is an error in packing by test time estimates
         if (errPtr && *errPtr != nil)
             return nil;
     }
-    // Split tests by count if time estimates json is missing or splitting by time estimates failed
-    if (!config.testTimeEstimatesJsonFile || !packedBundles) {
+    // Split tests by count if time estimates are missing or splitting by time estimates failed
+    if (!packedBundles) {
         packedBundles = [self packTestsByCount:xcTestFiles configuration:config andError:errPtr];
     }
     return packedBundles;
@@ -112,7 +135,14 @@
 }
 
 /*!
- * @discussion Ideally each test bundle should not take more than totalTime/numSims, so split bundles which take longer.
+ * @discussion Split .xctest bundles so that their predicted makespan on numSims simulators is close to optimal.
+ * Bundles are handed to the simulators longest first, each one going to whichever simulator frees up first
+ * (LPT scheduling), and every bundle pays a fixed overhead for creating the simulator, installing and
+ * launching the app, learned per test host from an earlier run when possible. Starting both from the fewest
+ * splits that keep each bundle under totalTime/numSims and from no splits at all, the bundle holding the
+ * longest chunk is split further only while that shortens the makespan, and the better schedule wins.
+ * The bundles are returned longest first, overhead included, which is the order the runner hands them out in.
+ * The estimatedExecutionTime of the returned bundles does not include the overhead.
  * @param config The configuration file for this bluepill-runner
  * @param testTimes Mapping of a test name to it's estimated execution time
  * @param xcTestFiles An array of xctestfiles to pack
@@ -122,71 +152,324 @@
                                             withTestTimes:(NSDictionary<NSString *, NSNumber *> *)testTimes
                                            andXCTestFiles:(NSArray<BPXCTestFile *> *)xcTestFiles {
     NSArray *noSplit = config.noSplit;
-    double totalTime = [BPUtils getTotalTimeWithConfig:config
+    NSUInteger numSims = MAX(1, [[config numSims] integerValue]);
+    double knownTime = [BPUtils getTotalTimeWithConfig:config
                                              testTimes:testTimes
                                         andXCTestFiles:xcTestFiles];
     // If the time estimates are unavailable or adding up to ZERO, skip packing by time estimates
-    [BPUtils printInfo:INFO withString:@"Total time is around %f seconds.", totalTime];
-    if (totalTime <= 0.0) {
+    if (knownTime <= 0.0) {
         [BPUtils printInfo:INFO withString:@"Unable to pack tests by time estimates "
             "because they are either unavailable or adding up to be zero."];
         return nil;
     }
-    // Maximum allowed bundle time to optimize the sim track execution long pole which is maximum of all track times
-    double optimalBundleTime = totalTime / [[config numSims] floatValue];
-    [BPUtils printInfo:INFO withString:@"Optimal Bundle Time is around %f seconds.", optimalBundleTime];
+    double defaultTime = [self defaultTestTimeWithConfig:config testTimes:testTimes];
+    double defaultOverhead = MAX(0.0, [config.bundleOverhead doubleValue]);
+    NSDictionary<NSString *, NSNumber *> *hostOverheads = [self testHostOverheadsWithConfig:config];
     NSDictionary<NSString *, NSSet *> *testsToRunByFilePath = [BPUtils getTestsToRunByFilePathWithConfig:config
                                                                                           andXCTestFiles:xcTestFiles];
-    NSDictionary<NSString *, NSNumber *> *testEstimatesByFilePath = [BPUtils getTestEstimatesByFilePathWithConfig:config
-                                                                                                        testTimes:testTimes
-                                                                                                   andXCTestFiles:xcTestFiles];
 
-    NSMutableArray<BPXCTestFile *> *bundles = [[NSMutableArray alloc] init];
+    NSMutableDictionary<NSString *, NSNumber *> *estimates = [[NSMutableDictionary alloc] init];
+    NSUInteger unknownTests = 0;
+    double totalTime = 0.0;
+    double longestTest = 0.0;
+    for (NSString *filePath in testsToRunByFilePath) {
+        for (NSString *test in testsToRunByFilePath[filePath]) {
+            NSNumber *estimate = testTimes[test];
+            if (!estimate) {
+                estimate = [NSNumber numberWithDouble:defaultTime];
+                unknownTests++;
+            }
+            estimates[test] = estimate;
+            totalTime += [estimate doubleValue];
+            longestTest = MAX(longestTest, [estimate doubleValue]);
+        }
+    }
+    [BPUtils printInfo:INFO withString:@"Total time is around %f seconds (%lu tests without an estimate counted as %f seconds each).",
+     totalTime, (unsigned long)unknownTests, defaultTime];
+    // No bundle should take longer than a simulator would if the work were spread perfectly evenly.
+    double maxBundleTime = MAX(totalTime / numSims, longestTest);
+    [BPUtils printInfo:INFO withString:@"Optimal Bundle Time is around %f seconds.", maxBundleTime];
+
+    NSMutableArray<BPBundlePlan *> *plans = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *cappedSplits = [[NSMutableArray alloc] init];
     for (BPXCTestFile *xctFile in xcTestFiles) {
         NSArray *bundleTestsToRun = [[testsToRunByFilePath[xctFile.testBundlePath] allObjects] sortedArrayUsingSelector:@selector(compare:)];
-        NSNumber *estimatedBundleTime = testEstimatesByFilePath[xctFile.testBundlePath];
-        // If the bundle is small enough, do not split. Also do not split if the bundle is in no_split list.
-        if ([noSplit containsObject:[xctFile name]] || [estimatedBundleTime doubleValue] < optimalBundleTime) {
-            BPXCTestFile *bundle = [self makeBundle:xctFile withTests:bundleTestsToRun startAt:0 numTests:[bundleTestsToRun count] estimatedTime:estimatedBundleTime];
-            [bundles addObject:bundle];
-            continue;
+        BPBundlePlan *plan = [[BPBundlePlan alloc] init];
+        plan.xctFile = xctFile;
+        plan.tests = bundleTestsToRun ?: @[];
+        plan.splittable = ![noSplit containsObject:[xctFile name]] && plan.tests.count > 1;
+        NSNumber *hostOverhead = hostOverheads[[xctFile.testHostPath lastPathComponent]];
+        plan.overhead = hostOverhead ? [hostOverhead doubleValue] : defaultOverhead;
+        double bundleTime = 0.0;
+        for (NSString *test in plan.tests) {
+            bundleTime += [estimates[test] doubleValue];
         }
-        for (int i = 0; i < [bundleTestsToRun count];) {
-            double splitExecTime = 0.0;
-            NSUInteger startIndex = i;
-            while(splitExecTime < optimalBundleTime && i < [bundleTestsToRun count]) {
-                NSString *test = [bundleTestsToRun objectAtIndex:i];
-                if ([testTimes objectForKey:test]) {
-                    if (splitExecTime + [testTimes[test] doubleValue] <= optimalBundleTime) {
-                        splitExecTime += [testTimes[test] doubleValue];
-                    } else {
-                        break;
-                    }
-                }
-                i++;
-            }
-            // Make a bundle out of current xctFile
-            BPXCTestFile *bundle = [self makeBundle:xctFile withTests:bundleTestsToRun startAt:startIndex numTests:(i-startIndex) estimatedTime:[NSNumber numberWithDouble:splitExecTime]];
+        NSUInteger numChunks = plan.splittable ? MIN(plan.tests.count, MAX(1, (NSUInteger)ceil(bundleTime / maxBundleTime - 1e-9))) : 1;
+        [self splitPlan:plan intoChunks:numChunks withEstimates:estimates];
+        while (plan.splittable && plan.chunks.count < plan.tests.count && plan.longestChunkTime > maxBundleTime + 1e-9) {
+            [self splitPlan:plan intoChunks:plan.chunks.count + 1 withEstimates:estimates];
+        }
+        [plans addObject:plan];
+        [cappedSplits addObject:[NSNumber numberWithUnsignedInteger:plan.chunks.count]];
+    }
+
+    // Start from the fewest splits that keep every bundle under the ideal time, then also from no splits at all:
+    // when the overhead is large compared to the tests, running fewer and longer bundles wins.
+    NSArray<NSNumber *> *bestSplits;
+    double bestMakespan = [self refineSplitsOfPlans:plans
+                                         fromSplits:cappedSplits
+                                       maxChunkTime:maxBundleTime
+                                          estimates:estimates
+                                            numSims:numSims
+                                         bestSplits:&bestSplits];
+    NSMutableArray<NSNumber *> *noSplits = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < plans.count; i++) {
+        [noSplits addObject:@1];
+    }
+    NSArray<NSNumber *> *unboundedSplits;
+    double unboundedMakespan = [self refineSplitsOfPlans:plans
+                                              fromSplits:noSplits
+                                            maxChunkTime:INFINITY
+                                               estimates:estimates
+                                                 numSims:numSims
+                                              bestSplits:&unboundedSplits];
+    if (unboundedMakespan < bestMakespan - 1e-9) {
+        bestSplits = unboundedSplits;
+    }
+
+    NSMutableArray<BPXCTestFile *> *bundles = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *costs = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < plans.count; i++) {
+        BPBundlePlan *plan = plans[i];
+        [self splitPlan:plan intoChunks:[bestSplits[i] unsignedIntegerValue] withEstimates:estimates];
+        for (NSUInteger c = 0; c < plan.chunks.count; c++) {
+            BPXCTestFile *bundle = [self makeBundle:plan.xctFile withTests:plan.tests including:plan.chunks[c] estimatedTime:plan.chunkTimes[c]];
             [bundles addObject:bundle];
+            [costs addObject:[NSNumber numberWithDouble:[plan.chunkTimes[c] doubleValue] + plan.overhead]];
         }
     }
     [BPUtils printInfo:INFO withString:@"Splitted %lu bundles into %lu bundles.", [xcTestFiles count], [bundles count]];
+    // Hand the bundles out in the order the schedule was predicted with. A bundle of a slow to set up
+    // test host can cost more than a longer one of another host.
+    NSMutableArray<NSNumber *> *order = [[NSMutableArray alloc] initWithCapacity:bundles.count];
+    for (NSUInteger i = 0; i < bundles.count; i++) {
+        [order addObject:[NSNumber numberWithUnsignedInteger:i]];
+    }
+    [order sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSNumber *i1, NSNumber *i2) {
+        return [costs[[i2 unsignedIntegerValue]] compare:costs[[i1 unsignedIntegerValue]]];
+    }];
+    NSMutableArray<BPXCTestFile *> *sortedBundles = [[NSMutableArray alloc] initWithCapacity:bundles.count];
+    for (NSNumber *i in order) {
+        [sortedBundles addObject:bundles[[i unsignedIntegerValue]]];
+    }
 
-    return bundles;
+    NSArray<NSNumber *> *finishTimes = [self finishTimesOfCosts:costs numSims:numSims];
+    double lowerBound = MAX([[costs valueForKeyPath:@"@max.doubleValue"] doubleValue],
+                            [[costs valueForKeyPath:@"@sum.doubleValue"] doubleValue] / numSims);
+    [BPUtils printInfo:INFO withString:@"Predicted makespan is %.2f seconds (lower bound %.2f seconds).",
+     [[finishTimes valueForKeyPath:@"@max.doubleValue"] doubleValue], lowerBound];
+    for (NSUInteger i = 0; i < finishTimes.count; i++) {
+        [BPUtils printInfo:INFO withString:@"Simulator %lu predicted to finish after %.2f seconds.", (unsigned long)i + 1, [finishTimes[i] doubleValue]];
+    }
+    return sortedBundles;
+}
+
+/*!
+ * @discussion Repeatedly split the splittable bundle with the longest chunk and keep the best schedule seen.
+ * @param plans The bundles to split. Their chunks are left in an arbitrary state.
+ * @param splits The number of chunks to start from for each plan.
+ * @param maxChunkTime Schedules with a chunk longer than this are not considered.
+ * @param bestSplits Receives the number of chunks of each plan in the best schedule.
+ * @return The predicted makespan of the best schedule.
+ */
++ (double)refineSplitsOfPlans:(NSArray<BPBundlePlan *> *)plans
+                   fromSplits:(NSArray<NSNumber *> *)splits
+                 maxChunkTime:(double)maxChunkTime
+                    estimates:(NSDictionary<NSString *, NSNumber *> *)estimates
+                      numSims:(NSUInteger)numSims
+                   bestSplits:(NSArray<NSNumber *> **)bestSplits {
+    for (NSUInteger i = 0; i < plans.count; i++) {
+        [self splitPlan:plans[i] intoChunks:[splits[i] unsignedIntegerValue] withEstimates:estimates];
+    }
+    double bestMakespan = [self makespanOfPlans:plans numSims:numSims];
+    *bestSplits = [plans valueForKey:@"numChunks"];
+    NSUInteger attemptsSinceImprovement = 0;
+    while (attemptsSinceImprovement < numSims) {
+        // The longest bundles bound the makespan from below, so those are the ones worth splitting.
+        BPBundlePlan *longest = nil;
+        double totalCost = 0.0;
+        BOOL withinLimit = YES;
+        for (BPBundlePlan *plan in plans) {
+            if (plan.splittable && plan.chunks.count < plan.tests.count &&
+                (!longest || plan.longestChunkTime > longest.longestChunkTime)) {
+                longest = plan;
+            }
+            totalCost += plan.totalTime + plan.overhead * plan.chunks.count;
+        }
+        // Every extra split only adds overhead, so stop once the average load alone can't beat the best schedule.
+        if (!longest || (totalCost + longest.overhead) / numSims >= bestMakespan) {
+            break;
+        }
+        [self splitPlan:longest intoChunks:longest.chunks.count + 1 withEstimates:estimates];
+        for (BPBundlePlan *plan in plans) {
+            withinLimit = withinLimit && plan.longestChunkTime <= maxChunkTime + 1e-9;
+        }
+        double makespan = [self makespanOfPlans:plans numSims:numSims];
+        if (makespan < bestMakespan - 1e-9 && withinLimit) {
+            bestMakespan = makespan;
+            *bestSplits = [plans valueForKey:@"numChunks"];
+            attemptsSinceImprovement = 0;
+        } else {
+            attemptsSinceImprovement++;
+        }
+    }
+    return bestMakespan;
+}
+
+/*!
+ * @discussion The per-bundle overhead of each test host, learned from config.bundleOverheadStatsFile.
+ * @return A mapping of test host name to seconds. Test hosts missing from it use config.bundleOverhead.
+ */
++ (NSDictionary<NSString *, NSNumber *> *)testHostOverheadsWithConfig:(BPConfiguration *)config {
+    if (!config.bundleOverheadStatsFile) {
+        return @{};
+    }
+    NSError *error;
+    NSDictionary<NSString *, NSNumber *> *overheads = [BPTestHostOverhead overheadsFromStatsFile:config.bundleOverheadStatsFile withError:&error];
+    if (!overheads) {
+        [BPUtils printInfo:WARNING withString:@"Unable to learn the bundle overhead from %@: %@", config.bundleOverheadStatsFile, [error localizedDescription]];
+        return @{};
+    }
+    for (NSString *testHost in overheads) {
+        [BPUtils printInfo:INFO withString:@"%@ takes about %.2f seconds to set up.", testHost, [overheads[testHost] doubleValue]];
+    }
+    return overheads;
+}
+
++ (double)defaultTestTimeWithConfig:(BPConfiguration *)config
+                          testTimes:(NSDictionary<NSString *, NSNumber *> *)testTimes {
+    if (config.defaultTestTime) {
+        return MAX(0.0, [config.defaultTestTime doubleValue]);
+    }
+    if (testTimes.count == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (NSString *test in testTimes) {
+        sum += [testTimes[test] doubleValue];
+    }
+    return sum / testTimes.count;
+}
+
+/*!
+ * @discussion Split the tests of a bundle into `numChunks` chunks of about the same estimated time by handing
+ * out the longest tests first, each to the chunk with the least work so far.
+ */
++ (void)splitPlan:(BPBundlePlan *)plan
+       intoChunks:(NSUInteger)numChunks
+    withEstimates:(NSDictionary<NSString *, NSNumber *> *)estimates {
+    NSArray *byTime = [plan.tests sortedArrayUsingComparator:^NSComparisonResult(NSString *test1, NSString *test2) {
+        double time1 = [estimates[test1] doubleValue];
+        double time2 = [estimates[test2] doubleValue];
+        if (time1 != time2) {
+            return time1 > time2 ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return [test1 compare:test2];
+    }];
+    NSMutableArray<NSMutableArray *> *chunks = [[NSMutableArray alloc] initWithCapacity:numChunks];
+    double chunkTimes[numChunks];
+    for (NSUInteger c = 0; c < numChunks; c++) {
+        [chunks addObject:[[NSMutableArray alloc] init]];
+        chunkTimes[c] = 0.0;
+    }
+    for (NSString *test in byTime) {
+        NSUInteger lightest = 0;
+        for (NSUInteger c = 1; c < numChunks; c++) {
+            if (chunkTimes[c] < chunkTimes[lightest]) {
+                lightest = c;
+            }
+        }
+        [chunks[lightest] addObject:test];
+        chunkTimes[lightest] += [estimates[test] doubleValue];
+    }
+    NSMutableArray<NSNumber *> *times = [[NSMutableArray alloc] initWithCapacity:numChunks];
+    double totalTime = 0.0;
+    double longest = 0.0;
+    for (NSUInteger c = 0; c < numChunks; c++) {
+        [chunks[c] sortUsingSelector:@selector(compare:)];
+        [times addObject:[NSNumber numberWithDouble:chunkTimes[c]]];
+        totalTime += chunkTimes[c];
+        longest = MAX(longest, chunkTimes[c]);
+    }
+    plan.chunks = chunks;
+    plan.chunkTimes = times;
+    plan.totalTime = totalTime;
+    plan.longestChunkTime = longest;
+}
+
++ (double)makespanOfPlans:(NSArray<BPBundlePlan *> *)plans
+                  numSims:(NSUInteger)numSims {
+    NSMutableArray<NSNumber *> *costs = [[NSMutableArray alloc] init];
+    for (BPBundlePlan *plan in plans) {
+        for (NSNumber *chunkTime in plan.chunkTimes) {
+            [costs addObject:[NSNumber numberWithDouble:[chunkTime doubleValue] + plan.overhead]];
+        }
+    }
+    return [[[self finishTimesOfCosts:costs numSims:numSims] valueForKeyPath:@"@max.doubleValue"] doubleValue];
+}
+
+/*!
+ * @discussion Simulate the runner handing out bundles longest first to whichever simulator frees up first.
+ * @param costs The predicted time of each bundle, overhead included.
+ * @return The predicted finish time of each simulator.
+ */
++ (NSArray<NSNumber *> *)finishTimesOfCosts:(NSArray<NSNumber *> *)costs numSims:(NSUInteger)numSims {
+    NSArray<NSNumber *> *sortedCosts = [costs sortedArrayUsingComparator:^NSComparisonResult(NSNumber *cost1, NSNumber *cost2) {
+        return [cost2 compare:cost1];
+    }];
+    double finishTimes[numSims];
+    for (NSUInteger i = 0; i < numSims; i++) {
+        finishTimes[i] = 0.0;
+    }
+    for (NSNumber *cost in sortedCosts) {
+        NSUInteger first = 0;
+        for (NSUInteger i = 1; i < numSims; i++) {
+            if (finishTimes[i] < finishTimes[first]) {
+                first = i;
+            }
+        }
+        finishTimes[first] += [cost doubleValue];
+    }
+    NSMutableArray<NSNumber *> *result = [[NSMutableArray alloc] initWithCapacity:numSims];
+    for (NSUInteger i = 0; i < numSims; i++) {
+        [result addObject:[NSNumber numberWithDouble:finishTimes[i]]];
+    }
+    return result;
 }
 
 + (NSArray<BPXCTestFile *> *)packTestsByTime:(NSArray<BPXCTestFile *> *)xcTestFiles
                                configuration:(BPConfiguration *)config
                                     andError:(NSError **)errPtr {
-    [BPUtils printInfo:INFO withString:@"Packing based on individual test execution times in file path: %@", config.testTimeEstimatesJsonFile];
+    [BPUtils printInfo:INFO withString:@"Packing based on individual test execution times in file path: %@", config.testTimeEstimatesJsonFile ?: config.testTimeStoreFile];
     if (xcTestFiles.count == 0) {
         BP_SET_ERROR(errPtr, @"Found no XCTest files.\n"
                      "Perhaps you forgot to 'build-for-testing'? (Cmd + Shift + U) in Xcode.");
         return NULL;
     }
 
-    // load the config file
-    NSDictionary<NSString *, NSNumber *> *testTimes = [BPUtils loadSimpleJsonFile:config.testTimeEstimatesJsonFile withError:errPtr];
+    NSDictionary<NSString *, NSNumber *> *testTimes;
+    if (!config.testTimeEstimatesJsonFile) {
+        // The store is only a hint: on the first run there is nothing in it yet.
+        NSError *error;
+        testTimes = [BPTestTimeStore estimatesFromStoreAtPath:config.testTimeStoreFile withError:&error];
+        if (!testTimes) {
+            [BPUtils printInfo:INFO withString:@"No test time estimates available yet: %@", [error localizedDescription]];
+            return nil;
+        }
+    } else {
+        // load the config file
+        testTimes = [BPUtils loadSimpleJsonFile:config.testTimeEstimatesJsonFile withError:errPtr];
+    }
     if (errPtr && *errPtr) {
         [BPUtils printInfo:ERROR withString:@"%@", [*errPtr localizedDescription]];
         return NULL;
@@ -197,25 +480,14 @@
 
     [BPUtils printInfo:INFO withString:@"Test cases to run from the config: %lu", [config.testCasesToRun count]];
 
-    NSArray<BPXCTestFile *> *bundles = [self splitXCTestBundlesWithConfig:config
-                                                            withTestTimes:testTimes
-                                                           andXCTestFiles:xcTestFiles];
-    if (bundles == nil) {
+    // Sorted from longest to shortest, bundle overhead included
+    NSArray<BPXCTestFile *> *sortedBundles = [self splitXCTestBundlesWithConfig:config
+                                                                  withTestTimes:testTimes
+                                                                 andXCTestFiles:xcTestFiles];
+    if (sortedBundles == nil) {
         [BPUtils printInfo:INFO withString:@"Splitting of test bundles by time estimates failed."];
         return nil;
     }
-    // Sort bundles by execution times from longest to shortest
-    NSArray *sortedBundles = [bundles sortedArrayUsingComparator:^NSComparisonResult(id _Nonnull obj1, id _Nonnull obj2) {
-        NSNumber *estimatedTime1 = [(BPXCTestFile *)obj1 estimatedExecutionTime];
-        NSNumber *estimatedTime2 = [(BPXCTestFile *)obj2 estimatedExecutionTime];
-        if ([estimatedTime1 doubleValue] < [estimatedTime2 doubleValue]) {
-            return NSOrderedDescending;
-        } else if([estimatedTime1 doubleValue] > [estimatedTime2 doubleValue]) {
-            return NSOrderedAscending;
-        } else {
-            return NSOrderedSame;
-        }
-    }];
     [BPUtils printInfo:INFO withString:@"The test bundles after splitting based on time and sorting from longest to shortest are..."];
     NSNumberFormatter *fmt = [[NSNumberFormatter alloc] init];
     [fmt setPositiveFormat:@".02"];
@@ -231,13 +503,11 @@
 
 + (BPXCTestFile *)makeBundle:(BPXCTestFile *)xctFile
                    withTests:(NSArray *)bundleTestsToRun
-                     startAt:(NSUInteger)location
-                    numTests:(NSUInteger)length
+                   including:(NSArray *)chunkTests
                estimatedTime:(NSNumber *)splitExecutionTime {
     NSMutableArray *testsToSkip = [NSMutableArray arrayWithArray:bundleTestsToRun];
-    NSRange range = NSMakeRange(location, length);
-    [BPUtils printInfo:INFO withString:@"%@: Including range: (%lu, %lu)", xctFile.testBundlePath, (unsigned long)range.location, (unsigned long)range.length];
-    [testsToSkip removeObjectsInArray:[bundleTestsToRun subarrayWithRange:range]];
+    [BPUtils printInfo:INFO withString:@"%@: Including %lu of %lu tests", xctFile.testBundlePath, (unsigned long)chunkTests.count, (unsigned long)bundleTestsToRun.count];
+    [testsToSkip removeObjectsInArray:chunkTests];
     [testsToSkip addObjectsFromArray:xctFile.skipTestIdentifiers];
     [testsToSkip sortUsingSelector:@selector(compare:)];
 
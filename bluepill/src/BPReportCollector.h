@@ -20,4 +20,23 @@
                deleteCollected:(BOOL)deleteCollected
               withOutputAtDir:(NSString *)finalReportsDir;
 
+/*!
+ * @discussion merge the JUnit reports under reportsPath(recursive), parsing them concurrently, into TEST-FinalReport.xml
+ * and write the HTML report. The time it takes is recorded in BPStats.
+ * @param reportsPath parent path to the reports
+ * @param finalReportsDir the directory where to save the final reports
+ */
++ (void)collectJUnitReportsFromPath:(NSString *)reportsPath
+                    deleteCollected:(BOOL)deleteCollected
+                    withOutputAtDir:(NSString *)finalReportsDir;
+
+/*!
+ * @discussion concatenate the trace profiles (*.json) under reportsPath(recursive) into trace-profile.json
+ * @param reportsPath parent path to the trace profiles
+ * @param finalReportsDir the directory where to save trace-profile.json
+ */
++ (void)collectTraceProfilesFromPath:(NSString *)reportsPath
+                     deleteCollected:(BOOL)deleteCollected
+                     withOutputAtDir:(NSString *)finalReportsDir;
+
 @end
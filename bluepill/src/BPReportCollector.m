@@ -8,9 +8,15 @@
 //  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
 
 #import "BPHTMLReportWriter.h"
+#import "BPJUnitMerger.h"
 #import "BPReportCollector.h"
+#import "bp/src/BPJUnitJournal.h"
+#import "bp/src/BPStats.h"
 #import "bp/src/BPUtils.h"
 
+// Size of the stdio buffer trace-profile.json is written through.
+static const size_t kTraceBufferSize = 1024 * 1024;
+
 // Save path and mtime for reports (sort by mtime)
 @interface BPXMLReport:NSObject
 @property(atomic, strong) NSURL *url;
@@ -34,17 +40,163 @@
 + (void)collectReportsFromPath:(NSString *)reportsPath
                deleteCollected:(BOOL)deleteCollected
                withOutputAtDir:(NSString *)finalReportsDir {
-    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [self collectJUnitReportsFromPath:reportsPath deleteCollected:deleteCollected withOutputAtDir:finalReportsDir];
+    [self collectTraceProfilesFromPath:reportsPath deleteCollected:deleteCollected withOutputAtDir:finalReportsDir];
+}
 
++ (void)collectJUnitReportsFromPath:(NSString *)reportsPath
+                    deleteCollected:(BOOL)deleteCollected
+                    withOutputAtDir:(NSString *)finalReportsDir {
+    [[BPStats sharedStats] startTimer:@"Collecting JUnit Reports"];
     NSString *finalReportPath = [finalReportsDir stringByAppendingPathComponent:@"TEST-FinalReport.xml"];
-    NSString *traceFilePath = [finalReportsDir stringByAppendingPathComponent:@"trace-profile.json"];
+    [[NSFileManager defaultManager] removeItemAtPath:finalReportPath error:nil];
+    [self writeReportsFromJournalsUnderPath:reportsPath deleteCollected:deleteCollected];
+
+    NSMutableArray<BPXMLReport *> *reports = [[NSMutableArray alloc] init];
+    for (NSURL *url in [self filesWithExtension:@"xml" underPath:reportsPath]) {
+        [BPUtils printInfo:DEBUGINFO withString:@"JUnit collecting: %@", [url path]];
+        NSString *path = [url path];
+        NSError *error;
+        NSDictionary *fileAttrs = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:&error];
+        if (error) {
+            [BPUtils printInfo:ERROR withString:@"Failed to get attributes for '%@': %@", path, [error localizedDescription]];
+            continue;
+        }
+        NSDate *mtime = [fileAttrs objectForKey:NSFileModificationDate];
+        BPXMLReport *report = [[BPXMLReport alloc] initWithPath:url andMTime:mtime];
+        [reports addObject:report];
+    }
+    NSXMLDocument *jUnitReport = [self collateReports:reports
+                                    andDeleteCollated:deleteCollected
+                                         withOutputAt:finalReportPath];
+
+    // write a html report
+    if (jUnitReport) {
+        [[BPStats sharedStats] startTimer:@"Writing HTML Report"];
+        [[BPHTMLReportWriter new] writeHTMLReportWithJUnitReport:jUnitReport
+                                                        inFolder:finalReportsDir];
+        [[BPStats sharedStats] endTimer:@"Writing HTML Report" withResult:@"INFO"];
+    }
+    [[BPStats sharedStats] endTimer:@"Collecting JUnit Reports" withResult:jUnitReport ? @"INFO" : @"ERROR"];
+}
+
+// A bp that was killed before it could write its report leaves its journal behind instead.
+// Journals that can't be recovered are kept, so that they can be looked into.
++ (void)writeReportsFromJournalsUnderPath:(NSString *)reportsPath deleteCollected:(BOOL)deleteCollected {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSURL *url in [self filesWithExtension:@"journal" underPath:reportsPath]) {
+        NSString *journalPath = [url path];
+        NSString *reportPath = [[journalPath stringByDeletingPathExtension] stringByAppendingPathExtension:@"xml"];
+        NSError *error;
+        BOOL recovered = YES;
+        if ([fileManager fileExistsAtPath:reportPath]) {
+            [BPUtils printInfo:DEBUGINFO withString:@"Ignoring journal '%@', its report was written", journalPath];
+        } else if ([BPJUnitJournal writeReportFromJournalAtPath:journalPath toFile:reportPath withError:&error]) {
+            [BPUtils printInfo:INFO withString:@"Recovered JUnit report from journal: %@", reportPath];
+        } else {
+            [BPUtils printInfo:ERROR withString:@"Failed to recover a JUnit report from '%@': %@", journalPath, [error localizedDescription]];
+            recovered = NO;
+        }
+        if (recovered && deleteCollected) {
+            [fileManager removeItemAtURL:url error:nil];
+        }
+    }
+}
 
-    [fileManager removeItemAtPath:finalReportPath error:nil];
++ (void)collectTraceProfilesFromPath:(NSString *)reportsPath
+                     deleteCollected:(BOOL)deleteCollected
+                     withOutputAtDir:(NSString *)finalReportsDir {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *traceFilePath = [finalReportsDir stringByAppendingPathComponent:@"trace-profile.json"];
     [fileManager removeItemAtPath:traceFilePath error:nil];
 
-    NSURL *directoryURL = [NSURL fileURLWithPath:reportsPath isDirectory:YES];
+    NSArray<NSURL *> *traceFiles = [self filesWithExtension:@"json" underPath:reportsPath];
+    if (traceFiles.count == 0) {
+        return;
+    }
+    NSError *error;
+    NSString *tmpPath = [BPUtils mkstemp:traceFilePath withError:&error];
+    FILE *output = tmpPath ? fopen([tmpPath fileSystemRepresentation], "w") : NULL;
+    if (!output) {
+        [BPUtils printInfo:ERROR withString:@"Failed to create '%@': %@", traceFilePath, tmpPath ? @(strerror(errno)) : [error localizedDescription]];
+        return;
+    }
+    setvbuf(output, NULL, _IOFBF, kTraceBufferSize);
+
+    // Each file is a fragment of events, one per line, without the enclosing brackets.
+    fputs("[\n", output);
+    NSUInteger numEvents = 0;
+    for (NSURL *url in traceFiles) {
+        [BPUtils printInfo:DEBUGINFO withString:@"Collecting trace report: %@", [url path]];
+        @autoreleasepool {
+            if ([self appendTraceEventsFromURL:url toFile:output numEvents:&numEvents] && deleteCollected) {
+                [fileManager removeItemAtURL:url error:nil];
+            }
+        }
+    }
+    fputs("\n]\n", output);
+    BOOL written = !ferror(output);
+    written = (fclose(output) == 0) && written;
+    if (!written || rename([tmpPath fileSystemRepresentation], [traceFilePath fileSystemRepresentation]) != 0) {
+        [BPUtils printInfo:ERROR withString:@"Failed to write '%@': %s", traceFilePath, strerror(errno)];
+        [fileManager removeItemAtPath:tmpPath error:nil];
+        return;
+    }
+    [BPUtils printInfo:INFO withString:@"Trace profile: %@ (%lu events)", traceFilePath, (unsigned long)numEvents];
+}
+
+// Copy the events of a trace fragment to output, straight from the mapped file. The separators
+// are rewritten, so trailing commas are dropped, and lines that aren't a JSON object (e.g. the
+// last line of a bp that was killed while writing it) are skipped so the profile stays loadable.
++ (BOOL)appendTraceEventsFromURL:(NSURL *)url toFile:(FILE *)output numEvents:(NSUInteger *)numEvents {
+    NSError *error;
+    NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:&error];
+    if (!data) {
+        [BPUtils printInfo:ERROR withString:@"Failed to read '%@': %@", [url path], [error localizedDescription]];
+        return NO;
+    }
+    NSUInteger skipped = 0;
+    const char *bytes = data.bytes;
+    const char *end = bytes + data.length;
+    const char *line = bytes;
+    while (line < end) {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *lineEnd = newline ?: end;
+        const char *first = line;
+        const char *last = lineEnd;
+        while (first < last && isspace((unsigned char)*first)) {
+            first++;
+        }
+        while (last > first && (isspace((unsigned char)last[-1]) || last[-1] == ',')) {
+            last--;
+        }
+        line = lineEnd + 1;
+        size_t length = last - first;
+        if (length == 0 || (length == 1 && (*first == '[' || *first == ']'))) {
+            continue;
+        }
+        NSData *event = [NSData dataWithBytesNoCopy:(void *)first length:length freeWhenDone:NO];
+        if (*first != '{' || ![[NSJSONSerialization JSONObjectWithData:event options:0 error:nil] isKindOfClass:[NSDictionary class]]) {
+            skipped++;
+            continue;
+        }
+        if (*numEvents > 0) {
+            fputs(",\n", output);
+        }
+        fwrite(first, 1, length, output);
+        (*numEvents)++;
+    }
+    if (skipped > 0) {
+        [BPUtils printInfo:WARNING withString:@"Skipped %lu malformed trace events in '%@'", (unsigned long)skipped, [url path]];
+    }
+    return YES;
+}
+
+// All the files with the given extension under path, recursively.
++ (NSArray<NSURL *> *)filesWithExtension:(NSString *)extension underPath:(NSString *)path {
+    NSURL *directoryURL = [NSURL fileURLWithPath:path isDirectory:YES];
     NSArray *keys = [NSArray arrayWithObject:NSURLIsDirectoryKey];
-    NSDirectoryEnumerator *enumerator = [fileManager
+    NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager]
                                          enumeratorAtURL:directoryURL
                                          includingPropertiesForKeys:keys
                                          options:0
@@ -52,56 +204,17 @@
                                              [BPUtils printInfo:ERROR withString:@"Failed to process url %@: %@", url, [error localizedDescription]];
                                              return YES;
                                          }];
-    NSMutableData *traceData = nil;
-    NSMutableArray<BPXMLReport *> *reports = [[NSMutableArray alloc] init];
-
+    NSMutableArray<NSURL *> *files = [[NSMutableArray alloc] init];
     for (NSURL *url in enumerator) {
         NSError *error;
         NSNumber *isDirectory = nil;
         if (![url getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:&error]) {
             [BPUtils printInfo:ERROR withString:@"Failed to get resource from url %@", url];
-        } else if (![isDirectory boolValue]) {
-            if ([[url pathExtension] isEqualToString:@"xml"]) {
-                [BPUtils printInfo:DEBUGINFO withString:@"JUnit collecting: %@", [url path]];
-                NSString *path = [url path];
-                NSDictionary *fileAttrs = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:&error];
-                if (error) {
-                    [BPUtils printInfo:ERROR withString:@"Failed to get attributes for '%@': %@", path, [error localizedDescription]];
-                    continue;
-                }
-                NSDate *mtime = [fileAttrs objectForKey:NSFileModificationDate];
-                BPXMLReport *report = [[BPXMLReport alloc] initWithPath:url andMTime:mtime];
-                [reports addObject:report];
-                continue;
-            }
-            if ([[url pathExtension] isEqualToString:@"json"]) {
-                [BPUtils printInfo:DEBUGINFO withString:@"Collecting trace report: %@", [url path]];
-                NSData *data = [fileManager contentsAtPath:[url path]];
-                if (!traceData) {
-                    traceData = [[NSMutableData alloc] initWithData:[@"[\n" dataUsingEncoding:NSUTF8StringEncoding]];
-                } else {
-                    [traceData appendData:[@"," dataUsingEncoding:NSUTF8StringEncoding]];
-                }
-                [traceData appendData:data];
-                if (deleteCollected) {
-                    [fileManager removeItemAtURL:url error:nil];
-                }
-                continue;
-            }
+        } else if (![isDirectory boolValue] && [[url pathExtension] isEqualToString:extension]) {
+            [files addObject:url];
         }
     }
-    if (traceData) {
-        [traceData appendData:[@"]\n" dataUsingEncoding:NSUTF8StringEncoding]];
-        [traceData writeToFile:traceFilePath atomically:YES];
-        [BPUtils printInfo:INFO withString:@"Trace profile: %@", traceFilePath];
-    }
-    NSXMLDocument *jUnitReport = [self collateReports:reports
-                                    andDeleteCollated:deleteCollected
-                                         withOutputAt:finalReportPath];
-
-    // write a html report
-    [[BPHTMLReportWriter new] writeHTMLReportWithJUnitReport:jUnitReport
-                                                    inFolder:finalReportsDir];
+    return files;
 }
 
 + (NSXMLDocument *)collateReports:(NSMutableArray <BPXMLReport *> *)reports
@@ -115,177 +228,60 @@
         return [first compare:second];
     }]];
 
-    NSXMLDocument *targetReport = [self newEmptyXMLDocumentWithName:@"All tests"];
-
-    for (BPXMLReport *report in sortedReports) {
-        [BPUtils printInfo:DEBUGINFO withString:@"MERGING REPORT: %@", [[report url] path]];
+    // Reports are independent of each other: parse them all at once, then merge them in order.
+    [[BPStats sharedStats] startTimer:@"Parsing JUnit Reports"];
+    NSMutableArray *parsedReports = [[NSMutableArray alloc] initWithCapacity:sortedReports.count];
+    for (NSUInteger i = 0; i < sortedReports.count; i++) {
+        [parsedReports addObject:[NSNull null]];
+    }
+    dispatch_apply(sortedReports.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
         @autoreleasepool {
-            NSError *err = nil;
-            NSXMLDocument *xmlDoc = [[NSXMLDocument alloc] initWithContentsOfURL:[report url] options:NSXMLDocumentTidyXML error:&err];
-            if (err) {
-                [BPUtils printInfo:ERROR withString:@"Failed to parse '%@': %@", [[report url] path], [err localizedDescription]];
-                [BPUtils printInfo:ERROR withString:@"SOME TESTS MIGHT BE MISSING"];
-                continue;
-            }
-            // grab all the test suites
-            for (NSXMLElement *testSuite in [xmlDoc nodesForXPath:@"/testsuites/testsuite" error:nil]) {
-                NSString *testSuiteName = [[testSuite attributeForName:@"name"] stringValue];
-                [BPUtils printInfo:DEBUGINFO withString:@"TestSuite: %@", testSuiteName];
-                NSXMLElement *targetTestSuite = [[targetReport nodesForXPath:[NSString stringWithFormat:@"//testsuite[@name='%@']", testSuiteName] error:nil] firstObject];
-                if (targetTestSuite) {
-                    [self collateTestSuite:testSuite into:targetTestSuite];
-                } else {
-                    NSXMLElement *testSuites = [[targetReport nodesForXPath:@"/testsuites" error:nil] firstObject];
-                    [testSuites addChild:[testSuite copy]];
-                }
-            }
-            // finally, delete the merged report
-            if (deleteCollated) {
-                [[NSFileManager defaultManager] removeItemAtURL:[report url] error:nil];
+            BPJUnitReport *parsedReport = [BPJUnitReport reportWithContentsOfURL:[sortedReports[i] url]];
+            @synchronized (parsedReports) {
+                parsedReports[i] = parsedReport;
             }
         }
-    }
-    // update counts
-    for (NSXMLElement *testSuite in [targetReport nodesForXPath:@"/testsuites/testsuite/testsuite" error:nil]) {
-        [self updateTestCaseCounts:testSuite];
-    }
-    for (NSXMLElement *testSuite in [targetReport nodesForXPath:@"/testsuites/testsuite" error:nil]) {
-        [self updateTestSuiteCounts:testSuite];
-    }
-    [self updateTestSuiteCounts:[[targetReport objectsForXQuery:@"//testsuites" error:nil] firstObject]];
-
-    NSData *xmlData = [targetReport XMLDataWithOptions:NSXMLNodePrettyPrint];
-    [xmlData writeToFile:finalReportPath atomically:YES];
-    return targetReport;
-}
-
-+ (NSXMLDocument *)newEmptyXMLDocumentWithName:(NSString *)name {
-    NSXMLElement *rootElement = [[NSXMLElement alloc] initWithName:@"testsuites"];
-    [rootElement addAttribute:[NSXMLNode attributeWithName:@"name" stringValue:name]];
-    [rootElement addAttribute:[NSXMLNode attributeWithName:@"tests" stringValue:@"0"]];
-    [rootElement addAttribute:[NSXMLNode attributeWithName:@"failures" stringValue:@"0"]];
-    [rootElement addAttribute:[NSXMLNode attributeWithName:@"errors" stringValue:@"0"]];
-    [rootElement addAttribute:[NSXMLNode attributeWithName:@"time" stringValue:@"0.0"]];
-
-    NSXMLDocument *doc = [[NSXMLDocument alloc] initWithRootElement:rootElement];
-    [doc setCharacterEncoding:@"UTF-8"];
-    [doc setVersion:@"1.0"];
-    [doc setStandalone:YES];
-    return doc;
-}
+    });
+    [[BPStats sharedStats] endTimer:@"Parsing JUnit Reports" withResult:@"INFO"];
 
-+ (void) collateTestSuite:(NSXMLElement *)testSuite into:(NSXMLElement *)targetTestSuite {
-    [BPUtils printInfo:DEBUGINFO withString:@"Collating '%@' into '%@'", [[testSuite attributeForName:@"name"] stringValue], [[targetTestSuite attributeForName:@"name"] stringValue]];
-    // testsuite elements must have either all testsuite children or all testcase children
-    NSString *firstChild = [[[testSuite children] firstObject] name];
-    if ([firstChild isEqualToString:@"testsuite"]) {
-        [self collateTestSuiteTestSuites:testSuite into:targetTestSuite];
-    } else if ([firstChild isEqualToString:@"testcase"]) {
-        [self collateTestSuiteTestCases:testSuite into:targetTestSuite];
-    } else if (firstChild) { // empty
-        [BPUtils printInfo:ERROR withString:@"Unknown child node in '%@': %@", [[testSuite attributeForName:@"name"] stringValue],  firstChild];
-        assert(false);
-    }
-}
-
-+ (void)collateTestSuiteTestSuites:(NSXMLElement *)testSuite into:(NSXMLElement *)targetTestSuite {
-    [BPUtils printInfo:DEBUGINFO withString:@"Collating TestSuites under: %@", [[testSuite attributeForName:@"name"]stringValue]];
-    for (NSXMLElement *ts in [testSuite nodesForXPath:@"testsuite" error:nil]) {
-        NSXMLElement *tts = [[targetTestSuite nodesForXPath:[NSString stringWithFormat:@"testsuite[@name='%@']", [[ts attributeForName:@"name"] stringValue]]
-                                                      error:nil] firstObject];
-        if (tts) {
-            [BPUtils printInfo:DEBUGINFO withString:@"match: %@", [[tts attributeForName:@"name"] stringValue]];
-            [self collateTestSuiteTestCases:ts into:tts];
-        } else {
-            [BPUtils printInfo:DEBUGINFO withString:@"inserting: %@", [[ts attributeForName:@"name"] stringValue]];
-            [targetTestSuite addChild:[ts copy]];
+    [[BPStats sharedStats] startTimer:@"Merging JUnit Reports"];
+    BPJUnitMerger *merger = [[BPJUnitMerger alloc] initWithName:@"All tests"];
+    NSUInteger failedReports = 0;
+    for (BPJUnitReport *report in parsedReports) {
+        [BPUtils printInfo:DEBUGINFO withString:@"MERGING REPORT: %@", [[report url] path]];
+        [merger mergeReport:report];
+        if (report.error) {
+            [BPUtils printInfo:ERROR withString:@"Failed to parse '%@': %@", [[report url] path], [report.error localizedDescription]];
+            [BPUtils printInfo:ERROR withString:@"SOME TESTS MIGHT BE MISSING"];
+            failedReports++;
+            continue;
         }
-    }
-}
-
-+ (void)collateTestSuiteTestCases:(NSXMLElement *)testSuite into:(NSXMLElement *)targetTestSuite {
-    [BPUtils printInfo:DEBUGINFO withString:@"Collating TestCases under: %@", [[testSuite attributeForName:@"name"] stringValue]];
-    int testCaseCount = 0;
-    for (NSXMLElement *testCase in [testSuite nodesForXPath:@"testcase" error:nil]) {
-        NSString *className = [[testCase attributeForName:@"classname"] stringValue];
-        NSString *name = [[testCase attributeForName:@"name"] stringValue];
-        NSXMLElement *targetTestCase = [[targetTestSuite nodesForXPath:[NSString stringWithFormat:@"testcase[@name='%@' and @classname='%@']", name, className]
-                                                                 error:nil] firstObject];
-        NSXMLElement *parent;
-        if (targetTestCase) {
-            [BPUtils printInfo:DEBUGINFO withString:@"testcase match: %@", [[targetTestCase attributeForName:@"name"] stringValue]];
-            parent = (NSXMLElement *)[targetTestCase parent];
-            // append the latest result at the end
-            NSUInteger insertIndex;
-            for (insertIndex = [targetTestCase index]; insertIndex < [[parent children] count]; insertIndex++) {
-                NSXMLElement *currentTestCase = (NSXMLElement *)[[parent children] objectAtIndex:insertIndex];
-                NSString *thisName = [[currentTestCase attributeForName:@"name"] stringValue];
-                NSString *thisClassName = [[currentTestCase attributeForName:@"classname"] stringValue];
-                if ([name isNotEqualTo:thisName] || [className isNotEqualTo:thisClassName]) {
-                    break;
-                }
-            }
-            [parent insertChild:[testCase copy] atIndex:insertIndex];
-        } else {
-            [BPUtils printInfo:DEBUGINFO withString:@"testcase insertion: %@", [[testCase attributeForName:@"name"] stringValue]];
-            [targetTestSuite addChild:[testCase copy]];
-            testCaseCount++;
+        // finally, delete the merged report
+        if (deleteCollated) {
+            [[NSFileManager defaultManager] removeItemAtURL:[report url] error:nil];
         }
     }
-    // merge the counts
-    NSXMLNode *testsAttr = [targetTestSuite attributeForName:@"tests"];
-    if (testsAttr) {
-        testCaseCount += [[testsAttr stringValue] intValue];
-    } else {
-        testsAttr = [NSXMLNode attributeWithName:@"tests" stringValue:@"0"];
-        [targetTestSuite addAttribute:testsAttr];
-    }
-    [testsAttr setStringValue:[NSString stringWithFormat:@"%d", testCaseCount]];
-}
-
-+ (void)updateTestCaseCounts:(NSXMLElement *)testSuite {
-    [BPUtils printInfo:DEBUGINFO withString:@"Updating TESTCASE counts: %@", [[testSuite attributeForName:@"name"] stringValue]];
-    NSArray <NSXMLElement *>* testCases = [testSuite nodesForXPath:@"testcase" error:nil];
-    [[testSuite attributeForName:@"tests"] setStringValue:[NSString stringWithFormat:@"%lu", testCases.count]];
+    [BPUtils printInfo:INFO withString:@"Merged %lu test results from %lu reports.",
+     (unsigned long)merger.numTestCases, (unsigned long)parsedReports.count];
+    [[BPStats sharedStats] addCounter:@"JUnit Reports" withValues:@{@"reports": @(parsedReports.count),
+                                                                    @"failed": @(failedReports),
+                                                                    @"testcases": @(merger.numTestCases)}];
 
-    unsigned long failureCount = 0;
-    unsigned long errorCount = 0;
-    double totalTime = 0.0;
-    for (NSXMLElement *testCase in testCases) {
-        NSArray *failures = [testCase nodesForXPath:@"failure" error:nil];
-        if ([failures count] > 0) {
-            failureCount++;
-        }
-        NSArray *errors = [testCase nodesForXPath:@"error" error:nil];
-        if ([errors count] > 0) {
-            errorCount++;
-        }
-        totalTime += [[[testCase attributeForName:@"time"] stringValue] doubleValue];
+    NSError *err = nil;
+    BOOL written = [merger writeToFile:finalReportPath withError:&err];
+    [[BPStats sharedStats] endTimer:@"Merging JUnit Reports" withResult:written ? @"INFO" : @"ERROR"];
+    if (!written) {
+        [BPUtils printInfo:ERROR withString:@"Failed to write '%@': %@", finalReportPath, [err localizedDescription]];
+        return nil;
     }
-    [BPUtils printInfo:DEBUGINFO withString:@"tests: %lu, failures: %lu, errors: %lu, time: %f", testCases.count, failureCount, errorCount, totalTime];
-    [[testSuite attributeForName:@"failures"] setStringValue:[NSString stringWithFormat:@"%lu", failureCount]];
-    [[testSuite attributeForName:@"errors"] setStringValue:[NSString stringWithFormat:@"%lu", errorCount]];
-    [[testSuite attributeForName:@"time"] setStringValue:[NSString stringWithFormat:@"%f", totalTime]];
-}
-
-+ (void)updateTestSuiteCounts:(NSXMLElement *)testSuites {
-    [BPUtils printInfo:DEBUGINFO withString:@"Updating TESTSUITE counts: %@", [[testSuites attributeForName:@"name"] stringValue]];
-    NSArray *allTestSuites = [testSuites nodesForXPath:@"testsuite" error:nil];
-    unsigned long testCount = 0;
-    unsigned long failureCount = 0;
-    unsigned long errorCount = 0;
-    double totalTime = 0.0;
-    for (NSXMLElement *testSuite in allTestSuites) {
-        testCount  += [[[testSuite attributeForName:@"tests"] stringValue] intValue];
-        failureCount += [[[testSuite attributeForName:@"failures"] stringValue] intValue];
-        errorCount += [[[testSuite attributeForName:@"errors"] stringValue] intValue];
-        totalTime += [[[testSuite attributeForName:@"time"] stringValue] doubleValue];
+    // The HTML report still walks the whole merged report in memory.
+    NSXMLDocument *targetReport = [[NSXMLDocument alloc] initWithContentsOfURL:[NSURL fileURLWithPath:finalReportPath]
+                                                                        options:0
+                                                                          error:&err];
+    if (!targetReport) {
+        [BPUtils printInfo:ERROR withString:@"Failed to parse '%@': %@", finalReportPath, [err localizedDescription]];
     }
-    [BPUtils printInfo:DEBUGINFO withString:@"tests: %lu, failures: %lu, errors: %lu, time: %f", testCount, failureCount, errorCount, totalTime];
-    [[testSuites attributeForName:@"tests"] setStringValue:[NSString stringWithFormat:@"%lu", testCount]];
-    [[testSuites attributeForName:@"failures"] setStringValue:[NSString stringWithFormat:@"%lu", failureCount]];
-    [[testSuites attributeForName:@"errors"] setStringValue:[NSString stringWithFormat:@"%lu", errorCount]];
-    [[testSuites attributeForName:@"time"] setStringValue:[NSString stringWithFormat:@"%f", totalTime]];
+    return targetReport;
 }
 
 @end
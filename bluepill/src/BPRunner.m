@@ -17,6 +17,7 @@
 #import "BPPacker.h"
 #import "BPRunner.h"
 #import "BPSwimlane.h"
+#import "BPTestQueue.h"
 
 #include <mach/mach.h>
 #include <mach/mach_host.h>
@@ -59,7 +60,7 @@ maxprocs(void)
 
 + (instancetype)BPRunnerWithConfig:(BPConfiguration *)config
                         withBpPath:(NSString *)bpPath {
-    BPRunner *runner = [[BPRunner alloc] init];
+    BPRunner *runner = [[self alloc] init];
     runner.testHostSimTemplates = [[NSMutableDictionary alloc] init];
     runner.config = config;
     runner.bpExecutable = bpPath ?: [BPUtils findExecutablePath:@"bp"];
@@ -127,16 +128,32 @@ maxprocs(void)
     NSUInteger numSims = [self.config.numSims intValue];
     [BPUtils printInfo:INFO withString:@"This is Bluepill %s", [BPUtils version]];
     NSError *error;
-    NSMutableArray<BPXCTestFile *> *bundles = [[BPPacker packTests:xcTestFiles configuration:self.config andError:&error] mutableCopy];
-    if (!bundles || bundles.count == 0) {
-        [BPUtils printInfo:ERROR withString:@"Packing failed: %@", [error localizedDescription]];
-        return 1;
-    }
-    if (bundles.count < numSims) {
-        [BPUtils printInfo:WARNING
-                withString:@"Lowering number of parallel simulators from %lu to %lu because there aren't enough test bundles.",
-                            numSims, bundles.count];
-        numSims = bundles.count;
+    NSMutableArray<BPXCTestFile *> *bundles;
+    BPTestQueue *queue;
+    if (self.config.dynamicScheduling) {
+        queue = [BPTestQueue queueWithXCTestFiles:xcTestFiles configuration:self.config andError:&error];
+        if (!queue) {
+            [BPUtils printInfo:ERROR withString:@"Queueing tests failed: %@", [error localizedDescription]];
+            return 1;
+        }
+        if (queue.numTests < numSims) {
+            [BPUtils printInfo:WARNING
+                    withString:@"Lowering number of parallel simulators from %lu to %lu because there aren't enough tests.",
+                                numSims, queue.numTests];
+            numSims = queue.numTests;
+        }
+    } else {
+        bundles = [[BPPacker packTests:xcTestFiles configuration:self.config andError:&error] mutableCopy];
+        if (!bundles || bundles.count == 0) {
+            [BPUtils printInfo:ERROR withString:@"Packing failed: %@", [error localizedDescription]];
+            return 1;
+        }
+        if (bundles.count < numSims) {
+            [BPUtils printInfo:WARNING
+                    withString:@"Lowering number of parallel simulators from %lu to %lu because there aren't enough test bundles.",
+                                numSims, bundles.count];
+            numSims = bundles.count;
+        }
     }
     if (self.config.cloneSimulator) {
         self.testHostSimTemplates = [bpSimulator createSimulatorAndInstallAppWithBundles:xcTestFiles];
@@ -146,11 +163,13 @@ maxprocs(void)
     }
     [BPUtils printInfo:INFO withString:@"Running with %lu %s.",
      (unsigned long)numSims, (numSims > 1) ? "parallel simulators" : "simulator"];
-    NSArray *copyBundles = [bundles copy];
-    for (int i = 1; i < [self.config.repeatTestsCount integerValue]; i++) {
-        [bundles addObjectsFromArray:copyBundles];
+    if (bundles) {
+        NSArray *copyBundles = [bundles copy];
+        for (int i = 1; i < [self.config.repeatTestsCount integerValue]; i++) {
+            [bundles addObjectsFromArray:copyBundles];
+        }
+        [BPUtils printInfo:INFO withString:@"Packed tests into %lu bundles", (unsigned long)[bundles count]];
     }
-    [BPUtils printInfo:INFO withString:@"Packed tests into %lu bundles", (unsigned long)[bundles count]];
     NSUInteger taskNumber = 0;
     __block int rc = 0;
 
@@ -161,8 +180,13 @@ maxprocs(void)
     }
 
     int maxProcs = maxprocs();
-    int seconds = 0;
-    __block NSMutableArray *deviceList = [[NSMutableArray alloc] init];
+    // Booted simulators handed back by bp, by the app they have installed, and how many bundles each has run.
+    // There are never more of them than swimlanes.
+    NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *devicePool = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary<NSString *, NSNumber *> *deviceUses = [[NSMutableDictionary alloc] init];
+    NSInteger maxSimulatorReuse = [self.config.maxSimulatorReuse integerValue];
+    // A swimlane is idle before its completion block has returned the simulator to the pool.
+    dispatch_group_t completions = dispatch_group_create();
     int old_interrupted = interrupted;
     NSRunningApplication *app;
     if (_config.headlessMode == NO) {
@@ -172,6 +196,29 @@ maxprocs(void)
             return -1;
         }
     }
+    // The loop below only wakes up when a bp finishes or an interrupt arrives.
+    dispatch_semaphore_t wakeup = dispatch_semaphore_create(0);
+    NSMutableArray<dispatch_source_t> *signalSources = [[NSMutableArray alloc] init];
+    for (NSNumber *sig in @[@(SIGINT), @(SIGTERM), @(SIGHUP)]) {
+        // The source counts the signals while the loop runs. If onInterrupt counted them, the loop could
+        // wake up before it did and go back to sleep without noticing the interrupt.
+        dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, [sig unsignedLongValue], 0,
+                                                          dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0));
+        dispatch_source_set_event_handler(source, ^{
+            interrupted += dispatch_source_get_data(source);
+            dispatch_semaphore_signal(wakeup);
+        });
+        dispatch_resume(source);
+        [signalSources addObject:source];
+        signal([sig intValue], SIG_IGN);
+    }
+    dispatch_queue_t timerQueue = dispatch_queue_create("com.linkedin.bluepill.runner.timers", DISPATCH_QUEUE_SERIAL);
+    dispatch_source_t countersTimer = [self newTimerWithInterval:1 onQueue:timerQueue handler:^{
+        [self addCounters];
+    }];
+    dispatch_source_t statusTimer = [self newTimerWithInterval:30 onQueue:timerQueue handler:^{
+        [self reportStatusWithMaxProcs:maxProcs];
+    }];
     while (1) {
         if (interrupted) {
             if (interrupted >=5) {
@@ -192,69 +239,88 @@ maxprocs(void)
             noLaunchedTasks = (busySwimlaneCount == 0);
             canLaunchTask = (busySwimlaneCount < numSims);
         }
-        if (noLaunchedTasks && (bundles.count == 0 || interrupted)) break;
-        if (bundles.count > 0 && canLaunchTask && !interrupted) {
+        BOOL hasWork = queue ? (queue.numTests > 0) : (bundles.count > 0);
+        if (noLaunchedTasks && (!hasWork || interrupted)) break;
+        // Fill every idle swimlane at once.
+        while (hasWork && canLaunchTask && !interrupted) {
             NSString *deviceID = nil;
             BPSwimlane *swimlane = nil;
+            BPXCTestFile *bundle = queue ? [queue nextBundle] : [bundles objectAtIndex:0];
+            NSString *appPath = bundle.UITargetAppPath ?: bundle.testHostPath;
             @synchronized(self) {
-                if ([deviceList count] > 0) {
-                    deviceID = [deviceList objectAtIndex:0];
-                    [deviceList removeObjectAtIndex:0];
+                NSMutableArray<NSString *> *devices = devicePool[appPath];
+                if ([devices count] > 0) {
+                    deviceID = [devices lastObject];
+                    [devices removeLastObject];
                 }
                 swimlane = [self firstIdleSwimlane];
                 swimlane.isBusy = YES;
             }
-            BPXCTestFile *bundle = [bundles objectAtIndex:0];
+            dispatch_group_enter(completions);
             [swimlane launchTaskWithBundle:bundle
                                  andConfig:self.config
                              andLaunchPath:self.bpExecutable
                                  andNumber:++taskNumber
                                  andDevice:deviceID
                         andTemplateSimUDID:self.testHostSimTemplates[bundle.testHostPath]
-                        andCompletionBlock:^(NSTask * _Nonnull task) {
+                        andCompletionBlock:^(NSTask * _Nonnull task, NSString *keptDeviceID) {
                 @synchronized (self) {
                     rc = (rc || [task terminationStatus]);
                 };
                 [BPUtils printInfo:INFO withString:@"PID %d exited %d.", [task processIdentifier], [task terminationStatus]];
                 rc = (rc || [task terminationStatus]);
+                if (keptDeviceID) {
+                    [self returnDevice:keptDeviceID
+                            usedBefore:[deviceID isEqualToString:keptDeviceID]
+                             forAppPath:appPath
+                                toPool:devicePool
+                              withUses:deviceUses
+                              maxReuse:maxSimulatorReuse
+                              poolSize:numSims];
+                }
+                // The swimlane is idle again by now.
+                dispatch_semaphore_signal(wakeup);
+                dispatch_group_leave(completions);
             }];
-            @synchronized(self) {
-                [bundles removeObjectAtIndex:0];
+            if (bundles) {
+                @synchronized(self) {
+                    [bundles removeObjectAtIndex:0];
+                }
             }
-        }
-        sleep(1);
-        if (seconds % 30 == 0) {
-            NSString *listString;
-            NSUInteger launchedTasks = 0;
             @synchronized (self) {
-                NSMutableArray *taskNumberList = [[NSMutableArray alloc] init];
-                for (BPSwimlane *swimlane in self.swimlaneList) {
-                    if (swimlane.isBusy) {
-                        launchedTasks++;
-                        [taskNumberList addObject:[NSString stringWithFormat:@"%lu", swimlane.taskNumber]];
-                    }
-                }
-                listString = [taskNumberList componentsJoinedByString:@", "];
+                canLaunchTask = ([self busySwimlaneCount] < numSims);
             }
-            [BPUtils printInfo:INFO withString:@"%lu BP(s) still running. [%@]", launchedTasks, listString];
-            [BPUtils printInfo:INFO withString:@"Using %d of %d processes.", numprocs(), maxProcs];
-            if (numprocs() > maxProcs * BP_MAX_PROCESSES_PERCENT) {
-                [BPUtils printInfo:WARNING withString:@"!!!The number of processes is more than  %f percent of maxProcs!!! it may fail with error: Unable to boot device due to insufficient system resources. Please check with system admin to restart this node and for proper mainantance routine", BP_MAX_PROCESSES_PERCENT*100];
-                NSDateFormatter *dateFormatter=[[NSDateFormatter alloc] init];
-                [dateFormatter setDateFormat:@"yyyy-MM-dd_HH-mm-ss"];
-                NSString *psLogFile = [NSString stringWithFormat:@"%@/allProcesses_%@.txt", self.config.outputDirectory, [dateFormatter stringFromDate:[NSDate date]]];
-                [BPUtils printInfo:INFO withString:@"saving 'ps aux' command log to: %@", psLogFile];
-                [BPUtils runShell:[NSString stringWithFormat:@"/bin/ps aux >> %@", psLogFile]];
+            hasWork = queue ? (queue.numTests > 0) : (bundles.count > 0);
+        }
+        // Simulators for apps that have no bundles left won't be used again.
+        NSMutableSet<NSString *> *pendingAppPaths = [[NSMutableSet alloc] init];
+        if (queue) {
+            [pendingAppPaths unionSet:[queue pendingAppPaths]];
+        } else {
+            for (BPXCTestFile *bundle in bundles) {
+                [pendingAppPaths addObject:bundle.UITargetAppPath ?: bundle.testHostPath];
             }
         }
-        seconds += 1;
-        [self addCounters];
+        [self evictIdleDevicesFromPool:devicePool withUses:deviceUses keepingAppPaths:pendingAppPaths];
+        dispatch_semaphore_wait(wakeup, DISPATCH_TIME_FOREVER);
+    }
+    dispatch_source_cancel(statusTimer);
+    dispatch_source_cancel(countersTimer);
+    for (dispatch_source_t source in signalSources) {
+        dispatch_source_cancel(source);
+    }
+    for (NSNumber *sig in @[@(SIGINT), @(SIGTERM), @(SIGHUP)]) {
+        sigaction([sig intValue], &new_action, NULL);
     }
 
-    for (int i = 0; i < [deviceList count]; i++) {
-        NSTask *task = [self newTaskToDeleteDevice:[deviceList objectAtIndex:i] andNumber:i+1];
-        [task launch];
-        //fire & forget, DON'T WAIT
+    dispatch_group_wait(completions, DISPATCH_TIME_FOREVER);
+    NSUInteger deviceNumber = 0;
+    for (NSArray<NSString *> *devices in [devicePool allValues]) {
+        for (NSString *deviceID in devices) {
+            NSTask *task = [self newTaskToDeleteDevice:deviceID andNumber:++deviceNumber];
+            [task launch];
+            //fire & forget, DON'T WAIT
+        }
     }
 
     [BPUtils printInfo:INFO withString:@"All BPs have finished."];
@@ -269,6 +335,115 @@ maxprocs(void)
     return rc;
 }
 
+// Put a simulator kept by bp back in the pool for the next bundle of the same app, unless it
+// has been reused enough, isn't healthy anymore or the pool is full, in which case it's deleted.
+- (void)returnDevice:(NSString *)deviceID
+          usedBefore:(BOOL)usedBefore
+          forAppPath:(NSString *)appPath
+              toPool:(NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *)devicePool
+            withUses:(NSMutableDictionary<NSString *, NSNumber *> *)deviceUses
+            maxReuse:(NSInteger)maxReuse
+            poolSize:(NSUInteger)poolSize {
+    NSUInteger uses;
+    @synchronized (self) {
+        uses = (usedBefore ? [deviceUses[deviceID] unsignedIntegerValue] : 0) + 1;
+        deviceUses[deviceID] = @(uses);
+    }
+    BOOL healthy = [self isDeviceHealthy:deviceID forAppPath:appPath];
+    BOOL pooled = NO;
+    if (uses <= maxReuse && healthy) {
+        @synchronized (self) {
+            NSUInteger pooledDevices = 0;
+            for (NSArray<NSString *> *devices in [devicePool allValues]) {
+                pooledDevices += devices.count;
+            }
+            if (pooledDevices < poolSize) {
+                if (!devicePool[appPath]) {
+                    devicePool[appPath] = [[NSMutableArray alloc] init];
+                }
+                [devicePool[appPath] addObject:deviceID];
+                pooled = YES;
+            }
+        }
+    }
+    if (!pooled) {
+        NSString *reason = !healthy ? @", it is not healthy" : (uses > maxReuse ? @"" : @", the pool is full");
+        [BPUtils printInfo:INFO withString:@"Evicting simulator %@ after %lu bundles%@.",
+         deviceID, (unsigned long)uses, reason];
+        @synchronized (self) {
+            [deviceUses removeObjectForKey:deviceID];
+        }
+        [[self newTaskToDeleteDevice:deviceID andNumber:uses] launch];
+    }
+}
+
+// Delete the pooled simulators of every app but the given ones.
+- (void)evictIdleDevicesFromPool:(NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *)devicePool
+                        withUses:(NSMutableDictionary<NSString *, NSNumber *> *)deviceUses
+                 keepingAppPaths:(NSSet<NSString *> *)appPaths {
+    NSMutableArray<NSString *> *idleDevices = [[NSMutableArray alloc] init];
+    @synchronized (self) {
+        for (NSString *appPath in [devicePool allKeys]) {
+            if (![appPaths containsObject:appPath]) {
+                [idleDevices addObjectsFromArray:devicePool[appPath]];
+                [devicePool removeObjectForKey:appPath];
+            }
+        }
+        [deviceUses removeObjectsForKeys:idleDevices];
+    }
+    for (NSString *deviceID in idleDevices) {
+        [BPUtils printInfo:INFO withString:@"Evicting simulator %@, its app has no bundles left.", deviceID];
+        [[self newTaskToDeleteDevice:deviceID andNumber:0] launch];
+    }
+}
+
+// A simulator can be handed out again if it still exists, is booted and bp uninstalled the app from it.
+- (BOOL)isDeviceHealthy:(NSString *)deviceID forAppPath:(NSString *)appPath {
+    NSUUID *uuid = [[NSUUID alloc] initWithUUIDString:deviceID];
+    BPConfiguration *config = [self.config copy];
+    config.appBundlePath = appPath;
+    BPSimulator *simulator = [BPSimulator simulatorWithConfiguration:config];
+    return uuid && [simulator useSimulatorWithDeviceUDID:uuid] && ![simulator isApplicationInstalled];
+}
+
+- (dispatch_source_t)newTimerWithInterval:(NSTimeInterval)interval
+                                   onQueue:(dispatch_queue_t)queue
+                                   handler:(dispatch_block_t)handler {
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+    dispatch_source_set_timer(timer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+                              (uint64_t)(interval * NSEC_PER_SEC),
+                              (uint64_t)(interval * NSEC_PER_SEC / 10));
+    dispatch_source_set_event_handler(timer, handler);
+    dispatch_resume(timer);
+    return timer;
+}
+
+- (void)reportStatusWithMaxProcs:(int)maxProcs {
+    NSString *listString;
+    NSUInteger launchedTasks = 0;
+    @synchronized (self) {
+        NSMutableArray *taskNumberList = [[NSMutableArray alloc] init];
+        for (BPSwimlane *swimlane in self.swimlaneList) {
+            if (swimlane.isBusy) {
+                launchedTasks++;
+                [taskNumberList addObject:[NSString stringWithFormat:@"%lu", swimlane.taskNumber]];
+            }
+        }
+        listString = [taskNumberList componentsJoinedByString:@", "];
+    }
+    [BPUtils printInfo:INFO withString:@"%lu BP(s) still running. [%@]", launchedTasks, listString];
+    [BPUtils printInfo:INFO withString:@"Using %d of %d processes.", numprocs(), maxProcs];
+    if (numprocs() > maxProcs * BP_MAX_PROCESSES_PERCENT) {
+        [BPUtils printInfo:WARNING withString:@"!!!The number of processes is more than  %f percent of maxProcs!!! it may fail with error: Unable to boot device due to insufficient system resources. Please check with system admin to restart this node and for proper mainantance routine", BP_MAX_PROCESSES_PERCENT*100];
+        NSDateFormatter *dateFormatter=[[NSDateFormatter alloc] init];
+        [dateFormatter setDateFormat:@"yyyy-MM-dd_HH-mm-ss"];
+        NSString *psLogFile = [NSString stringWithFormat:@"%@/allProcesses_%@.txt", self.config.outputDirectory, [dateFormatter stringFromDate:[NSDate date]]];
+        [BPUtils printInfo:INFO withString:@"saving 'ps aux' command log to: %@", psLogFile];
+        [BPUtils runShell:[NSString stringWithFormat:@"/bin/ps aux >> %@", psLogFile]];
+    }
+}
+
 - (void)interrupt {
     if (self.swimlaneList == nil) return;
 
@@ -28,7 +28,9 @@
  * @param bundle The test bundle to execute.
  * @param config The BPConfiguration of the BPRunner.
  * @param number The simulator number (will be printed in logs). *
- * @param block A completion block to execute when the NSTask has finished.
+ * @param deviceID A booted simulator to reuse instead of creating one, or nil.
+ * @param block A completion block to execute when the NSTask has finished. When config.maxSimulatorReuse
+ * is set, it also gets the UDID of the simulator `bp` kept for the next bundle, if any.
  *
  */
 - (void)launchTaskWithBundle:(BPXCTestFile *)bundle
@@ -37,7 +39,7 @@
                    andNumber:(NSUInteger)number
                    andDevice:(NSString *)deviceID
           andTemplateSimUDID:(NSString *)templateSimUDID
-          andCompletionBlock:(void (^)(NSTask *))block;
+          andCompletionBlock:(void (^)(NSTask *task, NSString *keptDeviceID))block;
 
 - (void)interrupt;
 
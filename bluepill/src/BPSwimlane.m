@@ -31,7 +31,7 @@
                    andNumber:(NSUInteger)number
                    andDevice:(NSString *)deviceID
           andTemplateSimUDID:(NSString *)templateSimUDID
-          andCompletionBlock:(void (^)(NSTask *))block {
+          andCompletionBlock:(void (^)(NSTask *task, NSString *keptDeviceID))block {
     self.isBusy = YES;
     self.taskNumber = number;
 
@@ -73,6 +73,14 @@
                            stringByAppendingPathComponent:
                            [NSString stringWithFormat:@"BP-%lu", (unsigned long)number]];
     cfg.testTimeEstimatesJsonFile = config.testTimeEstimatesJsonFile;
+    NSString *handoffFile;
+    if ([config.maxSimulatorReuse integerValue] > 0) {
+        // Have bp keep a healthy simulator and tell us which one it is.
+        handoffFile = [BPUtils mkstemp:[tmpFileName stringByAppendingString:@"-handoff"] withError:&err];
+        cfg.keepSimulator = handoffFile != nil;
+        cfg.simulatorHandoffFile = handoffFile;
+        cfg.reuseSimUDID = deviceID;
+    }
     [cfg printConfig];
 
     NSTask *task = [[NSTask alloc] init];
@@ -89,9 +97,15 @@
 
         [[NSFileManager defaultManager] removeItemAtPath:cfg.configOutputFile
                                                    error:nil];
+        NSString *keptDeviceID;
+        if (handoffFile) {
+            keptDeviceID = [[NSString stringWithContentsOfFile:handoffFile encoding:NSUTF8StringEncoding error:nil]
+                            stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+            [[NSFileManager defaultManager] removeItemAtPath:handoffFile error:nil];
+        }
         [BPUtils printInfo:INFO withString:@"BP-%lu (PID %u) has finished with exit code %d.",
                                             number, [task processIdentifier], [task terminationStatus]];
-        block(task);
+        block(task, keptDeviceID.length > 0 ? keptDeviceID : nil);
     }];
 
     if (!task) {
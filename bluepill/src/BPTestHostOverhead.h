@@ -0,0 +1,29 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/*!
+ Learns how long it takes before a bundle's first test starts, per test host.
+
+ Every bp process records "[Attempt N] Create Simulator" (or "Clone Simulator"), "Install Application"
+ and "Launch Application" timers in its stats, labelled with the test host it ran. For each attempt the
+ overhead is the create/clone and install time plus the time from the launch to the first test suite.
+ */
+@interface BPTestHostOverhead : NSObject
+
+/*!
+ @discussion Read the per-test-host overhead out of the stats of an earlier run.
+ @param path The trace-profile.json written by the report collector, or a single bp stats file.
+ @param errPtr Set if the file can't be read or isn't a trace.
+ @return A mapping of test host name (e.g. BPSampleApp.app) to its median overhead in seconds.
+ */
++ (NSDictionary<NSString *, NSNumber *> *)overheadsFromStatsFile:(NSString *)path withError:(NSError **)errPtr;
+
+@end
@@ -0,0 +1,134 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPTestHostOverhead.h"
+#import "bp/src/BPUtils.h"
+
+// What happened during one attempt of one bp process, in microseconds.
+@interface BPAttemptTimes : NSObject
+@property (nonatomic, assign) double setup;
+@property (nonatomic, assign) double launchStart;
+@property (nonatomic, assign) double firstTestStart;
+@end
+
+@implementation BPAttemptTimes
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _launchStart = -1;
+        _firstTestStart = -1;
+    }
+    return self;
+}
+
+@end
+
+@implementation BPTestHostOverhead
+
++ (NSDictionary<NSString *, NSNumber *> *)overheadsFromStatsFile:(NSString *)path withError:(NSError **)errPtr {
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:errPtr];
+    if (!data) {
+        return nil;
+    }
+    // A single bp stats file is a comma separated list of events without the enclosing brackets.
+    const char *bytes = data.bytes;
+    NSUInteger start = 0;
+    while (start < data.length && isspace(bytes[start])) {
+        start++;
+    }
+    if (start == data.length || bytes[start] != '[') {
+        NSMutableData *wrapped = [NSMutableData dataWithBytes:"[" length:1];
+        [wrapped appendData:data];
+        [wrapped appendBytes:"]" length:1];
+        data = wrapped;
+    }
+    NSArray *events = [NSJSONSerialization JSONObjectWithData:data options:0 error:errPtr];
+    if (![events isKindOfClass:[NSArray class]]) {
+        BP_SET_ERROR(errPtr, @"%@ is not a trace profile.", path);
+        return nil;
+    }
+
+    NSRegularExpression *stepRegex = [NSRegularExpression regularExpressionWithPattern:@"^\\[Attempt (\\d+)\\] (.+)$" options:0 error:nil];
+    NSSet *setupSteps = [NSSet setWithObjects:@"Create Simulator", @"Clone Simulator", @"Install Application", nil];
+    NSSet *otherSteps = [NSSet setWithObjects:@"Reuse Simulator", @"Uninstall Application", @"Delete Simulator", @"Delete Simulator due to BAD STATE", nil];
+    NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *samples = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary<NSString *, BPAttemptTimes *> *attempts = [[NSMutableDictionary alloc] init];
+    NSString *testHost = nil;
+
+    // Each process's stats start with its thread_name event, so the events in between belong to one process.
+    for (NSDictionary *event in [events arrayByAddingObject:@{@"name": @"thread_name", @"ph": @"M"}]) {
+        if (![event isKindOfClass:[NSDictionary class]] || ![event[@"name"] isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        NSString *name = event[@"name"];
+        if ([event[@"ph"] isEqual:@"M"]) {
+            if ([name isEqualToString:@"thread_name"]) {
+                [self addSamplesFromAttempts:attempts ofTestHost:testHost to:samples];
+                [attempts removeAllObjects];
+                testHost = nil;
+            } else if ([name isEqualToString:@"process_labels"] && [event[@"args"] isKindOfClass:[NSDictionary class]]) {
+                testHost = event[@"args"][@"labels"];
+            }
+            continue;
+        }
+        if (![event[@"ph"] isEqual:@"X"] || ![event[@"ts"] isKindOfClass:[NSNumber class]]) {
+            continue;
+        }
+        NSTextCheckingResult *match = [stepRegex firstMatchInString:name options:0 range:NSMakeRange(0, name.length)];
+        if (!match) {
+            continue;
+        }
+        NSString *attempt = [name substringWithRange:[match rangeAtIndex:1]];
+        NSString *step = [name substringWithRange:[match rangeAtIndex:2]];
+        BPAttemptTimes *times = attempts[attempt];
+        if (!times) {
+            times = [[BPAttemptTimes alloc] init];
+            attempts[attempt] = times;
+        }
+        double ts = [event[@"ts"] doubleValue];
+        if ([setupSteps containsObject:step]) {
+            times.setup += [event[@"dur"] doubleValue];
+        } else if ([step isEqualToString:@"Launch Application"]) {
+            times.launchStart = ts;
+        } else if (![otherSteps containsObject:step]) {
+            // Anything else is a test suite or a test case.
+            if (times.firstTestStart < 0 || ts < times.firstTestStart) {
+                times.firstTestStart = ts;
+            }
+        }
+    }
+
+    NSMutableDictionary<NSString *, NSNumber *> *overheads = [[NSMutableDictionary alloc] init];
+    for (NSString *host in samples) {
+        NSArray<NSNumber *> *sorted = [samples[host] sortedArrayUsingSelector:@selector(compare:)];
+        overheads[host] = sorted[sorted.count / 2];
+    }
+    return overheads;
+}
+
++ (void)addSamplesFromAttempts:(NSDictionary<NSString *, BPAttemptTimes *> *)attempts
+                    ofTestHost:(NSString *)testHost
+                            to:(NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *)samples {
+    if (![testHost isKindOfClass:[NSString class]]) {
+        return;
+    }
+    for (NSString *attempt in attempts) {
+        BPAttemptTimes *times = attempts[attempt];
+        // Attempts that never got as far as running a test say nothing about the usual overhead.
+        if (times.setup <= 0 || times.launchStart < 0 || times.firstTestStart < times.launchStart) {
+            continue;
+        }
+        if (!samples[testHost]) {
+            samples[testHost] = [[NSMutableArray alloc] init];
+        }
+        [samples[testHost] addObject:[NSNumber numberWithDouble:(times.setup + times.firstTestStart - times.launchStart) / 1000000.0]];
+    }
+}
+
+@end
@@ -0,0 +1,52 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "bp/src/BPConfiguration.h"
+#import "bp/src/BPXCTestFile.h"
+
+/*!
+ A central queue of the tests left to run, used instead of packing every test into bundles up front.
+
+ Whenever a swimlane goes idle it asks for the next bundle, made of a batch of tests from the
+ .xctest bundle with the most estimated time left. Batches are sized to a fraction of all the work
+ left (guided self-scheduling), but never smaller than the per-bundle overhead: the first batches are
+ large, and the tail is handed out in ever smaller pieces so that the simulators finish together.
+ Tests within a bundle are handed out longest first. Bundles listed in `noSplit` are handed out whole.
+ */
+@interface BPTestQueue : NSObject
+
+// Number of tests not handed out yet.
+@property (nonatomic, assign, readonly) NSUInteger numTests;
+
+/*!
+ @discussion Queue the tests of a series of .xctest bundles, config.repeatTestsCount times.
+ @param xcTestFiles The .xctest bundles to run.
+ @param config The configuration of this bluepill-runner. The test time estimates are read from
+ testTimeEstimatesJsonFile or testTimeStoreFile when set.
+ @param errPtr Set if there's nothing to run or the test time estimates can't be read.
+ @return The queue or nil.
+ */
++ (instancetype)queueWithXCTestFiles:(NSArray<BPXCTestFile *> *)xcTestFiles
+                       configuration:(BPConfiguration *)config
+                            andError:(NSError **)errPtr;
+
+/*!
+ @discussion Take the next batch of tests off the queue. Safe to call from any thread.
+ @return A copy of an .xctest bundle skipping every test but the batch, or nil once the queue is empty.
+ */
+- (BPXCTestFile *)nextBundle;
+
+/*!
+ @discussion The apps under test of the .xctest bundles that still have tests queued. Safe to call from any thread.
+ @return The UITargetAppPath, or else the testHostPath, of each of those bundles.
+ */
+- (NSSet<NSString *> *)pendingAppPaths;
+
+@end
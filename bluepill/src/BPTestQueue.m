@@ -0,0 +1,176 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "bp/src/BPUtils.h"
+#import "BPPacker.h"
+#import "BPTestQueue.h"
+#import "BPTestTimeStore.h"
+
+// The tests of one .xctest bundle that haven't been handed out yet.
+@interface BPQueuedBundle : NSObject
+@property (nonatomic, strong) BPXCTestFile *xctFile;
+// Longest first.
+@property (nonatomic, strong) NSMutableArray<NSString *> *pendingTests;
+@property (nonatomic, assign) double remainingTime;
+@property (nonatomic, assign) BOOL splittable;
+@end
+
+@implementation BPQueuedBundle
+@end
+
+@interface BPTestQueue ()
+@property (nonatomic, strong) NSArray<BPQueuedBundle *> *queuedBundles;
+@property (nonatomic, strong) NSDictionary<NSString *, NSNumber *> *estimates;
+@property (nonatomic, assign, readwrite) NSUInteger numTests;
+@property (nonatomic, assign) double remainingTime;
+@property (nonatomic, assign) double minBatchTime;
+@property (nonatomic, assign) NSUInteger numSims;
+@end
+
+@implementation BPTestQueue
+
++ (instancetype)queueWithXCTestFiles:(NSArray<BPXCTestFile *> *)xcTestFiles
+                       configuration:(BPConfiguration *)config
+                            andError:(NSError **)errPtr {
+    NSDictionary<NSString *, NSNumber *> *testTimes;
+    if (config.testTimeEstimatesJsonFile) {
+        testTimes = [BPUtils loadSimpleJsonFile:config.testTimeEstimatesJsonFile withError:errPtr];
+        if (!testTimes) {
+            return nil;
+        }
+    } else if (config.testTimeStoreFile) {
+        NSError *error;
+        testTimes = [BPTestTimeStore estimatesFromStoreAtPath:config.testTimeStoreFile withError:&error];
+        if (!testTimes) {
+            [BPUtils printInfo:INFO withString:@"No test time estimates available yet: %@", [error localizedDescription]];
+        }
+    }
+    // Without any estimates every test counts as one second, like the overhead.
+    double defaultTime = [BPPacker defaultTestTimeWithConfig:config testTimes:testTimes];
+    if (defaultTime <= 0.0) {
+        defaultTime = 1.0;
+    }
+
+    NSDictionary<NSString *, NSSet *> *testsToRunByFilePath = [BPUtils getTestsToRunByFilePathWithConfig:config
+                                                                                          andXCTestFiles:xcTestFiles];
+    NSMutableDictionary<NSString *, NSNumber *> *estimates = [[NSMutableDictionary alloc] init];
+    NSMutableArray<BPQueuedBundle *> *queuedBundles = [[NSMutableArray alloc] init];
+    NSUInteger repeatCount = MAX(1, [config.repeatTestsCount integerValue]);
+    for (NSUInteger i = 0; i < repeatCount; i++) {
+        for (BPXCTestFile *xctFile in xcTestFiles) {
+            NSSet *bundleTestsToRun = testsToRunByFilePath[xctFile.testBundlePath];
+            if (bundleTestsToRun.count == 0) {
+                continue;
+            }
+            BPQueuedBundle *queuedBundle = [[BPQueuedBundle alloc] init];
+            queuedBundle.xctFile = xctFile;
+            queuedBundle.splittable = ![config.noSplit containsObject:[xctFile name]];
+            for (NSString *test in bundleTestsToRun) {
+                NSNumber *estimate = testTimes[test];
+                if (![estimate isKindOfClass:[NSNumber class]]) {
+                    estimate = [NSNumber numberWithDouble:defaultTime];
+                }
+                estimates[test] = estimate;
+                queuedBundle.remainingTime += [estimate doubleValue];
+            }
+            queuedBundle.pendingTests = [[[bundleTestsToRun allObjects] sortedArrayUsingComparator:^NSComparisonResult(NSString *test1, NSString *test2) {
+                double time1 = [estimates[test1] doubleValue];
+                double time2 = [estimates[test2] doubleValue];
+                if (time1 != time2) {
+                    return time1 > time2 ? NSOrderedAscending : NSOrderedDescending;
+                }
+                return [test1 compare:test2];
+            }] mutableCopy];
+            [queuedBundles addObject:queuedBundle];
+        }
+    }
+    if (queuedBundles.count == 0) {
+        BP_SET_ERROR(errPtr, @"Found no tests to run.\n"
+                     "Perhaps you forgot to 'build-for-testing'? (Cmd + Shift + U) in Xcode.");
+        return nil;
+    }
+
+    BPTestQueue *queue = [[self alloc] init];
+    queue.queuedBundles = queuedBundles;
+    queue.estimates = estimates;
+    for (BPQueuedBundle *queuedBundle in queuedBundles) {
+        queue.numTests += queuedBundle.pendingTests.count;
+        queue.remainingTime += queuedBundle.remainingTime;
+    }
+    queue.numSims = MAX(1, MIN([config.numSims integerValue], queue.numTests));
+    queue.minBatchTime = MAX(0.0, [config.bundleOverhead doubleValue]);
+    [BPUtils printInfo:INFO withString:@"Queued %lu tests from %lu test bundles, estimated to take %.2f seconds in total.",
+     (unsigned long)queue.numTests, (unsigned long)queuedBundles.count, queue.remainingTime];
+    return queue;
+}
+
+- (BPXCTestFile *)nextBundle {
+    @synchronized (self) {
+        BPQueuedBundle *queuedBundle = nil;
+        for (BPQueuedBundle *candidate in self.queuedBundles) {
+            if (candidate.pendingTests.count > 0 && (!queuedBundle || candidate.remainingTime > queuedBundle.remainingTime)) {
+                queuedBundle = candidate;
+            }
+        }
+        if (!queuedBundle) {
+            return nil;
+        }
+
+        // Hand out half of a fair share of the work left, so that the batches shrink as the queue drains,
+        // but never so little that the bundle overhead dominates.
+        double targetTime = MAX(self.remainingTime / (2.0 * self.numSims), self.minBatchTime);
+        NSUInteger count = queuedBundle.pendingTests.count;
+        double batchTime = queuedBundle.remainingTime;
+        if (queuedBundle.splittable && queuedBundle.remainingTime > targetTime + self.minBatchTime) {
+            count = 0;
+            batchTime = 0.0;
+            while (count < queuedBundle.pendingTests.count && (count == 0 || batchTime < targetTime)) {
+                batchTime += [self.estimates[queuedBundle.pendingTests[count]] doubleValue];
+                count++;
+            }
+        }
+        NSRange range = NSMakeRange(0, count);
+        NSSet *batch = [NSSet setWithArray:[queuedBundle.pendingTests subarrayWithRange:range]];
+        [queuedBundle.pendingTests removeObjectsInRange:range];
+        queuedBundle.remainingTime = MAX(0.0, queuedBundle.remainingTime - batchTime);
+        self.remainingTime = MAX(0.0, self.remainingTime - batchTime);
+        self.numTests -= batch.count;
+
+        // testsToRun doesn't work reliably, switch to use testsToSkip
+        BPXCTestFile *xctFile = queuedBundle.xctFile;
+        NSMutableArray *testsToSkip = [[NSMutableArray alloc] init];
+        for (NSString *test in xctFile.allTestCases) {
+            if (![batch containsObject:test]) {
+                [testsToSkip addObject:test];
+            }
+        }
+        [testsToSkip addObjectsFromArray:xctFile.skipTestIdentifiers];
+        [testsToSkip sortUsingSelector:@selector(compare:)];
+        BPXCTestFile *bundle = [xctFile copy];
+        bundle.skipTestIdentifiers = testsToSkip;
+        bundle.estimatedExecutionTime = [NSNumber numberWithDouble:batchTime];
+        [BPUtils printInfo:INFO withString:@"%@: Handing out %lu tests estimated to take %.2f seconds, %lu tests (%.2f seconds) left in the queue.",
+         xctFile.name, (unsigned long)batch.count, batchTime, (unsigned long)self.numTests, self.remainingTime];
+        return bundle;
+    }
+}
+
+- (NSSet<NSString *> *)pendingAppPaths {
+    @synchronized (self) {
+        NSMutableSet<NSString *> *appPaths = [[NSMutableSet alloc] init];
+        for (BPQueuedBundle *queuedBundle in self.queuedBundles) {
+            if (queuedBundle.pendingTests.count > 0) {
+                [appPaths addObject:queuedBundle.xctFile.UITargetAppPath ?: queuedBundle.xctFile.testHostPath];
+            }
+        }
+        return appPaths;
+    }
+}
+
+@end
@@ -0,0 +1,39 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/*!
+ A persistent store of test execution times, updated from the final JUnit report of every run.
+
+ For each `Class/test` the store keeps an exponentially weighted moving average of its time, the
+ 90th percentile over its most recent runs and those runs themselves. It is a JSON file written
+ atomically, so a run reading it never sees a half written store.
+ */
+@interface BPTestTimeStore : NSObject
+
+/*!
+ @discussion Load the estimated time of each test, in the same form as the test time estimates json.
+ @param path The path of the store.
+ @param errPtr Set if the store doesn't exist yet or can't be read.
+ @return A mapping of `Class/test` to its moving average time in seconds, or nil.
+ */
++ (NSDictionary<NSString *, NSNumber *> *)estimatesFromStoreAtPath:(NSString *)path withError:(NSError **)errPtr;
+
+/*!
+ @discussion Fold the test times of a JUnit report into the store, creating it if needed.
+ Tests that errored (crashed or timed out) are left out, their times say little about the next run.
+ @param path The path of the store.
+ @param reportPath The path of the JUnit report, usually TEST-FinalReport.xml.
+ @param errPtr Set on failure.
+ @return YES on success.
+ */
++ (BOOL)updateStoreAtPath:(NSString *)path withJUnitReportAtPath:(NSString *)reportPath withError:(NSError **)errPtr;
+
+@end
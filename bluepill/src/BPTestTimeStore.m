@@ -0,0 +1,144 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPTestTimeStore.h"
+#import "bp/src/BPUtils.h"
+
+static const NSInteger BPTestTimeStoreVersion = 1;
+// Weight of the latest run in the moving average.
+static const double BPTestTimeStoreAlpha = 0.3;
+// Number of recent runs kept per test for the percentile.
+static const NSUInteger BPTestTimeStoreWindow = 20;
+
+// Collects `Class/test` => time from the <testcase> elements of a JUnit report.
+@interface BPJUnitTimesParser : NSObject <NSXMLParserDelegate>
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *times;
+@property (nonatomic, strong) NSString *currentTest;
+@property (nonatomic, assign) double currentTime;
+@property (nonatomic, assign) BOOL skipCurrent;
+@end
+
+@implementation BPJUnitTimesParser
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _times = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary<NSString *, NSString *> *)attributes {
+    if ([elementName isEqualToString:@"testcase"]) {
+        NSString *className = attributes[@"classname"];
+        NSString *name = attributes[@"name"];
+        self.currentTest = (className && name) ? [NSString stringWithFormat:@"%@/%@", className, name] : nil;
+        self.currentTime = [attributes[@"time"] doubleValue];
+        self.skipCurrent = attributes[@"time"] == nil;
+    } else if ([elementName isEqualToString:@"error"]) {
+        self.skipCurrent = YES;
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName {
+    if ([elementName isEqualToString:@"testcase"]) {
+        if (self.currentTest && !self.skipCurrent) {
+            self.times[self.currentTest] = [NSNumber numberWithDouble:self.currentTime];
+        }
+        self.currentTest = nil;
+    }
+}
+
+@end
+
+@implementation BPTestTimeStore
+
++ (NSDictionary *)loadStoreAtPath:(NSString *)path withError:(NSError **)errPtr {
+    NSData *data = [NSData dataWithContentsOfFile:path options:0 error:errPtr];
+    if (!data) {
+        return nil;
+    }
+    NSDictionary *store = [NSJSONSerialization JSONObjectWithData:data options:0 error:errPtr];
+    if (![store isKindOfClass:[NSDictionary class]] ||
+        ![store[@"version"] isEqual:@(BPTestTimeStoreVersion)] ||
+        ![store[@"tests"] isKindOfClass:[NSDictionary class]]) {
+        BP_SET_ERROR(errPtr, @"%@ is not a test time store.", path);
+        return nil;
+    }
+    return store;
+}
+
++ (NSDictionary<NSString *, NSNumber *> *)estimatesFromStoreAtPath:(NSString *)path withError:(NSError **)errPtr {
+    NSDictionary *store = [self loadStoreAtPath:path withError:errPtr];
+    if (!store) {
+        return nil;
+    }
+    NSMutableDictionary<NSString *, NSNumber *> *estimates = [[NSMutableDictionary alloc] init];
+    NSDictionary *tests = store[@"tests"];
+    for (NSString *test in tests) {
+        NSDictionary *entry = tests[test];
+        if ([entry isKindOfClass:[NSDictionary class]] && [entry[@"ewma"] isKindOfClass:[NSNumber class]]) {
+            estimates[test] = entry[@"ewma"];
+        }
+    }
+    return estimates;
+}
+
++ (BOOL)updateStoreAtPath:(NSString *)path withJUnitReportAtPath:(NSString *)reportPath withError:(NSError **)errPtr {
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithContentsOfURL:[NSURL fileURLWithPath:reportPath]];
+    BPJUnitTimesParser *delegate = [[BPJUnitTimesParser alloc] init];
+    parser.delegate = delegate;
+    if (![parser parse]) {
+        BP_SET_ERROR(errPtr, @"Failed to parse %@: %@", reportPath, [[parser parserError] localizedDescription]);
+        return NO;
+    }
+
+    NSMutableDictionary *tests = [[NSMutableDictionary alloc] init];
+    if ([[NSFileManager defaultManager] fileExistsAtPath:path]) {
+        NSError *error;
+        NSDictionary *store = [self loadStoreAtPath:path withError:&error];
+        if (store) {
+            [tests addEntriesFromDictionary:store[@"tests"]];
+        } else {
+            [BPUtils printInfo:WARNING withString:@"Starting a new test time store: %@", [error localizedDescription]];
+        }
+    }
+    for (NSString *test in delegate.times) {
+        double time = [delegate.times[test] doubleValue];
+        NSDictionary *entry = tests[test];
+        NSMutableArray<NSNumber *> *samples = [[NSMutableArray alloc] init];
+        double ewma = time;
+        NSInteger runs = 0;
+        if ([entry isKindOfClass:[NSDictionary class]] && [entry[@"ewma"] isKindOfClass:[NSNumber class]]) {
+            ewma = BPTestTimeStoreAlpha * time + (1 - BPTestTimeStoreAlpha) * [entry[@"ewma"] doubleValue];
+            runs = [entry[@"runs"] integerValue];
+            if ([entry[@"samples"] isKindOfClass:[NSArray class]]) {
+                [samples addObjectsFromArray:entry[@"samples"]];
+            }
+        }
+        [samples addObject:delegate.times[test]];
+        if (samples.count > BPTestTimeStoreWindow) {
+            [samples removeObjectsInRange:NSMakeRange(0, samples.count - BPTestTimeStoreWindow)];
+        }
+        NSArray<NSNumber *> *sorted = [samples sortedArrayUsingSelector:@selector(compare:)];
+        NSNumber *p90 = sorted[(NSUInteger)ceil(0.9 * sorted.count) - 1];
+        tests[test] = @{@"ewma": [NSNumber numberWithDouble:ewma], @"p90": p90, @"runs": @(runs + 1), @"samples": samples};
+    }
+
+    NSDictionary *store = @{@"version": @(BPTestTimeStoreVersion), @"tests": tests};
+    NSData *data = [NSJSONSerialization dataWithJSONObject:store options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:errPtr];
+    if (!data ||
+        ![[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:errPtr] ||
+        ![data writeToFile:path options:NSDataWritingAtomic error:errPtr]) {
+        return NO;
+    }
+    [BPUtils printInfo:INFO withString:@"Updated the times of %lu tests in %@", (unsigned long)delegate.times.count, path];
+    return YES;
+}
+
+@end
@@ -12,11 +12,13 @@
 #import <libgen.h>
 #import "bp/src/BPConfiguration.h"
 #import "bp/src/BPStats.h"
+#import "bp/src/BPTestInventoryCache.h"
 #import "bp/src/BPUtils.h"
 #import "bp/src/BPWriter.h"
 #import "BPApp.h"
 #import "BPReportCollector.h"
 #import "BPRunner.h"
+#import "BPTestTimeStore.h"
 
 #include <sys/ioctl.h>
 #include <string.h>
@@ -93,6 +95,7 @@ int main(int argc, char * argv[]) {
             exit(1);
         }
         [[BPStats sharedStats] endTimer:@"Bluepill Initializing" withResult:@"INFO"];
+        [BPTestInventoryCache sharedCache].directory = config.testInventoryCacheDirectory;
         [[BPStats sharedStats] startTimer:@"Loading App"];
         BPApp *app = [BPApp appWithConfig:config withError:&err];
         if (!app) {
@@ -101,6 +104,11 @@ int main(int argc, char * argv[]) {
             exit(1);
         }
         [[BPStats sharedStats] endTimer:@"Loading App" withResult:@"INFO"];
+        if (config.testInventoryCacheDirectory) {
+            BPTestInventoryCache *cache = [BPTestInventoryCache sharedCache];
+            [BPUtils printInfo:INFO withString:@"Test inventory cache: %lu hits, %lu misses", cache.hits, cache.misses];
+            [[BPStats sharedStats] addCounter:@"Test Inventory Cache" withValues:@{@"hits": @(cache.hits), @"misses": @(cache.misses)}];
+        }
         if (config.listTestsOnly) {
             [app listTests];
             exit(0);
@@ -117,15 +125,27 @@ int main(int argc, char * argv[]) {
         }
         rc = [runner runWithBPXCTestFiles:app.testBundles];
         if (config.outputDirectory) {
-            // write the stats
+            // collect all the reports
+            [BPReportCollector collectJUnitReportsFromPath:config.outputDirectory
+                                           deleteCollected:(!config.keepIndividualTestReports)
+                                           withOutputAtDir:config.outputDirectory];
+
+            // keep the test time estimates fresh for the next run
+            if (config.testTimeStoreFile) {
+                NSString *finalReportPath = [config.outputDirectory stringByAppendingPathComponent:@"TEST-FinalReport.xml"];
+                if (![BPTestTimeStore updateStoreAtPath:config.testTimeStoreFile withJUnitReportAtPath:finalReportPath withError:&err]) {
+                    [BPUtils printInfo:WARNING withString:@"Unable to update the test time store: %@", [err localizedDescription]];
+                }
+            }
+
+            // write the stats, including the report collection, before they're gathered into the trace profile
             NSString *outputFile = [config.outputDirectory stringByAppendingPathComponent:@"bluepill-stats.json"];
             BPWriter *statsWriter = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:outputFile];
             [[BPStats sharedStats] exitWithWriter:statsWriter exitCode:rc];
 
-            // collect all the reports
-            [BPReportCollector collectReportsFromPath:config.outputDirectory
-                                      deleteCollected:(!config.keepIndividualTestReports)
-                                      withOutputAtDir:config.outputDirectory];
+            [BPReportCollector collectTraceProfilesFromPath:config.outputDirectory
+                                            deleteCollected:(!config.keepIndividualTestReports)
+                                            withOutputAtDir:config.outputDirectory];
         }
         exit(rc);
     }
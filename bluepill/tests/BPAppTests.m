@@ -59,4 +59,22 @@
     XCTAssertEqualObjects(testBundle.testBundlePath, self.config.testBundlePath);
 }
 
+- (void)testConcurrentBundleLoadingKeepsPluginOrder {
+    NSError *error;
+    self.config.testBundlePath = nil;
+    self.config.appBundlePath = [BPTestHelper sampleAppPath];
+    NSString *pluginsPath = [self.config.appBundlePath stringByAppendingPathComponent:@"Plugins"];
+    NSMutableArray *expectedNames = [[NSMutableArray alloc] init];
+    for (NSString *filename in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:pluginsPath error:nil]) {
+        if ([[[filename pathExtension] lowercaseString] isEqualToString:@"xctest"]) {
+            [expectedNames addObject:[filename stringByDeletingPathExtension]];
+        }
+    }
+    for (int i = 0; i < 5; i++) {
+        BPApp *app = [BPApp appWithConfig:self.config withError:&error];
+        XCTAssertNil(error);
+        XCTAssertEqualObjects([app.testBundles valueForKey:@"name"], expectedNames);
+    }
+}
+
 @end
@@ -10,6 +10,7 @@
 #import "bluepill/src/BPRunner.h"
 #import "bluepill/src/BPApp.h"
 #import "bluepill/src/BPPacker.h"
+#import "bluepill/src/BPTestHostOverhead.h"
 #import "bp/tests/BPTestHelper.h"
 #import "bp/src/BPConfiguration.h"
 #import "bp/src/BPUtils.h"
@@ -103,25 +104,186 @@
     self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
     self.config.testCasesToSkip = @[@"BPSampleAppTests/testCase000"];
     self.config.numSims = @8;
+    self.config.bundleOverhead = @30;
     BPApp *app = [BPApp appWithConfig:self.config withError:nil];
     XCTAssert(app != nil);
     NSError *error;
-    // load the config file
     NSDictionary<NSString *, NSNumber *> *testTimes = [BPUtils loadSimpleJsonFile:self.config.testTimeEstimatesJsonFile withError:&error];
     XCTAssert(error == nil);
+    double longestTest = [[[testTimes allValues] valueForKeyPath:@"@max.doubleValue"] doubleValue];
+    NSUInteger numSims = [[self.config numSims] unsignedIntegerValue];
+    double overhead = [self.config.bundleOverhead doubleValue];
 
-    double totalTime = [BPUtils getTotalTimeWithConfig:self.config
-                                             testTimes:testTimes
-                                        andXCTestFiles:app.testBundles];
-    double optimalBundleTime = totalTime / [[self.config numSims] floatValue];
-    NSArray<BPXCTestFile *> *splitBundles;
-    splitBundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
-
+    NSArray<BPXCTestFile *> *splitBundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
     XCTAssert(error ==  nil);
     XCTAssert([splitBundles count] >= [app.testBundles count]);
-    for (BPXCTestFile *bundle in splitBundles) {
-        XCTAssert([bundle.estimatedExecutionTime doubleValue] <= optimalBundleTime);
+
+    // The packer bounds the makespan, not each bundle: a bundle may take a little longer than
+    // totalTime/numSims when splitting it further would cost a simulator another overhead.
+    // Hand the bundles out longest first to the simulator that frees up first, as the runner does.
+    NSArray<BPXCTestFile *> *longestFirst = [splitBundles sortedArrayUsingComparator:^NSComparisonResult(BPXCTestFile *bundle1, BPXCTestFile *bundle2) {
+        return [bundle2.estimatedExecutionTime compare:bundle1.estimatedExecutionTime];
+    }];
+    double finishTimes[numSims];
+    for (NSUInteger i = 0; i < numSims; i++) {
+        finishTimes[i] = 0.0;
+    }
+    double totalTime = 0.0;
+    for (BPXCTestFile *bundle in longestFirst) {
+        NSUInteger first = 0;
+        for (NSUInteger i = 1; i < numSims; i++) {
+            first = finishTimes[i] < finishTimes[first] ? i : first;
+        }
+        finishTimes[first] += [bundle.estimatedExecutionTime doubleValue] + overhead;
+        totalTime += [bundle.estimatedExecutionTime doubleValue];
     }
+    double makespan = 0.0;
+    for (NSUInteger i = 0; i < numSims; i++) {
+        makespan = MAX(makespan, finishTimes[i]);
+    }
+    // No packing can beat the evenly spread tests plus one overhead, and this one is within a test of it.
+    XCTAssertLessThanOrEqual(makespan, totalTime / numSims + overhead + longestTest + 1e-6);
+    XCTAssertLessThanOrEqual(splitBundles.count, numSims);
+}
+
+- (void)testSmartPackingAccountsForBundleOverhead {
+    self.config.testTimeEstimatesJsonFile = [BPTestHelper sampleTimesJsonPath];
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    self.config.numSims = @8;
+    self.config.bundleOverhead = @30;
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    NSError *error;
+    NSArray<BPXCTestFile *> *bundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
+    XCTAssert(error == nil);
+    // Each simulator gets exactly one bundle: a ninth one would pay the overhead twice on the same simulator.
+    XCTAssertEqual(bundles.count, 8);
+    // Every test still runs exactly once.
+    for (NSString *test in app.testBundles[0].allTestCases) {
+        NSUInteger runs = 0;
+        for (BPXCTestFile *bundle in bundles) {
+            runs += [bundle.skipTestIdentifiers containsObject:test] ? 0 : 1;
+        }
+        XCTAssertEqual(runs, 1, @"%@", test);
+    }
+}
+
+- (void)testLearningTestHostOverheadFromStats {
+    // Two bp processes for BPSampleApp.app (the second one retried once) and the runner's own stats.
+    NSString *trace = @"[\n"
+    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"BP Swimlane #1\"}},\n"
+    "{\"name\": \"process_labels\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"labels\": \"BPSampleApp.app\"}},\n"
+    "{\"name\": \"[Attempt 1] Create Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 0, \"dur\": 30000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] Install Application\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 30000000, \"dur\": 5000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] Launch Application\", \"cat\": \"FAILED\", \"ph\": \"X\", \"ts\": 35000000, \"dur\": 100000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] BPSampleAppTests\", \"cat\": \"FAILED\", \"ph\": \"X\", \"ts\": 40000000, \"dur\": 90000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] BPSampleAppTests/testCase000\", \"cat\": \"FAILED\", \"ph\": \"X\", \"ts\": 41000000, \"dur\": 1000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] Delete Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 140000000, \"dur\": 9000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 2] Clone Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 150000000, \"dur\": 50000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 2] Install Application\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 200000000, \"dur\": 5000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 2] Launch Application\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 205000000, \"dur\": 100000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 2] BPSampleAppTests\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 210000000, \"dur\": 90000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"BP Swimlane #2\"}},\n"
+    "{\"name\": \"process_labels\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"labels\": \"BPSampleApp.app\"}},\n"
+    "{\"name\": \"[Attempt 1] Create Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 0, \"dur\": 40000000, \"pid\": 1, \"tid\": 2},\n"
+    "{\"name\": \"[Attempt 1] Install Application\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 40000000, \"dur\": 5000000, \"pid\": 1, \"tid\": 2},\n"
+    "{\"name\": \"[Attempt 1] Launch Application\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 45000000, \"dur\": 100000000, \"pid\": 1, \"tid\": 2},\n"
+    "{\"name\": \"[Attempt 1] BPSampleAppTests\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 50000000, \"dur\": 90000000, \"pid\": 1, \"tid\": 2},\n"
+    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"Bluepill\"}},\n"
+    "{\"name\": \"[Attempt 1] Create Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 0, \"dur\": 900000000, \"pid\": 1, \"tid\": 0}\n"
+    "]\n";
+    NSString *statsPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssert([trace writeToFile:statsPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    NSError *error;
+    NSDictionary<NSString *, NSNumber *> *overheads = [BPTestHostOverhead overheadsFromStatsFile:statsPath withError:&error];
+    XCTAssertNil(error);
+    // Samples of 40, 50 and 60 seconds: create/clone + install + launch until the first test suite starts.
+    XCTAssertEqualObjects(overheads, @{@"BPSampleApp.app": @50});
+
+    self.config.testTimeEstimatesJsonFile = [BPTestHelper sampleTimesJsonPath];
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    self.config.bundleOverheadStatsFile = statsPath;
+    self.config.numSims = @8;
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    NSArray<BPXCTestFile *> *bundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
+    XCTAssert(error == nil);
+    XCTAssertEqual(bundles.count, 8);
+    [[NSFileManager defaultManager] removeItemAtPath:statsPath error:nil];
+}
+
+- (void)testBundlesAreHandedOutByCostWithOverhead {
+    // The same tests on a test host that takes forever to set up.
+    NSString *trace = @"[\n"
+    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"BP Swimlane #1\"}},\n"
+    "{\"name\": \"process_labels\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"labels\": \"Slow.app\"}},\n"
+    "{\"name\": \"[Attempt 1] Create Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 0, \"dur\": 10000000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] Install Application\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 10000000000, \"dur\": 5000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] Launch Application\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 10005000000, \"dur\": 100000000, \"pid\": 1, \"tid\": 1},\n"
+    "{\"name\": \"[Attempt 1] BPSampleAppTests\", \"cat\": \"PASSED\", \"ph\": \"X\", \"ts\": 10010000000, \"dur\": 90000000, \"pid\": 1, \"tid\": 1}\n"
+    "]\n";
+    NSString *statsPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssert([trace writeToFile:statsPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    NSError *error;
+    NSDictionary<NSString *, NSNumber *> *overheads = [BPTestHostOverhead overheadsFromStatsFile:statsPath withError:&error];
+    XCTAssertNil(error);
+
+    self.config.testTimeEstimatesJsonFile = [BPTestHelper sampleTimesJsonPath];
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    self.config.bundleOverheadStatsFile = statsPath;
+    self.config.bundleOverhead = @30;
+    self.config.numSims = @8;
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    BPXCTestFile *slowHostBundle = [app.testBundles[0] copy];
+    slowHostBundle.testHostPath = @"/tmp/BPPackerTests/Slow.app";
+    NSArray<BPXCTestFile *> *bundles = [BPPacker packTests:@[app.testBundles[0], slowHostBundle] configuration:self.config andError:&error];
+    XCTAssertNil(error);
+
+    // The runner hands the bundles out in order, so they come longest first the way the packer predicted
+    // them: with their test host's overhead, not by their tests alone.
+    XCTAssertEqualObjects([bundles.firstObject.testHostPath lastPathComponent], @"Slow.app");
+    double previousCost = INFINITY;
+    for (BPXCTestFile *bundle in bundles) {
+        NSNumber *overhead = overheads[[bundle.testHostPath lastPathComponent]] ?: self.config.bundleOverhead;
+        double cost = [bundle.estimatedExecutionTime doubleValue] + [overhead doubleValue];
+        XCTAssertLessThanOrEqual(cost, previousCost);
+        previousCost = cost;
+    }
+    [[NSFileManager defaultManager] removeItemAtPath:statsPath error:nil];
+}
+
+- (void)testSmartPackFromTestTimeStore {
+    NSDictionary<NSString *, NSNumber *> *testTimes = [BPUtils loadSimpleJsonFile:[BPTestHelper sampleTimesJsonPath] withError:nil];
+    NSMutableDictionary *tests = [[NSMutableDictionary alloc] init];
+    for (NSString *test in testTimes) {
+        tests[test] = @{@"ewma": testTimes[test], @"p90": testTimes[test], @"runs": @1, @"samples": @[testTimes[test]]};
+    }
+    NSData *store = [NSJSONSerialization dataWithJSONObject:@{@"version": @1, @"tests": tests} options:0 error:nil];
+    NSString *storePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssert([store writeToFile:storePath atomically:YES]);
+
+    self.config.testTimeStoreFile = storePath;
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    self.config.numSims = @8;
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    NSError *error;
+    NSArray<BPXCTestFile *> *bundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
+    XCTAssert(error == nil);
+    XCTAssert(bundles.count >= 8);
+    // Only packing by time sets the estimates.
+    for (BPXCTestFile *bundle in bundles) {
+        XCTAssertNotNil(bundle.estimatedExecutionTime);
+    }
+
+    // Without a store yet, packing falls back to test counts instead of failing.
+    self.config.testTimeStoreFile = [storePath stringByAppendingPathExtension:@"missing"];
+    bundles = [BPPacker packTests:app.testBundles configuration:self.config andError:&error];
+    XCTAssert(error == nil);
+    XCTAssert(bundles.count >= 8);
+    [[NSFileManager defaultManager] removeItemAtPath:storePath error:nil];
 }
 
 - (void)testSmartPackIfJsonMissing {
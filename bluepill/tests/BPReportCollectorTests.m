@@ -9,6 +9,14 @@
 
 #import <XCTest/XCTest.h>
 #import "bluepill/src/BPReportCollector.h"
+#import "bp/src/BPJUnitJournal.h"
+#import "bp/src/BPStats.h"
+
+// Read the timers and counters without reporting the stats, which would end them for every other test.
+@interface BPStats (Test)
+- (NSMutableDictionary<NSString *, id> *)stats;
+- (NSMutableArray *)counters;
+@end
 
 @interface BPReportCollectorTests : XCTestCase
 
@@ -119,4 +127,244 @@ void fixTimestamps(NSString *path) {
     XCTAssertEqualObjects(collectorReportContents, expectedReportContents);
 }
 
+- (void)testCollectReportsWithQuotesInNames {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *report = @"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<testsuites name=\"Selected tests\" tests=\"1\" failures=\"%d\" errors=\"0\" time=\"1.0\">\n"
+    "  <testsuite tests=\"1\" failures=\"%d\" errors=\"0\" time=\"1.0\" timestamp=\"2021-11-04T22:48:39GMTZ\" name=\"It&apos;s.xctest\">\n"
+    "    <testsuite tests=\"1\" failures=\"%d\" errors=\"0\" time=\"1.0\" timestamp=\"2021-11-04T22:48:39GMTZ\" name=\"Quote&quot;Tests\">\n"
+    "      <testcase classname=\"Quote&quot;Tests\" name=\"test(&apos;a&apos;)\" time=\"1.0\">%@</testcase>\n"
+    "    </testsuite>\n"
+    "  </testsuite>\n"
+    "</testsuites>\n";
+    NSFileManager *fm = [NSFileManager defaultManager];
+    XCTAssert([fm createDirectoryAtPath:[path stringByAppendingPathComponent:@"1"] withIntermediateDirectories:YES attributes:nil error:nil]);
+    XCTAssert([fm createDirectoryAtPath:[path stringByAppendingPathComponent:@"2"] withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSString *failed = [NSString stringWithFormat:report, 1, 1, 1, @"<failure type=\"Failure\" message=\"&lt;boom&gt;\">File.m:1</failure>"];
+    NSString *passed = [NSString stringWithFormat:report, 0, 0, 0, @""];
+    XCTAssert([failed writeToFile:[path stringByAppendingPathComponent:@"1/result.xml"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    XCTAssert([passed writeToFile:[path stringByAppendingPathComponent:@"2/result.xml"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    fixTimestamps(path);
+
+    [BPReportCollector collectReportsFromPath:path deleteCollected:YES withOutputAtDir:path];
+    NSError *error;
+    NSXMLDocument *doc = [[NSXMLDocument alloc] initWithContentsOfURL:[NSURL fileURLWithPath:[path stringByAppendingPathComponent:@"TEST-FinalReport.xml"]]
+                                                              options:0
+                                                                error:&error];
+    XCTAssertNil(error);
+    // Both results of the test end up in the same suites, the failure first.
+    NSArray<NSXMLElement *> *testCases = [doc nodesForXPath:@"/testsuites/testsuite/testsuite/testcase" error:nil];
+    XCTAssertEqual(testCases.count, 2);
+    XCTAssertEqualObjects([[testCases[0] attributeForName:@"name"] stringValue], @"test('a')");
+    XCTAssertEqualObjects([[testCases[1] attributeForName:@"classname"] stringValue], @"Quote\"Tests");
+    XCTAssertEqualObjects([[[[testCases[0] elementsForName:@"failure"] firstObject] attributeForName:@"message"] stringValue], @"<boom>");
+    XCTAssertEqual([testCases[1] elementsForName:@"failure"].count, 0);
+    NSXMLElement *root = [doc rootElement];
+    XCTAssertEqualObjects([[root attributeForName:@"tests"] stringValue], @"2");
+    XCTAssertEqualObjects([[root attributeForName:@"failures"] stringValue], @"1");
+    [fm removeItemAtPath:path error:nil];
+}
+
+- (void)testCollectReportsKeepsOutputVerbatim {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *output = @"  indented output\n\n  after a blank line\n";
+    NSString *failure = @"\n    File.m:1 &lt;boom&gt;  ";
+    NSString *report = [NSString stringWithFormat:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<testsuites name=\"Selected tests\">\n"
+    "  <testsuite name=\"Tests.xctest\">\n"
+    "    <testsuite name=\"Tests\">\n"
+    "      <testcase classname=\"Tests\" name=\"test\" time=\"1.0\">\n"
+    "        <failure type=\"Failure\" message=\"boom\">%@</failure>\n"
+    "        <system-out>%@</system-out>\n"
+    "      </testcase>\n"
+    "    </testsuite>\n"
+    "  </testsuite>\n"
+    "</testsuites>\n", failure, output];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    XCTAssert([fm createDirectoryAtPath:[path stringByAppendingPathComponent:@"1"] withIntermediateDirectories:YES attributes:nil error:nil]);
+    XCTAssert([report writeToFile:[path stringByAppendingPathComponent:@"1/result.xml"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    [BPReportCollector collectReportsFromPath:path deleteCollected:YES withOutputAtDir:path];
+    NSString *finalReportPath = [path stringByAppendingPathComponent:@"TEST-FinalReport.xml"];
+    NSString *merged = [NSString stringWithContentsOfFile:finalReportPath encoding:NSUTF8StringEncoding error:nil];
+    XCTAssert([merged containsString:[NSString stringWithFormat:@"<system-out>%@</system-out>", output]], @"%@", merged);
+    XCTAssert([merged containsString:[NSString stringWithFormat:@"message=\"boom\">%@</failure>", failure]], @"%@", merged);
+    NSDictionary *attributes = [fm attributesOfItemAtPath:finalReportPath error:nil];
+    XCTAssertEqual([attributes filePosixPermissions], 0644);
+    [fm removeItemAtPath:path error:nil];
+}
+
+- (void)testCollectManyReports {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSUInteger numReports = 500;
+    NSUInteger numClasses = 10;
+    NSUInteger numTestsPerClass = 10;
+    // Every report runs the same 100 tests of a different bundle, plus a retry of the first bundle's tests.
+    for (NSUInteger r = 0; r < numReports; r++) {
+        NSMutableString *report = [NSMutableString stringWithString:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites name=\"Selected tests\">\n"];
+        for (NSString *bundle in @[[NSString stringWithFormat:@"Bundle%lu.xctest", (unsigned long)r], @"Bundle0.xctest"]) {
+            [report appendFormat:@"<testsuite name=\"%@\">\n", bundle];
+            for (NSUInteger c = 0; c < numClasses; c++) {
+                [report appendFormat:@"<testsuite name=\"Class%lu\">\n", (unsigned long)c];
+                for (NSUInteger t = 0; t < numTestsPerClass; t++) {
+                    [report appendFormat:@"<testcase classname=\"Class%lu\" name=\"test%lu\" time=\"0.1\"></testcase>\n", (unsigned long)c, (unsigned long)t];
+                }
+                [report appendString:@"</testsuite>\n"];
+            }
+            [report appendString:@"</testsuite>\n"];
+        }
+        [report appendString:@"</testsuites>\n"];
+        NSString *dir = [path stringByAppendingPathComponent:[NSString stringWithFormat:@"%lu", (unsigned long)r]];
+        XCTAssert([fm createDirectoryAtPath:dir withIntermediateDirectories:YES attributes:nil error:nil]);
+        XCTAssert([report writeToFile:[dir stringByAppendingPathComponent:@"result.xml"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    }
+
+    // Merging used to be quadratic in the number of reports, 100k test cases took minutes.
+    NSDate *start = [NSDate date];
+    [BPReportCollector collectReportsFromPath:path deleteCollected:YES withOutputAtDir:path];
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+    XCTAssertLessThan(elapsed, 60.0);
+
+    NSError *error;
+    NSXMLDocument *doc = [[NSXMLDocument alloc] initWithContentsOfURL:[NSURL fileURLWithPath:[path stringByAppendingPathComponent:@"TEST-FinalReport.xml"]]
+                                                              options:0
+                                                                error:&error];
+    XCTAssertNil(error);
+    NSUInteger numTests = numReports * numClasses * numTestsPerClass * 2;
+    XCTAssertEqualObjects([[[doc rootElement] attributeForName:@"tests"] stringValue], ([NSString stringWithFormat:@"%lu", (unsigned long)numTests]));
+    XCTAssertEqual([doc nodesForXPath:@"/testsuites/testsuite" error:nil].count, numReports);
+    [fm removeItemAtPath:path error:nil];
+}
+
+- (void)writeReportWithResult:(NSString *)result toPath:(NSString *)path modifiedAt:(NSDate *)mtime {
+    NSString *report = [NSString stringWithFormat:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<testsuites name=\"Selected tests\">\n"
+    "  <testsuite name=\"Tests.xctest\">\n"
+    "    <testsuite name=\"Tests\">\n"
+    "      <testcase classname=\"Tests\" name=\"test\" time=\"1.0\">%@</testcase>\n"
+    "    </testsuite>\n"
+    "  </testsuite>\n"
+    "</testsuites>\n", result];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    XCTAssert([fm createDirectoryAtPath:[path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil]);
+    XCTAssert([report writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    XCTAssert([fm setAttributes:@{NSFileModificationDate: mtime} ofItemAtPath:path error:nil]);
+}
+
+- (void)testNewerReportWins {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    // The retry that passed sorts first by name, the reports have to be merged by mtime.
+    [self writeReportWithResult:@"<failure type=\"Failure\" message=\"boom\"></failure>"
+                         toPath:[path stringByAppendingPathComponent:@"2/result.xml"]
+                     modifiedAt:[NSDate dateWithTimeIntervalSinceNow:-60]];
+    [self writeReportWithResult:@""
+                         toPath:[path stringByAppendingPathComponent:@"1/result.xml"]
+                     modifiedAt:[NSDate date]];
+    NSDate *start = [NSDate date];
+
+    [BPReportCollector collectJUnitReportsFromPath:path deleteCollected:YES withOutputAtDir:path];
+    NSError *error;
+    NSXMLDocument *doc = [[NSXMLDocument alloc] initWithContentsOfURL:[NSURL fileURLWithPath:[path stringByAppendingPathComponent:@"TEST-FinalReport.xml"]]
+                                                              options:0
+                                                                error:&error];
+    XCTAssertNil(error);
+    NSArray *tries = [doc nodesForXPath:@"//testcase[@name='test' and @classname='Tests']" error:nil];
+    XCTAssertEqual(tries.count, 2);
+    XCTAssertEqual([[tries.firstObject nodesForXPath:@"failure" error:nil] count], 1, @"The older report's try isn't first");
+    XCTAssertEqual([[tries.lastObject nodesForXPath:@"failure" error:nil] count], 0, @"The newer report's try isn't last");
+
+    // Every step is timed, and counted, in this run's stats.
+    BPStats *stats = [BPStats sharedStats];
+    for (NSString *timer in @[@"Collecting JUnit Reports", @"Parsing JUnit Reports", @"Merging JUnit Reports", @"Writing HTML Report"]) {
+        NSDate *endTime = [stats.stats[timer] valueForKey:@"endTime"];
+        XCTAssertNotNil(endTime, @"No %@ timer", timer);
+        XCTAssertNotEqual([endTime compare:start], NSOrderedAscending, @"The %@ timer didn't end", timer);
+    }
+    id counter = nil;
+    for (id candidate in stats.counters) {
+        if ([[candidate valueForKey:@"name"] isEqualToString:@"JUnit Reports"]) {
+            counter = candidate;
+        }
+    }
+    NSDictionary *expected = @{@"reports": @2, @"failed": @0, @"testcases": @2};
+    XCTAssertEqualObjects([counter valueForKey:@"counters"], expected);
+    XCTAssertNotEqual([[counter valueForKey:@"timeStamp"] compare:start], NSOrderedAscending);
+    [fm removeItemAtPath:path error:nil];
+}
+
+// Leave behind the journal of a bp that was killed after its first test, in a directory of its own.
+- (void)writeJournalAtPath:(NSString *)path {
+    XCTAssert([[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+                                        withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSError *error;
+    BPJUnitJournal *journal = [BPJUnitJournal journalAtPath:path withError:&error];
+    XCTAssertNotNil(journal, @"%@", [error localizedDescription]);
+    NSObject *root = [[NSObject alloc] init];
+    NSObject *suite = [[NSObject alloc] init];
+    NSObject *testCase = [[NSObject alloc] init];
+    [journal recordTestSuite:root inTestSuite:nil withName:@"Selected tests" timestamp:@"2016-01-01T00:00:00Z"];
+    [journal recordTestSuite:suite inTestSuite:root withName:@"JournalTests" timestamp:@"2016-01-01T00:00:00Z"];
+    [journal recordTestCase:testCase inTestSuite:suite withTime:1.0 failure:NO error:NO
+                      junit:@"    <testcase classname=\"JournalTests\" name=\"testJournaled\" time=\"1.0\">\n    </testcase>"];
+}
+
+- (void)testJournalsAreDeletedOnlyOnceRecovered {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *journalPath = [path stringByAppendingPathComponent:@"BP-1/TEST-Tests-1-results.journal"];
+    NSString *brokenJournalPath = [path stringByAppendingPathComponent:@"BP-2/TEST-Tests-1-results.journal"];
+    [self writeJournalAtPath:journalPath];
+    XCTAssert([fm createDirectoryAtPath:[brokenJournalPath stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil]);
+    XCTAssert([@"{\"not a journal" writeToFile:brokenJournalPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    // Without deleting what was collected, both journals stay.
+    NSString *outputPath = [path stringByAppendingString:@"-output"];
+    XCTAssert([fm createDirectoryAtPath:outputPath withIntermediateDirectories:YES attributes:nil error:nil]);
+    [BPReportCollector collectJUnitReportsFromPath:path deleteCollected:NO withOutputAtDir:outputPath];
+    NSString *merged = [NSString stringWithContentsOfFile:[outputPath stringByAppendingPathComponent:@"TEST-FinalReport.xml"]
+                                                 encoding:NSUTF8StringEncoding error:nil];
+    XCTAssert([merged containsString:@"testJournaled"], @"%@", merged);
+    XCTAssert([fm fileExistsAtPath:journalPath]);
+    XCTAssert([fm fileExistsAtPath:brokenJournalPath]);
+
+    // Otherwise only the one that was recovered goes.
+    [fm removeItemAtPath:[[journalPath stringByDeletingPathExtension] stringByAppendingPathExtension:@"xml"] error:nil];
+    [BPReportCollector collectJUnitReportsFromPath:path deleteCollected:YES withOutputAtDir:outputPath];
+    merged = [NSString stringWithContentsOfFile:[outputPath stringByAppendingPathComponent:@"TEST-FinalReport.xml"]
+                                       encoding:NSUTF8StringEncoding error:nil];
+    XCTAssert([merged containsString:@"testJournaled"], @"%@", merged);
+    XCTAssertFalse([fm fileExistsAtPath:journalPath]);
+    XCTAssert([fm fileExistsAtPath:brokenJournalPath]);
+    [fm removeItemAtPath:path error:nil];
+    [fm removeItemAtPath:outputPath error:nil];
+}
+
+- (void)testCollectTraceProfiles {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    XCTAssert([fm createDirectoryAtPath:[path stringByAppendingPathComponent:@"BP-1"] withIntermediateDirectories:YES attributes:nil error:nil]);
+    XCTAssert([fm createDirectoryAtPath:[path stringByAppendingPathComponent:@"BP-2"] withIntermediateDirectories:YES attributes:nil error:nil]);
+    // A process without any timers ends with a trailing comma.
+    NSString *noTimers = @"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"BP Swimlane #1\"}},\n"
+    "{\"name\": \"BP-1 (123)\", \"cat\": \"process\", \"ph\": \"X\", \"ts\": 1, \"dur\": 2, \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"Exit Code 0\"}},\n";
+    // A process killed while writing its stats.
+    NSString *truncated = @"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"BP Swimlane #2\"}},\n"
+    "{\"name\": \"[Attempt 1] Create Simulator\", \"cat\": \"INFO\", \"ph\": \"X\", \"ts\": 1, \"dur\": 2, \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"INFO\"}},\n"
+    "{\"name\": \"[Attempt 1] Install Applic";
+    XCTAssert([noTimers writeToFile:[path stringByAppendingPathComponent:@"BP-1/BP-1-stats.json"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    XCTAssert([truncated writeToFile:[path stringByAppendingPathComponent:@"BP-2/BP-2-stats.json"] atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    [BPReportCollector collectTraceProfilesFromPath:path deleteCollected:YES withOutputAtDir:path];
+    NSData *data = [NSData dataWithContentsOfFile:[path stringByAppendingPathComponent:@"trace-profile.json"]];
+    XCTAssertNotNil(data);
+    NSError *error;
+    NSArray *events = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(events.count, 4);
+    XCTAssertFalse([fm fileExistsAtPath:[path stringByAppendingPathComponent:@"BP-1/BP-1-stats.json"]]);
+    [fm removeItemAtPath:path error:nil];
+}
+
 @end
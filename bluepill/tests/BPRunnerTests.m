@@ -14,9 +14,37 @@
 #import "bluepill/src/BPRunner.h"
 #import "bluepill/src/BPApp.h"
 #import "bluepill/src/BPPacker.h"
+#import "bluepill/src/BPTestQueue.h"
 #import "bp/src/BPXCTestFile.h"
 #import "bp/src/BPConstants.h"
 
+@interface BPRunner (Test)
+- (BOOL)isDeviceHealthy:(NSString *)deviceID forAppPath:(NSString *)appPath;
+- (void)returnDevice:(NSString *)deviceID
+          usedBefore:(BOOL)usedBefore
+          forAppPath:(NSString *)appPath
+              toPool:(NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *)devicePool
+            withUses:(NSMutableDictionary<NSString *, NSNumber *> *)deviceUses
+            maxReuse:(NSInteger)maxReuse
+            poolSize:(NSUInteger)poolSize;
+- (void)evictIdleDevicesFromPool:(NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *)devicePool
+                        withUses:(NSMutableDictionary<NSString *, NSNumber *> *)deviceUses
+                 keepingAppPaths:(NSSet<NSString *> *)appPaths;
+@end
+
+// Health checks the simulators made up by the fake bp instead of looking for them in CoreSimulator.
+@interface BPFakeDeviceRunner : BPRunner
+@property (nonatomic, assign) BOOL devicesAreHealthy;
+@end
+
+@implementation BPFakeDeviceRunner
+
+- (BOOL)isDeviceHealthy:(NSString *)deviceID forAppPath:(NSString *)appPath {
+    return self.devicesAreHealthy;
+}
+
+@end
+
 @interface BPRunnerTests : XCTestCase
 @property (nonatomic, strong) BPConfiguration* config;
 @end
@@ -83,4 +111,326 @@
     }
 }
 
+- (void)testDynamicSchedulingHandsOutEveryTestOnce {
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    self.config.numSims = @4;
+    self.config.bundleOverhead = @2;
+    self.config.repeatTestsCount = @2;
+    self.config.testCasesToSkip = @[@"BPSampleAppTests/testCase000"];
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    NSError *error;
+    BPTestQueue *queue = [BPTestQueue queueWithXCTestFiles:app.testBundles configuration:self.config andError:&error];
+    XCTAssertNotNil(queue, @"%@", error);
+
+    NSCountedSet *expected = [[NSCountedSet alloc] init];
+    for (BPXCTestFile *xctFile in app.testBundles) {
+        for (NSString *test in xctFile.allTestCases) {
+            if (![test isEqualToString:@"BPSampleAppTests/testCase000"]) {
+                [expected addObject:test];
+                [expected addObject:test];
+            }
+        }
+    }
+    XCTAssertEqual(queue.numTests, expected.count);
+
+    NSCountedSet *handedOut = [[NSCountedSet alloc] init];
+    NSMutableArray<NSNumber *> *batchSizes = [[NSMutableArray alloc] init];
+    BPXCTestFile *bundle;
+    while ((bundle = [queue nextBundle])) {
+        NSSet *skipped = [NSSet setWithArray:bundle.skipTestIdentifiers];
+        NSUInteger batchSize = 0;
+        for (NSString *test in bundle.allTestCases) {
+            if (![skipped containsObject:test]) {
+                [handedOut addObject:test];
+                batchSize++;
+            }
+        }
+        XCTAssert(batchSize >= 1);
+        [batchSizes addObject:@(batchSize)];
+    }
+    XCTAssertEqual(queue.numTests, 0);
+    XCTAssertEqual(handedOut.count, expected.count);
+    for (NSString *test in expected) {
+        XCTAssertEqual([handedOut countForObject:test], 2);
+    }
+    // The tail of the queue is handed out in smaller batches than the head.
+    XCTAssert([batchSizes.firstObject unsignedIntegerValue] > [batchSizes.lastObject unsignedIntegerValue]);
+}
+
+// Install the fake bp from the test resources, which sleeps for the given duration of each test it runs.
+- (NSString *)installFakeBpWithTestTimes:(NSDictionary<NSString *, NSNumber *> *)testTimes inDirectory:(NSString *)dir {
+    XCTAssert([[NSFileManager defaultManager] createDirectoryAtPath:dir withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSString *timesPath = [dir stringByAppendingPathComponent:@"times.json"];
+    XCTAssert([[NSJSONSerialization dataWithJSONObject:testTimes options:0 error:nil] writeToFile:timesPath atomically:YES]);
+    NSString *fakeBp = [dir stringByAppendingPathComponent:@"fake-bp"];
+    NSString *fakeBpResource = [[[NSBundle bundleForClass:[self class]] resourcePath] stringByAppendingPathComponent:@"fake-bp"];
+    XCTAssert([[NSFileManager defaultManager] copyItemAtPath:fakeBpResource toPath:fakeBp error:nil]);
+    XCTAssert([[NSFileManager defaultManager] setAttributes:@{NSFilePosixPermissions: @0755} ofItemAtPath:fakeBp error:nil]);
+    setenv("FAKE_BP_TEST_TIMES", [timesPath UTF8String], 1);
+    return fakeBp;
+}
+
+- (BPXCTestFile *)balancingTestsBundle {
+    self.config.testBundlePath = [BPTestHelper sampleAppBalancingTestsBundlePath];
+    BPApp *app = [BPApp appWithConfig:self.config withError:nil];
+    XCTAssert(app != nil);
+    for (BPXCTestFile *testBundle in app.testBundles) {
+        if ([testBundle.testBundlePath isEqualToString:self.config.testBundlePath]) {
+            return testBundle;
+        }
+    }
+    return nil;
+}
+
+// The `start <swimlane>` and `end <swimlane> <tests>` lines the fake bp appended to FAKE_BP_EVENTS, in order.
+- (NSArray<NSArray<NSString *> *> *)fakeBpEventsAtPath:(NSString *)path {
+    NSString *log = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+    NSMutableArray<NSArray<NSString *> *> *events = [[NSMutableArray alloc] init];
+    for (NSString *line in [log componentsSeparatedByString:@"\n"]) {
+        if (line.length > 0) {
+            [events addObject:[line componentsSeparatedByString:@" "]];
+        }
+    }
+    return events;
+}
+
+- (void)testIdleSwimlanesAreFilledAtOnce {
+    self.config.numSims = @4;
+    self.config.headlessMode = YES;
+    self.config.cloneSimulator = NO;
+    BPXCTestFile *xctFile = [self balancingTestsBundle];
+    XCTAssertNotNil(xctFile);
+    // About two seconds per bundle, twice the interval the runner used to launch bundles at
+    NSMutableDictionary<NSString *, NSNumber *> *testTimes = [[NSMutableDictionary alloc] init];
+    for (NSString *test in xctFile.allTestCases) {
+        testTimes[test] = @0.04;
+    }
+    NSString *tmpDir = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *fakeBp = [self installFakeBpWithTestTimes:testTimes inDirectory:tmpDir];
+    NSString *eventsPath = [tmpDir stringByAppendingPathComponent:@"events.log"];
+    setenv("FAKE_BP_EVENTS", [eventsPath UTF8String], 1);
+
+    // All four bundles start right away, before any of them is done.
+    BPRunner *runner = [BPRunner BPRunnerWithConfig:self.config withBpPath:fakeBp];
+    XCTAssertEqual([runner runWithBPXCTestFiles:@[xctFile]], 0);
+    NSArray<NSArray<NSString *> *> *events = [self fakeBpEventsAtPath:eventsPath];
+    XCTAssertEqual(events.count, 8);
+    NSMutableSet<NSString *> *swimlanes = [[NSMutableSet alloc] init];
+    for (NSUInteger i = 0; i < MIN(4, events.count); i++) {
+        XCTAssertEqualObjects(events[i][0], @"start", @"%@", events);
+        [swimlanes addObject:events[i][1]];
+    }
+    XCTAssertEqual(swimlanes.count, 4);
+    unsetenv("FAKE_BP_TEST_TIMES");
+    unsetenv("FAKE_BP_EVENTS");
+    [[NSFileManager defaultManager] removeItemAtPath:tmpDir error:nil];
+}
+
+- (void)testDynamicSchedulingSpreadsSlowTests {
+    // A fake bp sleeps for the duration of each test instead of running it. The slowest tests sort last,
+    // so packing by count puts all of them in the same bundle while the queue spreads them over the simulators.
+    self.config.numSims = @4;
+    self.config.bundleOverhead = @2;
+    self.config.headlessMode = YES;
+    self.config.cloneSimulator = NO;
+    BPXCTestFile *xctFile = [self balancingTestsBundle];
+    XCTAssertNotNil(xctFile);
+
+    NSArray<NSString *> *tests = [xctFile.allTestCases sortedArrayUsingSelector:@selector(compare:)];
+    NSMutableDictionary<NSString *, NSNumber *> *testTimes = [[NSMutableDictionary alloc] init];
+    NSUInteger numSlowTests = 24;
+    for (NSUInteger i = 0; i < tests.count; i++) {
+        testTimes[tests[i]] = (i + numSlowTests >= tests.count) ? @0.2 : @0.01;
+    }
+    NSString *tmpDir = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *fakeBp = [self installFakeBpWithTestTimes:testTimes inDirectory:tmpDir];
+
+    NSUInteger mostSlowTestsInABundle[2];
+    NSUInteger numBundles[2];
+    for (int dynamic = 0; dynamic < 2; dynamic++) {
+        NSString *logPath = [tmpDir stringByAppendingPathComponent:[NSString stringWithFormat:@"ran-%d.log", dynamic]];
+        NSString *eventsPath = [tmpDir stringByAppendingPathComponent:[NSString stringWithFormat:@"events-%d.log", dynamic]];
+        setenv("FAKE_BP_LOG", [logPath UTF8String], 1);
+        setenv("FAKE_BP_EVENTS", [eventsPath UTF8String], 1);
+        self.config.dynamicScheduling = dynamic;
+        BPRunner *runner = [BPRunner BPRunnerWithConfig:self.config withBpPath:fakeBp];
+        XCTAssertEqual([runner runWithBPXCTestFiles:@[xctFile]], 0);
+
+        NSString *log = [NSString stringWithContentsOfFile:logPath encoding:NSUTF8StringEncoding error:nil];
+        NSArray<NSString *> *ran = [[log stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]] componentsSeparatedByString:@"\n"];
+        XCTAssertEqual(ran.count, tests.count);
+        XCTAssertEqualObjects([ran sortedArrayUsingSelector:@selector(compare:)], tests);
+
+        mostSlowTestsInABundle[dynamic] = 0;
+        numBundles[dynamic] = 0;
+        for (NSArray<NSString *> *event in [self fakeBpEventsAtPath:eventsPath]) {
+            if (![event[0] isEqualToString:@"end"] || event.count < 3) {
+                continue;
+            }
+            numBundles[dynamic]++;
+            NSUInteger slowTests = 0;
+            for (NSString *test in [event[2] componentsSeparatedByString:@","]) {
+                slowTests += [testTimes[test] doubleValue] > 0.1 ? 1 : 0;
+            }
+            mostSlowTestsInABundle[dynamic] = MAX(mostSlowTestsInABundle[dynamic], slowTests);
+        }
+    }
+    // Packed by count, one simulator gets most of the slow tests. The queue hands them out in the
+    // small batches at its tail, no more than a simulator's share in any of them.
+    XCTAssertGreaterThan(numBundles[1], numBundles[0]);
+    XCTAssertGreaterThan(mostSlowTestsInABundle[0], numSlowTests / 2);
+    XCTAssertLessThanOrEqual(mostSlowTestsInABundle[1], numSlowTests / 4);
+    unsetenv("FAKE_BP_TEST_TIMES");
+    unsetenv("FAKE_BP_LOG");
+    unsetenv("FAKE_BP_EVENTS");
+    [[NSFileManager defaultManager] removeItemAtPath:tmpDir error:nil];
+}
+
+// Run the balancing tests one small batch after another on a single simulator, with the fake bp handing
+// its simulator back after every batch. Returns the simulators the batches ran on, in order, and fills
+// in the ones that were deleted once the run is over.
+- (NSArray<NSString *> *)runBatchesWithMaxReuse:(NSInteger)maxReuse
+                                 healthyDevices:(BOOL)healthy
+                                 deletedDevices:(NSMutableSet<NSString *> *)deleted {
+    self.config.numSims = @1;
+    self.config.bundleOverhead = @0;
+    self.config.dynamicScheduling = YES;
+    self.config.maxSimulatorReuse = @(maxReuse);
+    self.config.headlessMode = YES;
+    self.config.cloneSimulator = NO;
+    BPXCTestFile *xctFile = [self balancingTestsBundle];
+    XCTAssertNotNil(xctFile);
+    NSMutableDictionary<NSString *, NSNumber *> *testTimes = [[NSMutableDictionary alloc] init];
+    for (NSString *test in xctFile.allTestCases) {
+        testTimes[test] = @0.001;
+    }
+    NSString *tmpDir = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *fakeBp = [self installFakeBpWithTestTimes:testTimes inDirectory:tmpDir];
+    NSString *eventsPath = [tmpDir stringByAppendingPathComponent:@"events.log"];
+    setenv("FAKE_BP_EVENTS", [eventsPath UTF8String], 1);
+
+    BPFakeDeviceRunner *runner = [BPFakeDeviceRunner BPRunnerWithConfig:self.config withBpPath:fakeBp];
+    runner.devicesAreHealthy = healthy;
+    XCTAssertEqual([runner runWithBPXCTestFiles:@[xctFile]], 0);
+
+    // Simulators are deleted by `bp -D` tasks the runner doesn't wait for.
+    NSMutableArray<NSString *> *devices = [[NSMutableArray alloc] init];
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:10];
+    do {
+        [devices removeAllObjects];
+        [deleted removeAllObjects];
+        for (NSArray<NSString *> *event in [self fakeBpEventsAtPath:eventsPath]) {
+            if ([event[0] isEqualToString:@"start"]) {
+                XCTAssertEqual(event.count, 3, @"No simulator handoff for %@", event);
+                [devices addObject:[event lastObject]];
+            } else if ([event[0] isEqualToString:@"delete"]) {
+                [deleted addObject:event[1]];
+            }
+        }
+        if ([deleted isEqualToSet:[NSSet setWithArray:devices]]) {
+            break;
+        }
+        [NSThread sleepForTimeInterval:0.1];
+    } while ([deadline timeIntervalSinceNow] > 0);
+    unsetenv("FAKE_BP_TEST_TIMES");
+    unsetenv("FAKE_BP_EVENTS");
+    [[NSFileManager defaultManager] removeItemAtPath:tmpDir error:nil];
+    return devices;
+}
+
+- (void)testSimulatorsAreReusedUpToMaxReuse {
+    NSMutableSet<NSString *> *deleted = [[NSMutableSet alloc] init];
+    NSArray<NSString *> *devices = [self runBatchesWithMaxReuse:2 healthyDevices:YES deletedDevices:deleted];
+
+    // Each simulator the fake bp hands back runs the next batches until it has run three of them.
+    XCTAssertGreaterThanOrEqual(devices.count, 4);
+    for (NSUInteger i = 0; i < devices.count; i++) {
+        XCTAssertEqualObjects(devices[i], devices[i - i % 3], @"%@", devices);
+    }
+    NSCountedSet<NSString *> *uses = [[NSCountedSet alloc] initWithArray:devices];
+    XCTAssertEqual(uses.count, (devices.count + 2) / 3);
+    // Worn out simulators are evicted as they come back and the rest when the run is over.
+    XCTAssertEqualObjects(deleted, [NSSet setWithArray:devices]);
+}
+
+- (void)testUnhealthySimulatorsAreEvicted {
+    NSMutableSet<NSString *> *deleted = [[NSMutableSet alloc] init];
+    NSArray<NSString *> *devices = [self runBatchesWithMaxReuse:2 healthyDevices:NO deletedDevices:deleted];
+
+    // No batch gets a simulator that failed the health check.
+    XCTAssertGreaterThanOrEqual(devices.count, 2);
+    XCTAssertEqual([[NSSet setWithArray:devices] count], devices.count);
+    XCTAssertEqualObjects(deleted, [NSSet setWithArray:devices]);
+}
+
+// The simulators the fake bp was asked to delete, once there are `count` of them or it's been too long.
+- (NSSet<NSString *> *)deletedDevicesAtPath:(NSString *)eventsPath count:(NSUInteger)count {
+    NSMutableSet<NSString *> *deleted = [[NSMutableSet alloc] init];
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:10];
+    do {
+        [deleted removeAllObjects];
+        for (NSArray<NSString *> *event in [self fakeBpEventsAtPath:eventsPath]) {
+            if ([event[0] isEqualToString:@"delete"]) {
+                [deleted addObject:event[1]];
+            }
+        }
+        if (deleted.count >= count) {
+            break;
+        }
+        [NSThread sleepForTimeInterval:0.1];
+    } while ([deadline timeIntervalSinceNow] > 0);
+    return deleted;
+}
+
+- (void)testDevicePoolIsCappedAtPoolSize {
+    NSString *tmpDir = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *fakeBp = [self installFakeBpWithTestTimes:@{} inDirectory:tmpDir];
+    NSString *eventsPath = [tmpDir stringByAppendingPathComponent:@"events.log"];
+    setenv("FAKE_BP_EVENTS", [eventsPath UTF8String], 1);
+    BPFakeDeviceRunner *runner = [BPFakeDeviceRunner BPRunnerWithConfig:self.config withBpPath:fakeBp];
+    runner.devicesAreHealthy = YES;
+    NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *pool = [@{
+        @"/tmp/A.app": [@[@"SIM-1"] mutableCopy],
+        @"/tmp/B.app": [@[@"SIM-2"] mutableCopy],
+    } mutableCopy];
+    NSMutableDictionary<NSString *, NSNumber *> *uses = [@{@"SIM-1": @1, @"SIM-2": @1} mutableCopy];
+
+    // A third simulator doesn't fit in a pool of two, even for an app that has one pooled already.
+    [runner returnDevice:@"SIM-3" usedBefore:NO forAppPath:@"/tmp/A.app" toPool:pool withUses:uses maxReuse:5 poolSize:2];
+    XCTAssertEqualObjects(pool[@"/tmp/A.app"], @[@"SIM-1"]);
+    XCTAssertNil(uses[@"SIM-3"]);
+    XCTAssertEqualObjects([self deletedDevicesAtPath:eventsPath count:1], [NSSet setWithObject:@"SIM-3"]);
+
+    // It's pooled once there's room for it.
+    [runner returnDevice:@"SIM-3" usedBefore:NO forAppPath:@"/tmp/A.app" toPool:pool withUses:uses maxReuse:5 poolSize:3];
+    XCTAssertEqualObjects(pool[@"/tmp/A.app"], (@[@"SIM-1", @"SIM-3"]));
+    unsetenv("FAKE_BP_TEST_TIMES");
+    unsetenv("FAKE_BP_EVENTS");
+    [[NSFileManager defaultManager] removeItemAtPath:tmpDir error:nil];
+}
+
+- (void)testIdleDevicesAreEvicted {
+    NSString *tmpDir = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSString *fakeBp = [self installFakeBpWithTestTimes:@{} inDirectory:tmpDir];
+    NSString *eventsPath = [tmpDir stringByAppendingPathComponent:@"events.log"];
+    setenv("FAKE_BP_EVENTS", [eventsPath UTF8String], 1);
+    BPRunner *runner = [BPRunner BPRunnerWithConfig:self.config withBpPath:fakeBp];
+    NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *pool = [@{
+        @"/tmp/A.app": [@[@"SIM-1"] mutableCopy],
+        @"/tmp/B.app": [@[@"SIM-2", @"SIM-3"] mutableCopy],
+    } mutableCopy];
+    NSMutableDictionary<NSString *, NSNumber *> *uses = [@{@"SIM-1": @1, @"SIM-2": @1, @"SIM-3": @2} mutableCopy];
+
+    // Only the app that still has bundles to run keeps its simulators.
+    [runner evictIdleDevicesFromPool:pool withUses:uses keepingAppPaths:[NSSet setWithObject:@"/tmp/A.app"]];
+    XCTAssertEqualObjects(pool, @{@"/tmp/A.app": @[@"SIM-1"]});
+    XCTAssertEqualObjects(uses, @{@"SIM-1": @1});
+    NSSet *expected = [NSSet setWithObjects:@"SIM-2", @"SIM-3", nil];
+    XCTAssertEqualObjects([self deletedDevicesAtPath:eventsPath count:2], expected);
+    unsetenv("FAKE_BP_TEST_TIMES");
+    unsetenv("FAKE_BP_EVENTS");
+    [[NSFileManager defaultManager] removeItemAtPath:tmpDir error:nil];
+}
+
 @end
@@ -0,0 +1,85 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+#import "bluepill/src/BPTestTimeStore.h"
+
+@interface BPTestTimeStoreTests : XCTestCase
+@property (nonatomic, strong) NSString *directory;
+@end
+
+@implementation BPTestTimeStoreTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssert([[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:nil]);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    [super tearDown];
+}
+
+- (NSString *)writeReportWithTimeA:(double)timeA timeB:(double)timeB {
+    NSString *report = [NSString stringWithFormat:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<testsuites name=\"All tests\">\n"
+                        "  <testsuite tests=\"3\" failures=\"1\" errors=\"1\" time=\"0\" name=\"SomeTests\">\n"
+                        "    <testcase classname=\"SomeTests\" name=\"testA\" time=\"%f\"/>\n"
+                        "    <testcase classname=\"SomeTests\" name=\"testB()\" time=\"%f\">\n"
+                        "      <failure type=\"Failure\" message=\"nope\">file.m:1</failure>\n"
+                        "    </testcase>\n"
+                        "    <testcase classname=\"SomeTests\" name=\"testCrash\" time=\"300\">\n"
+                        "      <error type=\"Error\" message=\"Test timed out\">file.m:2</error>\n"
+                        "    </testcase>\n"
+                        "  </testsuite>\n"
+                        "</testsuites>\n", timeA, timeB];
+    NSString *path = [self.directory stringByAppendingPathComponent:@"TEST-FinalReport.xml"];
+    XCTAssert([report writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    return path;
+}
+
+- (void)testStoreIsUpdatedFromReports {
+    NSString *storePath = [self.directory stringByAppendingPathComponent:@"store/times.json"];
+    NSError *error;
+    XCTAssertNil([BPTestTimeStore estimatesFromStoreAtPath:storePath withError:&error]);
+    XCTAssertNotNil(error);
+
+    error = nil;
+    XCTAssert([BPTestTimeStore updateStoreAtPath:storePath withJUnitReportAtPath:[self writeReportWithTimeA:10 timeB:2] withError:&error]);
+    XCTAssertNil(error);
+    NSDictionary<NSString *, NSNumber *> *estimates = [BPTestTimeStore estimatesFromStoreAtPath:storePath withError:&error];
+    XCTAssertEqualWithAccuracy([estimates[@"SomeTests/testA"] doubleValue], 10, 0.0001);
+    XCTAssertEqualWithAccuracy([estimates[@"SomeTests/testB()"] doubleValue], 2, 0.0001);
+    // The timed out test would skew the estimates.
+    XCTAssertNil(estimates[@"SomeTests/testCrash"]);
+
+    XCTAssert([BPTestTimeStore updateStoreAtPath:storePath withJUnitReportAtPath:[self writeReportWithTimeA:20 timeB:2] withError:&error]);
+    estimates = [BPTestTimeStore estimatesFromStoreAtPath:storePath withError:&error];
+    XCTAssertEqualWithAccuracy([estimates[@"SomeTests/testA"] doubleValue], 0.3 * 20 + 0.7 * 10, 0.0001);
+    XCTAssertEqual(estimates.count, 2);
+
+    NSDictionary *store = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:storePath] options:0 error:nil];
+    NSDictionary *entry = store[@"tests"][@"SomeTests/testA"];
+    XCTAssertEqualObjects(entry[@"runs"], @2);
+    XCTAssertEqualWithAccuracy([entry[@"p90"] doubleValue], 20, 0.0001);
+    XCTAssertEqual([entry[@"samples"] count], 2);
+}
+
+- (void)testCorruptStoreIsReplaced {
+    NSString *storePath = [self.directory stringByAppendingPathComponent:@"times.json"];
+    XCTAssert([@"{\"version\": 1, \"tests\": [" writeToFile:storePath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    NSError *error;
+    XCTAssertNil([BPTestTimeStore estimatesFromStoreAtPath:storePath withError:&error]);
+    error = nil;
+    XCTAssert([BPTestTimeStore updateStoreAtPath:storePath withJUnitReportAtPath:[self writeReportWithTimeA:1 timeB:1] withError:&error]);
+    XCTAssertEqual([[BPTestTimeStore estimatesFromStoreAtPath:storePath withError:&error] count], 2);
+}
+
+@end
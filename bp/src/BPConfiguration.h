@@ -86,6 +86,12 @@ typedef NS_ENUM(NSInteger, BPProgram) {
 @property (nonatomic, strong) NSString *configOutputFile;
 @property (nonatomic, strong) NSString *outputDirectory;
 @property (nonatomic, strong) NSString *testTimeEstimatesJsonFile;
+@property (nonatomic, strong) NSNumber *bundleOverhead;
+@property (nonatomic, strong) NSNumber *defaultTestTime;
+@property (nonatomic, strong) NSString *bundleOverheadStatsFile;
+@property (nonatomic, strong) NSString *testTimeStoreFile;
+@property (nonatomic) BOOL dynamicScheduling;
+@property (nonatomic, strong) NSNumber *maxSimulatorReuse;
 @property (nonatomic, strong) NSString *screenshotsDirectory;
 @property (nonatomic, strong) NSString *videosDirectory;
 @property (nonatomic) BOOL keepPassingVideos;
@@ -99,6 +105,12 @@ typedef NS_ENUM(NSInteger, BPProgram) {
 @property (nonatomic) BOOL quiet;
 @property (nonatomic, strong) NSString *deleteSimUDID;
 @property (nonatomic) BOOL keepSimulator;
+@property (nonatomic, strong) NSString *reuseSimUDID;
+@property (nonatomic, strong) NSString *simulatorHandoffFile;
+@property (nonatomic, strong) NSString *replayLogPath;
+@property (nonatomic) BOOL replayWithPacing;
+@property (nonatomic, strong) NSNumber *maxTestOutputSize;
+@property (nonatomic, strong) NSNumber *maxSuiteOutputSize;
 @property (nonatomic) BPProgram program; // one of BLUEPILL_BINARY or BP_BINARY
 @property (nonatomic) BOOL verboseLogging;
 @property (nonatomic, strong) NSNumber *maxCreateTries;
@@ -108,6 +120,7 @@ typedef NS_ENUM(NSInteger, BPProgram) {
 @property (nonatomic, strong) NSNumber *deleteTimeout;
 @property (nonatomic) BOOL keepIndividualTestReports;
 @property (nonatomic, strong) NSNumber *testBundleDisconnectTimeout;
+@property (nonatomic, strong) NSString *testInventoryCacheDirectory;
 
 @property (nonatomic, strong) NSArray<NSString *> *commandLineArguments; // command line arguments for the app
 @property (nonatomic, strong) NSDictionary<NSString *, NSString *> *environmentVariables;
@@ -152,6 +152,32 @@ struct BPOptions {
         "Whether recorded videos should be kept if the test passed. They are deleted by default."},
     {369, "test-bundle-disconnect-timeout", BLUEPILL_BINARY | BP_BINARY, NO, NO, required_argument, "60", BP_VALUE | BP_INTEGER, "testBundleDisconnectTimeout",
         "The maximum amount of time, in seconds, to wait while a test bundle is disconnected but might still generate output."},
+    {370, "test-inventory-cache-dir", BLUEPILL_BINARY | BP_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_PATH, "testInventoryCacheDirectory",
+        "Directory used to cache the tests discovered in each test bundle, keyed by the test binary's UUID. Can be shared between runs and processes. No caching if not provided."},
+    {371, "bundle-overhead", BLUEPILL_BINARY, NO, NO, required_argument, "30", BP_VALUE | BP_INTEGER, "bundleOverhead",
+        "Estimated fixed cost, in seconds, of running one test bundle (creating the simulator, installing and launching the app). Used when packing by time estimates."},
+    {372, "default-test-time", BLUEPILL_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_INTEGER, "defaultTestTime",
+        "Estimated time, in seconds, of a test missing from the test time estimates. Defaults to the average of the known estimates."},
+    {373, "bundle-overhead-stats", BLUEPILL_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_PATH, "bundleOverheadStatsFile",
+        "Path of the trace-profile.json of an earlier run. The per-bundle overhead of each test host is learned from its simulator create/clone, install and launch timers."},
+    {374, "test-time-store", BLUEPILL_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_PATH, "testTimeStoreFile",
+        "Path of a test time estimates store that every run updates from its final report. Used for packing when no test time estimates json is given."},
+    {375, "dynamic-scheduling", BLUEPILL_BINARY, NO, NO, no_argument, "Off", BP_VALUE | BP_BOOL, "dynamicScheduling",
+        "Instead of packing the tests into bundles up front, hand out batches of tests from a central queue whenever a simulator is free, in smaller batches as the queue drains."},
+    {376, "max-simulator-reuse", BLUEPILL_BINARY, NO, NO, required_argument, "0", BP_VALUE | BP_INTEGER, "maxSimulatorReuse",
+        "Keep healthy simulators booted between test bundles and reuse each one for up to this many more bundles of the same test host, reinstalling only the app. 0 turns this off."},
+    {377, "reuse-simulator", BP_BINARY, NO, NO, required_argument, NULL, BP_VALUE, "reuseSimUDID",
+        "Run on this booted simulator instead of creating one, after reinstalling the app. An unhealthy simulator is deleted and replaced. (BP INTERNAL USE ONLY)."},
+    {378, "simulator-handoff-file", BP_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_PATH, "simulatorHandoffFile",
+        "File to write the UDID of the simulator kept by --keep-simulator to. (BP INTERNAL USE ONLY)."},
+    {379, "replay", BP_BINARY, NO, NO, required_argument, NULL, BP_VALUE | BP_PATH, "replayLogPath",
+        "Instead of running tests, replay the recorded output of a test host (e.g. a simulator.log) through the result parser and write the JUnit report and stats like a real run."},
+    {380, "replay-pacing", BP_BINARY, NO, NO, no_argument, "Off", BP_VALUE | BP_BOOL, "replayWithPacing",
+        "With --replay, hold back each finished test for as long as it was reported to take, instead of replaying at full speed."},
+    {381, "max-test-output", BLUEPILL_BINARY | BP_BINARY, NO, NO, required_argument, "0", BP_VALUE | BP_INTEGER, "maxTestOutputSize",
+        "KB of output kept in memory and in the report at both the start and the end of each test case. The output in between is written to a file in the output directory, which the report refers to. 0 keeps all of it."},
+    {382, "max-suite-output", BLUEPILL_BINARY | BP_BINARY, NO, NO, required_argument, "0", BP_VALUE | BP_INTEGER, "maxSuiteOutputSize",
+        "Same as --max-test-output, for the output of each test suite outside of its test cases. 0 keeps all of it."},
     {0, 0, 0, 0, 0, 0, 0}
 };
 
@@ -663,6 +689,15 @@ static NSUUID *sessionID;
 
     [BPUtils enableDebugOutput:self.verboseLogging];
 
+    // A replay only reads the recorded output, it needs neither Xcode nor anything to test
+    if (self.replayLogPath) {
+        if (![[NSFileManager defaultManager] fileExistsAtPath:self.replayLogPath isDirectory:&isdir] || isdir) {
+            BP_SET_ERROR(errPtr, @"%@ not found.", self.replayLogPath);
+            return NO;
+        }
+        return YES;
+    }
+
     if (!self.xcodePath) {
         self.xcodePath = [BPUtils runShell:@"/usr/bin/xcode-select -print-path"];
     }
@@ -795,6 +830,23 @@ static NSUUID *sessionID;
         }
     }
 
+    if (self.testInventoryCacheDirectory) {
+        if ([[NSFileManager defaultManager] fileExistsAtPath:self.testInventoryCacheDirectory isDirectory:&isdir]) {
+            if (!isdir) {
+                BP_SET_ERROR(errPtr, @"%@ is not a directory.", self.testInventoryCacheDirectory);
+                return NO;
+            }
+        } else {
+            // create the directory
+            if (![[NSFileManager defaultManager] createDirectoryAtPath:self.testInventoryCacheDirectory
+                                           withIntermediateDirectories:YES
+                                                            attributes:nil
+                                                                 error:errPtr]) {
+                return NO;
+            }
+        }
+    }
+
     if (self.simulatorPreferencesFile) {
         if ([[NSFileManager defaultManager] fileExistsAtPath:self.simulatorPreferencesFile isDirectory:&isdir]) {
             if (isdir) {
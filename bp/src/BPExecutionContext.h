@@ -12,6 +12,8 @@
 
 @class BPConfiguration;
 @class BPSimulator;
+@class BPStats;
+@class BPTreeAssembler;
 @class BPTreeParser;
 
 @interface BPExecutionContext : NSObject
@@ -19,10 +21,20 @@
 @property (nonatomic, strong) BPConfiguration *config;
 @property (nonatomic, strong) BPSimulator *runner;
 @property (nonatomic, strong) BPTreeParser *parser;
+// The result tree of this context, continued by the parser of every attempt until cleanup
+@property (nonatomic, strong) BPTreeAssembler *assembler;
+@property (nonatomic, strong) BPStats *stats;
 @property (nonatomic, assign) NSInteger attemptNumber;
 @property (nonatomic, assign) BOOL simulatorCrashed;
 @property (nonatomic, assign) pid_t pid;
 @property (nonatomic, assign) BOOL isTestRunnerContext;
+// Seconds left to wait for the test process to exit after testmanagerd disconnected
+@property (nonatomic, assign) NSInteger disconnectDelay;
+
+// Tests that ran to completion in this context ("class/name"). These are only folded
+// into config.testCasesToSkip once the attempt finishes and a retry might need them.
+// The monitor adds to it from more than one queue, synchronize on the set to use it.
+@property (nonatomic, strong) NSMutableSet<NSString *> *executedTests;
 
 // current run's exit status
 @property (nonatomic, assign) BPExitStatus exitStatus;
@@ -0,0 +1,85 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/*!
+ An append-only record of the test suites and finished test cases of a run, from which a JUnit
+ report can be written when the run never got to write its own, e.g. after a simulator crash or
+ when bp was killed.
+
+ Each record is one JSON line, flushed as soon as it's written, so the journal stays readable up
+ to the last finished test whatever happens to the process. Test cases are recorded with their
+ <testcase> element already formatted and are never held in memory. Suites and test cases are
+ identified by the objects passed in, which the journal only references weakly.
+ */
+@interface BPJUnitJournal : NSObject
+
+@property (nonatomic, strong, readonly, nonnull) NSString *path;
+
+/*!
+ @discussion Start a new journal, replacing any previous one at that path.
+ @param path Where to write the journal.
+ @param errPtr Set if the journal can't be created.
+ @return The journal or nil.
+ */
++ (nullable instancetype)journalAtPath:(nonnull NSString *)path withError:(NSError * _Nullable * _Nullable)errPtr;
+
+/*!
+ @discussion Record the start of a test suite. The first suite without a parent is the root of the report.
+ @param suite The suite.
+ @param parent The suite it belongs to, nil for the root.
+ @param name The name attribute of the suite, already escaped.
+ @param timestamp The timestamp attribute of the suite.
+ */
+- (void)recordTestSuite:(nonnull id)suite
+            inTestSuite:(nullable id)parent
+               withName:(nonnull NSString *)name
+              timestamp:(nonnull NSString *)timestamp;
+
+/*!
+ @discussion Record the time XCTest reported for a test suite. Without it, the time of a suite
+ is the sum of the times of its children.
+ */
+- (void)recordTestSuite:(nonnull id)suite withReportedTime:(NSTimeInterval)time;
+
+/*!
+ @discussion Record a finished test case. Recording the same test case again replaces its
+ earlier result, e.g. when a test that was reported finished turns out to have crashed.
+ @param testCase The test case.
+ @param suite The suite it belongs to.
+ @param time The time attribute of the test case.
+ @param failure Whether the test case counts as a failure (a crash).
+ @param error Whether the test case counts as an error (a failed assertion).
+ @param junit Its <testcase> element, indented for its depth.
+ */
+- (void)recordTestCase:(nonnull id)testCase
+           inTestSuite:(nonnull id)suite
+              withTime:(NSTimeInterval)time
+               failure:(BOOL)failure
+                 error:(BOOL)error
+                 junit:(nonnull NSString *)junit;
+
+// Close the journal and delete it, once the run wrote its own report.
+- (void)discard;
+
+/*!
+ @discussion Write a JUnit report from a journal, in the same layout as JUnitReporter. The counts
+ of every suite are accumulated as the records are read. A record cut short by the end of the
+ file is ignored.
+ @param journalPath The journal.
+ @param reportPath Where to write the report. It's replaced atomically.
+ @param errPtr Set if the journal can't be read, has no root suite, or the report can't be written.
+ @return YES on success.
+ */
++ (BOOL)writeReportFromJournalAtPath:(nonnull NSString *)journalPath
+                              toFile:(nonnull NSString *)reportPath
+                           withError:(NSError * _Nullable * _Nullable)errPtr;
+
+@end
@@ -0,0 +1,319 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPJUnitJournal.h"
+#import "BPUtils.h"
+
+static NSString * const kJournalSuite = @"suite";
+static NSString * const kJournalParent = @"parent";
+static NSString * const kJournalName = @"name";
+static NSString * const kJournalTimestamp = @"timestamp";
+static NSString * const kJournalReportedTime = @"reportedTime";
+static NSString * const kJournalTestCase = @"testCase";
+static NSString * const kJournalTime = @"time";
+static NSString * const kJournalFailure = @"failure";
+static NSString * const kJournalError = @"error";
+static NSString * const kJournalJUnit = @"junit";
+
+static void BPJournalOutput(FILE *file, NSString *fmt, ...) NS_FORMAT_FUNCTION(2, 3);
+
+// A test suite of the report being written from a journal.
+@interface BPJournalSuite : NSObject
+@property (nonatomic, strong) NSString *name;
+@property (nonatomic, strong) NSString *timestamp;
+@property (nonatomic, weak) BPJournalSuite *parent;
+@property (nonatomic, assign) NSUInteger depth;
+@property (nonatomic, assign) NSUInteger numberOfTests;
+@property (nonatomic, assign) NSUInteger numberOfFailures;
+@property (nonatomic, assign) NSUInteger numberOfErrors;
+@property (nonatomic, assign) NSTimeInterval reportedTime;
+@property (nonatomic, assign) NSTimeInterval childrenTime;
+// Nested suites and test cases, in the order they were recorded
+@property (nonatomic, strong) NSMutableArray *children;
+- (NSTimeInterval)totalTime;
+@end
+
+@implementation BPJournalSuite
+
+- (NSTimeInterval)totalTime {
+    return self.reportedTime > 0 ? self.reportedTime : self.childrenTime;
+}
+
+@end
+
+// A test case of the report being written from a journal. Only the location of its record is kept.
+@interface BPJournalTestCase : NSObject
+@property (nonatomic, weak) BPJournalSuite *suite;
+@property (nonatomic, assign) NSRange record;
+@property (nonatomic, assign) NSTimeInterval time;
+@property (nonatomic, assign) BOOL failure;
+@property (nonatomic, assign) BOOL error;
+@end
+
+@implementation BPJournalTestCase
+@end
+
+@interface BPJUnitJournal ()
+@property (nonatomic, strong, readwrite) NSString *path;
+@property (nonatomic, assign) FILE *file;
+@property (nonatomic, strong) NSMapTable<id, NSNumber *> *identifiers;
+@property (nonatomic, assign) NSUInteger nextIdentifier;
+@end
+
+@implementation BPJUnitJournal
+
++ (instancetype)journalAtPath:(NSString *)path withError:(NSError **)errPtr {
+    FILE *file = fopen([path fileSystemRepresentation], "w");
+    if (!file) {
+        BP_SET_ERROR(errPtr, @"Could not create %@: %s", path, strerror(errno));
+        return nil;
+    }
+    BPJUnitJournal *journal = [[self alloc] init];
+    journal.path = path;
+    journal.file = file;
+    journal.identifiers = [NSMapTable weakToStrongObjectsMapTable];
+    return journal;
+}
+
+- (void)dealloc {
+    if (_file) {
+        fclose(_file);
+    }
+}
+
+- (void)recordTestSuite:(id)suite inTestSuite:(id)parent withName:(NSString *)name timestamp:(NSString *)timestamp {
+    NSMutableDictionary *record = [[NSMutableDictionary alloc] init];
+    record[kJournalName] = name;
+    record[kJournalTimestamp] = timestamp;
+    @synchronized (self) {
+        record[kJournalSuite] = [self identifierOf:suite];
+        if (parent) {
+            record[kJournalParent] = [self identifierOf:parent];
+        }
+        [self writeRecord:record];
+    }
+}
+
+- (void)recordTestSuite:(id)suite withReportedTime:(NSTimeInterval)time {
+    @synchronized (self) {
+        [self writeRecord:@{
+            kJournalSuite: [self identifierOf:suite],
+            kJournalReportedTime: @(isfinite(time) ? time : 0),
+        }];
+    }
+}
+
+- (void)recordTestCase:(id)testCase
+           inTestSuite:(id)suite
+              withTime:(NSTimeInterval)time
+               failure:(BOOL)failure
+                 error:(BOOL)error
+                 junit:(NSString *)junit {
+    @synchronized (self) {
+        [self writeRecord:@{
+            kJournalTestCase: [self identifierOf:testCase],
+            kJournalSuite: [self identifierOf:suite],
+            kJournalTime: @(isfinite(time) ? time : 0),
+            kJournalFailure: @(failure),
+            kJournalError: @(error),
+            kJournalJUnit: junit,
+        }];
+    }
+}
+
+- (void)discard {
+    @synchronized (self) {
+        if (self.file) {
+            fclose(self.file);
+            self.file = NULL;
+        }
+        [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+    }
+}
+
+- (NSNumber *)identifierOf:(id)object {
+    NSNumber *identifier = [self.identifiers objectForKey:object];
+    if (!identifier) {
+        identifier = @(++self.nextIdentifier);
+        [self.identifiers setObject:identifier forKey:object];
+    }
+    return identifier;
+}
+
+// One record per line, flushed right away so that nothing is lost if the process dies.
+- (void)writeRecord:(NSDictionary *)record {
+    if (!self.file) {
+        return;
+    }
+    NSError *error;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:record options:0 error:&error];
+    if (!data) {
+        [BPUtils printInfo:ERROR withString:@"Failed to journal a test result: %@", [error localizedDescription]];
+        return;
+    }
+    fwrite([data bytes], 1, [data length], self.file);
+    fputc('\n', self.file);
+    fflush(self.file);
+}
+
+#pragma mark - Writing the report
+
++ (BOOL)writeReportFromJournalAtPath:(NSString *)journalPath toFile:(NSString *)reportPath withError:(NSError **)errPtr {
+    NSError *error;
+    NSData *journal = [NSData dataWithContentsOfFile:journalPath options:NSDataReadingMappedIfSafe error:&error];
+    if (!journal) {
+        BP_SET_ERROR(errPtr, @"Could not read %@: %@", journalPath, [error localizedDescription]);
+        return NO;
+    }
+
+    // Accumulate the counts along the chain of suites of every test case as it's read, and only
+    // keep where each test case was recorded. Their elements are read back when the report is written.
+    NSMutableArray<BPJournalSuite *> *suites = [[NSMutableArray alloc] init];
+    NSMutableDictionary<NSNumber *, BPJournalSuite *> *suitesById = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary<NSNumber *, BPJournalTestCase *> *testCasesById = [[NSMutableDictionary alloc] init];
+    BPJournalSuite *root;
+    const char *bytes = [journal bytes];
+    NSUInteger length = [journal length];
+    NSUInteger lineStart = 0;
+    while (lineStart < length) {
+        const char *newline = memchr(bytes + lineStart, '\n', length - lineStart);
+        if (!newline) {
+            break;
+        }
+        NSRange range = NSMakeRange(lineStart, newline - bytes - lineStart);
+        lineStart = NSMaxRange(range) + 1;
+        @autoreleasepool {
+            NSDictionary *record = [self recordInJournal:journal atRange:range];
+            if (!record) {
+                continue;
+            }
+            BPJournalSuite *suite = suitesById[record[kJournalSuite]];
+            if (record[kJournalTestCase]) {
+                if (!suite) {
+                    continue;
+                }
+                NSNumber *identifier = record[kJournalTestCase];
+                BPJournalTestCase *testCase = testCasesById[identifier];
+                if (testCase) {
+                    [self removeTestCase:testCase];
+                } else {
+                    testCase = [[BPJournalTestCase alloc] init];
+                    testCase.suite = suite;
+                    testCasesById[identifier] = testCase;
+                    [suite.children addObject:testCase];
+                }
+                testCase.record = range;
+                testCase.time = [record[kJournalTime] doubleValue];
+                testCase.failure = [record[kJournalFailure] boolValue];
+                testCase.error = [record[kJournalError] boolValue];
+                [self addTestCase:testCase];
+            } else if (record[kJournalReportedTime]) {
+                suite.reportedTime = [record[kJournalReportedTime] doubleValue];
+            } else if (!suite && record[kJournalSuite]) {
+                suite = [[BPJournalSuite alloc] init];
+                suite.name = record[kJournalName] ?: @"";
+                suite.timestamp = record[kJournalTimestamp] ?: @"";
+                suite.children = [[NSMutableArray alloc] init];
+                // A suite whose parent was never recorded is kept under the root
+                BPJournalSuite *parent = suitesById[record[kJournalParent]] ?: root;
+                if (parent) {
+                    suite.parent = parent;
+                    suite.depth = parent.depth + 1;
+                    [parent.children addObject:suite];
+                } else {
+                    root = suite;
+                }
+                suitesById[record[kJournalSuite]] = suite;
+                [suites addObject:suite];
+            }
+        }
+    }
+    if (!root) {
+        BP_SET_ERROR(errPtr, @"%@ has no test suite to report.", journalPath);
+        return NO;
+    }
+    // Nested suites always come after their parent
+    for (BPJournalSuite *suite in [suites reverseObjectEnumerator]) {
+        suite.parent.childrenTime += [suite totalTime];
+    }
+
+    NSString *tmpPath = [BPUtils mkstemp:reportPath withError:&error];
+    FILE *output = tmpPath ? fopen([tmpPath fileSystemRepresentation], "w") : NULL;
+    if (!output) {
+        BP_SET_ERROR(errPtr, @"Could not create %@: %@", reportPath, tmpPath ? @(strerror(errno)) : [error localizedDescription]);
+        return NO;
+    }
+    BPJournalOutput(output, @"<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+    BPJournalOutput(output, @"<testsuites name=\"%@\" tests=\"%lu\" failures=\"%lu\" errors=\"%lu\" time=\"%f\">",
+                    root.name, root.numberOfTests, root.numberOfFailures, root.numberOfErrors, [root totalTime]);
+    [self writeChildrenOf:root fromJournal:journal toFile:output];
+    BPJournalOutput(output, @"</testsuites>");
+    BOOL written = !ferror(output);
+    written = (fclose(output) == 0) && written;
+    if (!written || rename([tmpPath fileSystemRepresentation], [reportPath fileSystemRepresentation]) != 0) {
+        BP_SET_ERROR(errPtr, @"Could not write %@: %s", reportPath, strerror(errno));
+        [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+        return NO;
+    }
+    return YES;
+}
+
++ (NSDictionary *)recordInJournal:(NSData *)journal atRange:(NSRange)range {
+    id record = [NSJSONSerialization JSONObjectWithData:[journal subdataWithRange:range] options:0 error:nil];
+    return [record isKindOfClass:[NSDictionary class]] ? record : nil;
+}
+
++ (void)addTestCase:(BPJournalTestCase *)testCase {
+    testCase.suite.childrenTime += testCase.time;
+    for (BPJournalSuite *suite = testCase.suite; suite; suite = suite.parent) {
+        suite.numberOfTests += 1;
+        suite.numberOfFailures += testCase.failure ? 1 : 0;
+        suite.numberOfErrors += testCase.error ? 1 : 0;
+    }
+}
+
++ (void)removeTestCase:(BPJournalTestCase *)testCase {
+    testCase.suite.childrenTime -= testCase.time;
+    for (BPJournalSuite *suite = testCase.suite; suite; suite = suite.parent) {
+        suite.numberOfTests -= 1;
+        suite.numberOfFailures -= testCase.failure ? 1 : 0;
+        suite.numberOfErrors -= testCase.error ? 1 : 0;
+    }
+}
+
++ (void)writeChildrenOf:(BPJournalSuite *)suite fromJournal:(NSData *)journal toFile:(FILE *)output {
+    for (id child in suite.children) {
+        @autoreleasepool {
+            if ([child isKindOfClass:[BPJournalSuite class]]) {
+                BPJournalSuite *childSuite = child;
+                NSString *indent = [@"" stringByPaddingToLength:(childSuite.depth * 2) withString:@" " startingAtIndex:0];
+                BPJournalOutput(output, @"%@<testsuite tests=\"%lu\" failures=\"%lu\" errors=\"%lu\" time=\"%f\" timestamp=\"%@\" name=\"%@\">",
+                                indent, childSuite.numberOfTests, childSuite.numberOfFailures, childSuite.numberOfErrors,
+                                [childSuite totalTime], childSuite.timestamp, childSuite.name);
+                [self writeChildrenOf:childSuite fromJournal:journal toFile:output];
+                BPJournalOutput(output, @"%@</testsuite>", indent);
+            } else {
+                BPJournalTestCase *testCase = child;
+                NSString *junit = [self recordInJournal:journal atRange:testCase.record][kJournalJUnit];
+                fputs([junit UTF8String] ?: "", output);
+            }
+        }
+    }
+}
+
+@end
+
+static void BPJournalOutput(FILE *file, NSString *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    NSString *str = [[NSString alloc] initWithFormat:fmt arguments:args];
+    va_end(args);
+    fputs([str UTF8String], file);
+    fputc('\n', file);
+}
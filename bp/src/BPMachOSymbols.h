@@ -0,0 +1,63 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/*!
+ Reads test methods straight out of the symbol table of a test bundle binary.
+
+ This replaces running `nm | swift-demangle` over every bundle. Both thin and
+ fat (universal) files are supported; for fat files the slice matching the host
+ architecture is used, falling back to the first 64-bit slice.
+
+ Each discovered test is returned as a two element array: @[className, testName].
+ Swift test names carry a trailing "()" the same way the demangler prints them.
+ */
+@interface BPMachOSymbols : NSObject
+
+/*!
+ @discussion Collect the Swift and Objective-C test methods from the Mach-O file at `path`.
+ Swift tests are the exported `Module.Class.test*()` methods, Objective-C tests are the
+ local `-[Class test*]` symbols in __TEXT,__text. Each list is sorted by symbol name.
+ @param path The path to the binary inside the .xctest bundle.
+ @param swiftTests Receives the Swift tests.
+ @param objcTests Receives the Objective-C tests.
+ @param errPtr Set if the file could not be read or is not a 64-bit Mach-O file.
+ @return YES on success.
+ */
++ (BOOL)readTestsFromBinary:(NSString *)path
+                 swiftTests:(NSArray<NSArray<NSString *> *> **)swiftTests
+                  objcTests:(NSArray<NSArray<NSString *> *> **)objcTests
+                  withError:(NSError **)errPtr;
+
+/*!
+ @discussion The LC_UUID of the slice `readTestsFromBinary:` would read.
+ @param path The path to the binary inside the .xctest bundle.
+ @return The UUID string, or nil if the file is not a Mach-O file or was linked without a UUID.
+ */
++ (NSString *)UUIDOfBinary:(NSString *)path;
+
+/*!
+ @discussion Demangle a Swift symbol of the form `Module.Class.method() -> ()`, optionally
+ `async` and/or `throws`. Anything else (thunks, descriptors, methods taking arguments,
+ nested types...) is rejected.
+ @param symbol The mangled symbol, with or without the leading underscore.
+ @return @[module, className, methodName] or nil if the symbol is not a plain class method.
+ */
++ (NSArray<NSString *> *)demangleSwiftMethodSymbol:(const char *)symbol;
+
+/*!
+ @discussion Resolve a Swift substitution (`A...`) against a list of earlier names. Exposed for tests.
+ @param substitution The whole substitution, starting with the 'A'.
+ @param substitutions The substitution candidates, in the order they appeared in the symbol.
+ @return The names it refers to, in order, or nil if it's malformed or out of range.
+ */
++ (NSArray<NSString *> *)demangleSwiftSubstitution:(const char *)substitution withSubstitutions:(NSArray<NSString *> *)substitutions;
+
+@end
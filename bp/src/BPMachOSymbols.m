@@ -0,0 +1,491 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPMachOSymbols.h"
+#import "BPUtils.h"
+#import <mach-o/fat.h>
+#import <mach-o/loader.h>
+#import <mach-o/nlist.h>
+#import <mach/machine.h>
+#import <libkern/OSByteOrder.h>
+
+#if defined(__arm64__)
+static const cpu_type_t BPHostCPUType = CPU_TYPE_ARM64;
+#else
+static const cpu_type_t BPHostCPUType = CPU_TYPE_X86_64;
+#endif
+
+// Same limit as the Swift demangler; later words are never substituted.
+#define BP_SWIFT_MAX_WORDS 26
+// Same limit as the Swift demangler on the repeat count of a substitution.
+#define BP_SWIFT_MAX_REPEAT 2048
+
+typedef struct {
+    const char *cur;
+    const char *end;
+    const char *words[BP_SWIFT_MAX_WORDS];
+    size_t wordLengths[BP_SWIFT_MAX_WORDS];
+    int numWords;
+} BPSwiftDemangler;
+
+static inline BOOL BPIsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline BOOL BPIsLower(char c) { return c >= 'a' && c <= 'z'; }
+static inline BOOL BPIsUpper(char c) { return c >= 'A' && c <= 'Z'; }
+
+static NSString *BPStringFromBytes(const char *bytes, size_t length) {
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+static long BPDemangleNatural(BPSwiftDemangler *d) {
+    if (d->cur >= d->end || !BPIsDigit(*d->cur)) {
+        return -1;
+    }
+    long value = 0;
+    while (d->cur < d->end && BPIsDigit(*d->cur)) {
+        value = value * 10 + (*d->cur++ - '0');
+        if (value > INT_MAX) {
+            return -1;
+        }
+    }
+    return value;
+}
+
+static BOOL BPIsWordStart(char c) {
+    return c != 0 && c != '_' && !BPIsDigit(c);
+}
+
+static BOOL BPIsWordEnd(char c, char prev) {
+    return c == 0 || c == '_' || (!BPIsUpper(prev) && BPIsUpper(c));
+}
+
+// identifier ::= NATURAL IDENTIFIER-STRING
+// identifier ::= '0' (NATURAL IDENTIFIER-STRING | [a-z] | [A-Z])+ with [A-Z] being the last word substitution
+// Punycoded identifiers ('00') never show up in test names and are rejected.
+static NSString *BPDemangleIdentifier(BPSwiftDemangler *d) {
+    if (d->cur >= d->end || !BPIsDigit(*d->cur)) {
+        return nil;
+    }
+    BOOL hasWordSubsts = NO;
+    if (*d->cur == '0') {
+        d->cur++;
+        if (d->cur < d->end && *d->cur == '0') {
+            return nil;
+        }
+        hasWordSubsts = YES;
+    }
+    NSMutableString *identifier = [NSMutableString string];
+    do {
+        while (hasWordSubsts && d->cur < d->end && (BPIsLower(*d->cur) || BPIsUpper(*d->cur))) {
+            char c = *d->cur++;
+            int wordIndex;
+            if (BPIsLower(c)) {
+                wordIndex = c - 'a';
+            } else {
+                wordIndex = c - 'A';
+                hasWordSubsts = NO;
+            }
+            if (wordIndex >= d->numWords) {
+                return nil;
+            }
+            NSString *word = BPStringFromBytes(d->words[wordIndex], d->wordLengths[wordIndex]);
+            if (!word) {
+                return nil;
+            }
+            [identifier appendString:word];
+        }
+        if (d->cur < d->end && *d->cur == '0') {
+            d->cur++;
+            break;
+        }
+        long length = BPDemangleNatural(d);
+        if (length <= 0 || length > d->end - d->cur) {
+            return nil;
+        }
+        const char *slice = d->cur;
+        NSString *literal = BPStringFromBytes(slice, length);
+        if (!literal) {
+            return nil;
+        }
+        [identifier appendString:literal];
+        // Remember the words of the literal so later identifiers can refer to them.
+        long wordStart = -1;
+        for (long i = 0; i <= length; i++) {
+            char c = i < length ? slice[i] : 0;
+            if (wordStart >= 0 && BPIsWordEnd(c, slice[i - 1])) {
+                if (i - wordStart >= 2 && d->numWords < BP_SWIFT_MAX_WORDS) {
+                    d->words[d->numWords] = slice + wordStart;
+                    d->wordLengths[d->numWords] = i - wordStart;
+                    d->numWords++;
+                }
+                wordStart = -1;
+            }
+            if (wordStart < 0 && BPIsWordStart(c)) {
+                wordStart = i;
+            }
+        }
+        d->cur += length;
+    } while (hasWordSubsts);
+    return identifier;
+}
+
+// substitution ::= 'A' INDEX                       // index 26 or more
+// INDEX ::= '_'                                      // 26
+// INDEX ::= NATURAL '_'                              // NATURAL + 27
+// substitution ::= 'A' SUBST-IDX* LAST-SUBST-IDX    // one or more indexes below 26
+// SUBST-IDX ::= NATURAL? [a-z]                       // the index repeated NATURAL times
+// LAST-SUBST-IDX ::= NATURAL? [A-Z]
+// Called after the 'A'. Appends the substituted names to `names`.
+static BOOL BPDemangleSubstitution(BPSwiftDemangler *d, NSArray<NSString *> *substitutions, NSMutableArray<NSString *> *names) {
+    while (d->cur < d->end) {
+        long repeatCount = -1;
+        if (BPIsDigit(*d->cur)) {
+            repeatCount = BPDemangleNatural(d);
+            if (repeatCount < 0 || d->cur >= d->end) {
+                return NO;
+            }
+        }
+        char c = *d->cur++;
+        if (c == '_') {
+            // The number wasn't a repeat count but an index past the letters.
+            long index = repeatCount < 0 ? 26 : repeatCount + 27;
+            if (index >= (long)substitutions.count) {
+                return NO;
+            }
+            [names addObject:substitutions[index]];
+            return YES;
+        }
+        if (!BPIsLower(c) && !BPIsUpper(c)) {
+            return NO;
+        }
+        long index = BPIsLower(c) ? c - 'a' : c - 'A';
+        if (index >= (long)substitutions.count || repeatCount > BP_SWIFT_MAX_REPEAT) {
+            return NO;
+        }
+        for (long i = 0; i < MAX(repeatCount, 1); i++) {
+            [names addObject:substitutions[index]];
+        }
+        if (BPIsUpper(c)) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+// Reads identifiers and substitutions up to the next operator into `names`. New identifiers
+// become substitution candidates.
+static BOOL BPDemangleNames(BPSwiftDemangler *d, NSMutableArray<NSString *> *substitutions, NSMutableArray<NSString *> *names) {
+    while (d->cur < d->end && (*d->cur == 'A' || BPIsDigit(*d->cur))) {
+        if (*d->cur == 'A') {
+            d->cur++;
+            if (!BPDemangleSubstitution(d, substitutions, names)) {
+                return NO;
+            }
+            continue;
+        }
+        NSString *identifier = BPDemangleIdentifier(d);
+        if (!identifier) {
+            return NO;
+        }
+        [substitutions addObject:identifier];
+        [names addObject:identifier];
+    }
+    return YES;
+}
+
+// Returns the slice of a thin or fat file to read symbols from, or NULL if there is no usable 64-bit slice.
+static const uint8_t *BPMachOImage(const uint8_t *bytes, size_t size, size_t *imageSize) {
+    uint32_t magic;
+    if (size < sizeof(magic)) {
+        return NULL;
+    }
+    memcpy(&magic, bytes, sizeof(magic));
+    if (magic == MH_MAGIC_64) {
+        *imageSize = size;
+        return bytes;
+    }
+    magic = OSSwapBigToHostInt32(magic);
+    if ((magic != FAT_MAGIC && magic != FAT_MAGIC_64) || size < sizeof(struct fat_header)) {
+        return NULL;
+    }
+    struct fat_header header;
+    memcpy(&header, bytes, sizeof(header));
+    uint32_t count = OSSwapBigToHostInt32(header.nfat_arch);
+    size_t archSize = (magic == FAT_MAGIC_64) ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+    if (count > (size - sizeof(header)) / archSize) {
+        return NULL;
+    }
+    const uint8_t *fallback = NULL;
+    size_t fallbackSize = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *arch = bytes + sizeof(header) + i * archSize;
+        cpu_type_t cpuType;
+        uint64_t offset, length;
+        if (magic == FAT_MAGIC_64) {
+            struct fat_arch_64 fatArch;
+            memcpy(&fatArch, arch, sizeof(fatArch));
+            cpuType = OSSwapBigToHostInt32(fatArch.cputype);
+            offset = OSSwapBigToHostInt64(fatArch.offset);
+            length = OSSwapBigToHostInt64(fatArch.size);
+        } else {
+            struct fat_arch fatArch;
+            memcpy(&fatArch, arch, sizeof(fatArch));
+            cpuType = OSSwapBigToHostInt32(fatArch.cputype);
+            offset = OSSwapBigToHostInt32(fatArch.offset);
+            length = OSSwapBigToHostInt32(fatArch.size);
+        }
+        if (offset > size || length > size - offset) {
+            continue;
+        }
+        if (cpuType == BPHostCPUType) {
+            *imageSize = length;
+            return bytes + offset;
+        }
+        if (!fallback && (cpuType & CPU_ARCH_ABI64)) {
+            fallback = bytes + offset;
+            fallbackSize = length;
+        }
+    }
+    *imageSize = fallbackSize;
+    return fallback;
+}
+
+// Calls `block` for each load command of a 64-bit Mach-O image. Returns NO if the header is not valid.
+static BOOL BPEnumerateLoadCommands(const uint8_t *image, size_t size, void (^block)(uint32_t cmd, const uint8_t *bytes, uint32_t cmdsize)) {
+    struct mach_header_64 header;
+    if (size < sizeof(header)) {
+        return NO;
+    }
+    memcpy(&header, image, sizeof(header));
+    if (header.magic != MH_MAGIC_64 || header.sizeofcmds > size - sizeof(header)) {
+        return NO;
+    }
+    const uint8_t *cmd = image + sizeof(header);
+    const uint8_t *cmdsEnd = cmd + header.sizeofcmds;
+    for (uint32_t i = 0; i < header.ncmds; i++) {
+        struct load_command loadCommand;
+        if (cmdsEnd - cmd < (ptrdiff_t)sizeof(loadCommand)) {
+            break;
+        }
+        memcpy(&loadCommand, cmd, sizeof(loadCommand));
+        if (loadCommand.cmdsize < sizeof(loadCommand) || loadCommand.cmdsize > cmdsEnd - cmd) {
+            break;
+        }
+        block(loadCommand.cmd, cmd, loadCommand.cmdsize);
+        cmd += loadCommand.cmdsize;
+    }
+    return YES;
+}
+
+// Parses `-[Class testMethod]` (or `+[...]`) into @[Class, testMethod].
+static NSArray<NSString *> *BPObjCTestFromSymbol(const char *name, size_t length) {
+    if (length < 4 || (name[0] != '-' && name[0] != '+') || name[1] != '[' || name[length - 1] != ']') {
+        return nil;
+    }
+    const char *contents = name + 2;
+    size_t contentsLength = length - 3;
+    const char *space = memchr(contents, ' ', contentsLength);
+    if (!space || space == contents || memchr(space + 1, ' ', contents + contentsLength - space - 1)) {
+        return nil;
+    }
+    const char *method = space + 1;
+    size_t methodLength = contents + contentsLength - method;
+    if (methodLength < 4 || strncmp(method, "test", 4) != 0) {
+        return nil;
+    }
+    NSString *className = BPStringFromBytes(contents, space - contents);
+    NSString *testName = BPStringFromBytes(method, methodLength);
+    return (className && testName) ? @[className, testName] : nil;
+}
+
+static NSArray<NSArray<NSString *> *> *BPSortedTests(NSMutableArray<NSArray *> *tests) {
+    [tests sortUsingComparator:^NSComparisonResult(NSArray *a, NSArray *b) {
+        return [(NSString *)a[0] compare:b[0] options:NSLiteralSearch];
+    }];
+    NSMutableArray<NSArray<NSString *> *> *sorted = [[NSMutableArray alloc] initWithCapacity:tests.count];
+    for (NSArray *test in tests) {
+        [sorted addObject:test[1]];
+    }
+    return sorted;
+}
+
+@implementation BPMachOSymbols
+
++ (BOOL)readTestsFromBinary:(NSString *)path
+                 swiftTests:(NSArray<NSArray<NSString *> *> **)swiftTests
+                  objcTests:(NSArray<NSArray<NSString *> *> **)objcTests
+                  withError:(NSError **)errPtr {
+    NSError *error;
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:&error];
+    if (!data) {
+        BP_SET_ERROR(errPtr, @"Could not read %@: %@", path, [error localizedDescription]);
+        return NO;
+    }
+    size_t size = 0;
+    const uint8_t *image = BPMachOImage(data.bytes, data.length, &size);
+
+    // Find the symbol table and the ordinal of __TEXT,__text (sections are numbered from 1 across all segments).
+    __block uint32_t sectionCount = 0;
+    __block uint32_t textSection = NO_SECT;
+    __block struct symtab_command symtab = {0};
+    BOOL valid = image && BPEnumerateLoadCommands(image, size, ^(uint32_t cmd, const uint8_t *bytes, uint32_t cmdsize) {
+        if (cmd == LC_SEGMENT_64 && cmdsize >= sizeof(struct segment_command_64)) {
+            struct segment_command_64 segment;
+            memcpy(&segment, bytes, sizeof(segment));
+            uint32_t nsects = MIN(segment.nsects, (uint32_t)((cmdsize - sizeof(segment)) / sizeof(struct section_64)));
+            for (uint32_t j = 0; j < nsects; j++) {
+                struct section_64 section;
+                memcpy(&section, bytes + sizeof(segment) + j * sizeof(section), sizeof(section));
+                sectionCount++;
+                if (strncmp(section.segname, SEG_TEXT, sizeof(section.segname)) == 0 &&
+                    strncmp(section.sectname, SECT_TEXT, sizeof(section.sectname)) == 0) {
+                    textSection = sectionCount;
+                }
+            }
+        } else if (cmd == LC_SYMTAB && cmdsize >= sizeof(symtab)) {
+            memcpy(&symtab, bytes, sizeof(symtab));
+        }
+    });
+    if (!valid) {
+        BP_SET_ERROR(errPtr, @"%@ is not a 64-bit Mach-O file.", path);
+        return NO;
+    }
+
+    NSMutableArray<NSArray *> *swift = [[NSMutableArray alloc] init];
+    NSMutableArray<NSArray *> *objc = [[NSMutableArray alloc] init];
+    if (symtab.nsyms > 0) {
+        if (symtab.symoff > size || symtab.nsyms > (size - symtab.symoff) / sizeof(struct nlist_64) ||
+            symtab.stroff > size || symtab.strsize > size - symtab.stroff) {
+            BP_SET_ERROR(errPtr, @"%@ has a malformed symbol table.", path);
+            return NO;
+        }
+        const uint8_t *symbols = image + symtab.symoff;
+        const char *strings = (const char *)image + symtab.stroff;
+        for (uint32_t i = 0; i < symtab.nsyms; i++) {
+            struct nlist_64 symbol;
+            memcpy(&symbol, symbols + i * sizeof(symbol), sizeof(symbol));
+            if ((symbol.n_type & N_STAB) || symbol.n_un.n_strx == 0 || symbol.n_un.n_strx >= symtab.strsize) {
+                continue;
+            }
+            const char *name = strings + symbol.n_un.n_strx;
+            size_t maxLength = symtab.strsize - symbol.n_un.n_strx;
+            size_t length = strnlen(name, maxLength);
+            if (length == maxLength) {
+                continue;
+            }
+            uint8_t type = symbol.n_type & N_TYPE;
+            if (symbol.n_type & N_EXT) {
+                // Swift tests are exported, defined symbols.
+                if (type == N_UNDF) {
+                    continue;
+                }
+                NSArray<NSString *> *parts = [self demangleSwiftMethodSymbol:name];
+                if (!parts) {
+                    continue;
+                }
+                NSString *fullName = [parts componentsJoinedByString:@"."];
+                if ([fullName containsString:@".test"] || [fullName containsString:@"_test"]) {
+                    [swift addObject:@[BPStringFromBytes(name, length), @[parts[1], parts[2]]]];
+                }
+            } else if (type == N_SECT && textSection != NO_SECT && symbol.n_sect == textSection) {
+                // Objective-C methods are local symbols in __TEXT,__text.
+                NSArray<NSString *> *test = BPObjCTestFromSymbol(name, length);
+                if (test) {
+                    [objc addObject:@[BPStringFromBytes(name, length), test]];
+                }
+            }
+        }
+    }
+    if (swiftTests) {
+        *swiftTests = BPSortedTests(swift);
+    }
+    if (objcTests) {
+        *objcTests = BPSortedTests(objc);
+    }
+    return YES;
+}
+
++ (NSString *)UUIDOfBinary:(NSString *)path {
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    size_t size = 0;
+    const uint8_t *image = data ? BPMachOImage(data.bytes, data.length, &size) : NULL;
+    if (!image) {
+        return nil;
+    }
+    __block NSString *uuidString;
+    BPEnumerateLoadCommands(image, size, ^(uint32_t cmd, const uint8_t *bytes, uint32_t cmdsize) {
+        if (cmd == LC_UUID && cmdsize >= sizeof(struct uuid_command)) {
+            struct uuid_command uuid;
+            memcpy(&uuid, bytes, sizeof(uuid));
+            uuidString = [[[NSUUID alloc] initWithUUIDBytes:uuid.uuid] UUIDString];
+        }
+    });
+    return uuidString;
+}
+
++ (NSArray<NSString *> *)demangleSwiftMethodSymbol:(const char *)symbol {
+    // Swift 4 (_T0), 4.2 ($S) and 5+ ($s) all share the grammar below.
+    size_t prefixLength = 0;
+    for (int attempt = 0; attempt < 2 && !prefixLength; attempt++) {
+        if (strncmp(symbol, "$s", 2) == 0 || strncmp(symbol, "$S", 2) == 0) {
+            prefixLength = 2;
+        } else if (strncmp(symbol, "_T0", 3) == 0) {
+            prefixLength = 3;
+        } else if (symbol[0] == '_') {
+            symbol++;
+        } else {
+            break;
+        }
+    }
+    if (!prefixLength) {
+        return nil;
+    }
+    BPSwiftDemangler d = {0};
+    d.cur = symbol + prefixLength;
+    d.end = symbol + strlen(symbol);
+    // Every test method ends with the function entity marker; reject the rest before doing any work.
+    if (d.end == d.cur || d.end[-1] != 'F') {
+        return nil;
+    }
+    NSMutableArray<NSString *> *substitutions = [[NSMutableArray alloc] init];
+    // The class context is the module and the class name, the method its only name.
+    NSMutableArray<NSString *> *context = [[NSMutableArray alloc] init];
+    if (!BPDemangleNames(&d, substitutions, context) || context.count != 2 || d.cur >= d.end || *d.cur++ != 'C') {
+        return nil;
+    }
+    NSString *module = context[0];
+    NSString *className = context[1];
+    // The class type itself is a substitution candidate as well.
+    [substitutions addObject:className];
+    NSMutableArray<NSString *> *methodNames = [[NSMutableArray alloc] init];
+    if (!BPDemangleNames(&d, substitutions, methodNames) || methodNames.count != 1) {
+        return nil;
+    }
+    NSString *method = methodNames[0];
+    // `yy` is `() -> ()`, optionally followed by the async (`Ya`) and throws (`K`) effects.
+    static const char *signatures[] = { "yyF", "yyKF", "yyYaF", "yyYaKF" };
+    for (size_t i = 0; i < sizeof(signatures) / sizeof(signatures[0]); i++) {
+        if (strcmp(d.cur, signatures[i]) == 0) {
+            return @[module, className, [method stringByAppendingString:@"()"]];
+        }
+    }
+    return nil;
+}
+
++ (NSArray<NSString *> *)demangleSwiftSubstitution:(const char *)substitution withSubstitutions:(NSArray<NSString *> *)substitutions {
+    BPSwiftDemangler d = {0};
+    d.cur = substitution;
+    d.end = substitution + strlen(substitution);
+    NSMutableArray<NSString *> *names = [[NSMutableArray alloc] init];
+    if (d.cur >= d.end || *d.cur++ != 'A' || !BPDemangleSubstitution(&d, substitutions, names) || d.cur != d.end) {
+        return nil;
+    }
+    return names;
+}
+
+@end
@@ -0,0 +1,44 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "BPExitStatus.h"
+
+@class BPConfiguration;
+
+/*!
+ Replays the recorded output of a test host through the result pipeline (BPTreeParser,
+ SimulatorMonitor, BPStats and JUnitReporter) without a simulator.
+
+ The output is streamed through the parser in chunks, like a real run would read it, and the
+ JUnit report is written to the output directory under the same name as in a real run. Since
+ nothing else runs, a replay is deterministic and measures the cost of the pipeline alone.
+ */
+@interface BPReplay : NSObject
+
+/*!
+ @discussion Replay a recorded test host output, attempt 1.
+ @param path The recorded output, e.g. a simulator.log of an earlier run.
+ @param config The configuration. When config.replayWithPacing is set, the output is held back
+ before each finished test for as long as the test was reported to take, so the monitor's
+ timeouts fire as they would have. Otherwise it's replayed at full speed.
+ @param errPtr Set if the output can't be read.
+ @return The exit status the run would have had.
+ */
++ (BPExitStatus)replayOutputAtPath:(NSString *)path
+                 withConfiguration:(BPConfiguration *)config
+                             error:(NSError **)errPtr;
+
+/*!
+ @discussion The name reports of this configuration are written under, without extension.
+ It's the name of the test bundle, or of the recorded output when replaying without one.
+ */
++ (NSString *)reportNameWithConfiguration:(BPConfiguration *)config;
+
+@end
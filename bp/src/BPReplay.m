@@ -0,0 +1,148 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPReplay.h"
+#import "BPConfiguration.h"
+#import "BPReporters.h"
+#import "BPStats.h"
+#import "BPTreeParser.h"
+#import "BPUtils.h"
+#import "BPWriter.h"
+#import "SimulatorMonitor.h"
+
+// Same as the reads of a real run's output, which come in at most this many bytes at a time
+static const NSUInteger kReplayChunkSize = 64 * 1024;
+
+@implementation BPReplay
+
++ (BPExitStatus)replayOutputAtPath:(NSString *)path
+                 withConfiguration:(BPConfiguration *)config
+                             error:(NSError **)errPtr {
+    NSInputStream *input = [NSInputStream inputStreamWithFileAtPath:path];
+    [input open];
+    if ([input streamStatus] != NSStreamStatusOpen) {
+        BP_SET_ERROR(errPtr, @"Could not open %@: %@", path, [[input streamError] localizedDescription]);
+        return BPExitStatusLaunchAppFailed;
+    }
+
+    NSUInteger attemptNumber = 1;
+    [BPUtils printInfo:INFO withString:@"Replaying %@", path];
+    [BPStats sharedStats].attemptNumber = attemptNumber;
+    [[BPStats sharedStats] startTimer:LAUNCH_APPLICATION(attemptNumber)];
+
+    NSString *simulatorLogPath;
+    if (config.outputDirectory) {
+        simulatorLogPath = [config.outputDirectory stringByAppendingPathComponent:[NSString stringWithFormat:@"%lu-simulator.log", attemptNumber]];
+    } else {
+        simulatorLogPath = [BPUtils mkstemp:[NSString stringWithFormat:@"%@/%lu-bp-replay-%u", NSTemporaryDirectory(), attemptNumber, getpid()]
+                                  withError:nil] ?: [NSString stringWithFormat:@"/tmp/%lu-simulator.log", attemptNumber];
+    }
+    BPWriter *simulatorWriter = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:simulatorLogPath];
+    simulatorWriter.asynchronous = YES;
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:simulatorWriter];
+    parser.maxLogSize = [config.maxTestOutputSize unsignedIntegerValue] * 1024;
+    parser.maxSuiteLogSize = [config.maxSuiteOutputSize unsignedIntegerValue] * 1024;
+    parser.logSpillDirectory = config.outputDirectory;
+    SimulatorMonitor *monitor = [[SimulatorMonitor alloc] initWithConfiguration:config];
+    monitor.executedTests = [[NSMutableSet alloc] init];
+    parser.delegate = monitor;
+
+    NSMutableData *buffer = [NSMutableData dataWithLength:kReplayChunkSize];
+    NSMutableData *pending = [[NSMutableData alloc] init];
+    NSInteger length;
+    while ((length = [input read:[buffer mutableBytes] maxLength:kReplayChunkSize]) > 0) {
+        @autoreleasepool {
+            NSData *chunk = [NSData dataWithBytes:[buffer bytes] length:length];
+            if (config.replayWithPacing) {
+                [pending appendData:chunk];
+                [self feedCompleteLinesOf:pending toParser:parser];
+            } else {
+                [parser handleChunkData:chunk];
+            }
+        }
+    }
+    if (length < 0) {
+        [BPUtils printInfo:ERROR withString:@"Failed to read %@: %@", path, [[input streamError] localizedDescription]];
+    }
+    [input close];
+    if ([pending length]) {
+        [parser handleChunkData:pending];
+    }
+
+    // The test host exited, same as BPSimulator reports it
+    monitor.appState = Completed;
+    [monitor setParserStateCompleted];
+    [parser handleChunkData:[@"\nBP_APP_PROC_ENDED\n" dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser completed];
+
+    BPExitStatus exitStatus = monitor.exitStatus;
+    [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(attemptNumber) withResult:[BPExitStatusHelper stringFromExitStatus:exitStatus]];
+
+    if (config.outputDirectory) {
+        NSString *fileName = [NSString stringWithFormat:@"TEST-%@-%lu-results.xml",
+                              [self reportNameWithConfiguration:config], attemptNumber];
+        NSString *outputFile = [config.outputDirectory stringByAppendingPathComponent:fileName];
+        [BPUtils printInfo:INFO withString:@"Writing JUnit report to: %@", outputFile];
+        BPWriter *junitLog = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:outputFile];
+        [junitLog writeLine:@"%@", [parser generateLog:[[JUnitReporter alloc] init]]];
+        [junitLog close];
+    }
+    [simulatorWriter close];
+    [parser cleanup];
+    [BPUtils printInfo:INFO withString:@"Replay finished: %@", [BPExitStatusHelper stringFromExitStatus:exitStatus]];
+    return exitStatus;
+}
+
++ (NSString *)reportNameWithConfiguration:(BPConfiguration *)config {
+    return [[(config.testBundlePath ?: config.replayLogPath) lastPathComponent] stringByDeletingPathExtension];
+}
+
+// Hand the complete lines over one by one, holding back every finished test for as long as it took.
++ (void)feedCompleteLinesOf:(NSMutableData *)pending toParser:(BPTreeParser *)parser {
+    const char *bytes = [pending bytes];
+    NSUInteger length = [pending length];
+    NSUInteger lineStart = 0;
+    while (lineStart < length) {
+        const char *newline = memchr(bytes + lineStart, '\n', length - lineStart);
+        if (!newline) {
+            break;
+        }
+        NSUInteger lineEnd = newline - bytes + 1;
+        NSData *lineData = [pending subdataWithRange:NSMakeRange(lineStart, lineEnd - lineStart)];
+        NSTimeInterval duration = [self reportedDurationOfLine:lineData];
+        if (duration > 0) {
+            [BPUtils runWithTimeOut:duration until:^BOOL{
+                return NO;
+            }];
+        }
+        [parser handleChunkData:lineData];
+        lineStart = lineEnd;
+    }
+    [pending replaceBytesInRange:NSMakeRange(0, lineStart) withBytes:NULL length:0];
+}
+
+// The duration of a "Test Case '-[...]' passed (1.037 seconds)." line, 0 for any other line.
++ (NSTimeInterval)reportedDurationOfLine:(NSData *)lineData {
+    static NSRegularExpression *regex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_PASSED options:0 error:nil];
+    });
+    if (!memmem([lineData bytes], [lineData length], "Test Case '-[", 13)) {
+        return 0;
+    }
+    NSString *line = [[NSString alloc] initWithData:lineData encoding:NSUTF8StringEncoding];
+    NSTextCheckingResult *result = line ? [regex firstMatchInString:line options:0 range:NSMakeRange(0, [line length])] : nil;
+    if ([result numberOfRanges] != 5) {
+        return 0;
+    }
+    return [[line substringWithRange:[result rangeAtIndex:4]] doubleValue];
+}
+
+@end
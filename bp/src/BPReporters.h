@@ -10,6 +10,7 @@
 #import <Foundation/Foundation.h>
 
 @class BPLogEntry;
+@class BPTestCaseLogEntry;
 
 @protocol BPReporter <NSObject>
 
@@ -21,5 +22,14 @@
 @end
 
 @interface JUnitReporter : NSObject<BPReporter>
+
++ (nullable NSString *)xmlSimpleEscape:(nullable NSString *)originalString;
+
+// The timestamp attribute of a test suite that started on that date
++ (nullable NSString *)timestampFromDate:(nullable NSDate *)date;
+
+// The <testcase> element of a test case, one line per element, indented for that level
++ (nonnull NSString *)junitForTestCase:(nonnull BPTestCaseLogEntry *)caseLogEntry withIndentLevel:(NSInteger)indent;
+
 @end
 
@@ -51,14 +51,11 @@ void Output(NSMutableString *appendTo, NSString *fmt, ...);
     if ([logEntry isKindOfClass:[BPTestSuiteLogEntry class]]) {
         BPTestSuiteLogEntry *suiteLogEntry = (BPTestSuiteLogEntry *)logEntry;
         if (suiteLogEntry != self.root) {
-            NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-            dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss'GMT'ZZZZZ";
-            dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]; // Always get nil for stringFromDate: without this
             Output(output, @"%@<testsuite tests=\"%lu\" failures=\"%lu\" errors=\"%lu\" time=\"%f\" timestamp=\"%@\" name=\"%@\">",
                    [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0],
                    suiteLogEntry.numberOfTests, suiteLogEntry.numberOfFailures, suiteLogEntry.numberOfErrors,
                    suiteLogEntry.totalTime,
-                   [dateFormatter stringFromDate:suiteLogEntry.startTime],
+                   [JUnitReporter timestampFromDate:suiteLogEntry.startTime],
                    [JUnitReporter xmlSimpleEscape:suiteLogEntry.testSuiteName]);
         }
         for (BPLogEntry *suiteChild in suiteLogEntry.children) {
@@ -68,42 +65,57 @@ void Output(NSMutableString *appendTo, NSString *fmt, ...);
             Output(output, @"%@</testsuite>", [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0]);
         }
     } else if ([logEntry isKindOfClass:[BPTestCaseLogEntry class]]) {
-        BPTestCaseLogEntry *caseLogEntry = (BPTestCaseLogEntry *)logEntry;
-
-        Output(output, @"%@<testcase classname=\"%@\" name=\"%@\" time=\"%f\">",
-               [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0],
-               [JUnitReporter xmlSimpleEscape:caseLogEntry.testCaseClass],
-               [JUnitReporter xmlSimpleEscape:caseLogEntry.testCaseName],
-               caseLogEntry.totalTime);
-
-        if (!caseLogEntry.passed) {
-            NSString *entity = @"error";
-            NSString *attribute = @"Error";
-            if (caseLogEntry.failure) {
-                entity = @"failure";
-                attribute = @"Failure";
-            }
-            Output(output, @"%@<%@ type=\"%@\" message=\"%@\">\n%@:%lu\n%@</%@>",
-                   [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
-                   entity, attribute,
-                   [JUnitReporter xmlSimpleEscape:caseLogEntry.errorMessage] ?: [@"UNKNOWN ERROR - PARSING FAILED: " stringByAppendingString:caseLogEntry.line],
-                   [JUnitReporter xmlSimpleEscape:caseLogEntry.filename ?: @"Unknown File"],
-                   caseLogEntry.lineNumber,
-                   [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
-                   entity);
-        }
+        [output appendString:[JUnitReporter junitForTestCase:(BPTestCaseLogEntry *)logEntry withIndentLevel:indent]];
+    }
+}
 
-        if (caseLogEntry.log) {
-            if (![JUnitReporter suppressStackTracesInOutput] || ![caseLogEntry.log containsString:@"BP_"]) {
-                Output(output, @"%@<system-out>\n%@%@</system-out>",
-                       [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
-                       [JUnitReporter xmlSimpleEscape:caseLogEntry.log],
-                       [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0]);
-            }
++ (NSString *)junitForTestCase:(BPTestCaseLogEntry *)caseLogEntry withIndentLevel:(NSInteger)indent {
+    NSMutableString *output = [NSMutableString string];
+    Output(output, @"%@<testcase classname=\"%@\" name=\"%@\" time=\"%f\">",
+           [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0],
+           [JUnitReporter xmlSimpleEscape:caseLogEntry.testCaseClass],
+           [JUnitReporter xmlSimpleEscape:caseLogEntry.testCaseName],
+           caseLogEntry.totalTime);
+
+    if (!caseLogEntry.passed) {
+        NSString *entity = @"error";
+        NSString *attribute = @"Error";
+        if (caseLogEntry.failure) {
+            entity = @"failure";
+            attribute = @"Failure";
         }
+        Output(output, @"%@<%@ type=\"%@\" message=\"%@\">\n%@:%lu\n%@</%@>",
+               [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
+               entity, attribute,
+               [JUnitReporter xmlSimpleEscape:caseLogEntry.errorMessage] ?: [@"UNKNOWN ERROR - PARSING FAILED: " stringByAppendingString:caseLogEntry.line],
+               [JUnitReporter xmlSimpleEscape:caseLogEntry.filename ?: @"Unknown File"],
+               caseLogEntry.lineNumber,
+               [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
+               entity);
+    }
 
-        Output(output, @"%@</testcase>", [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0]);
+    if (caseLogEntry.log) {
+        if (![JUnitReporter suppressStackTracesInOutput] || ![caseLogEntry.log containsString:@"BP_"]) {
+            Output(output, @"%@<system-out>\n%@%@</system-out>",
+                   [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0],
+                   [JUnitReporter xmlSimpleEscape:caseLogEntry.log],
+                   [@"" stringByPaddingToLength:((indent+1)*2) withString:@" " startingAtIndex:0]);
+        }
     }
+
+    Output(output, @"%@</testcase>", [@"" stringByPaddingToLength:(indent*2) withString:@" " startingAtIndex:0]);
+    return output;
+}
+
++ (NSString *)timestampFromDate:(NSDate *)date {
+    static NSDateFormatter *dateFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss'GMT'ZZZZZ";
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]; // Always get nil for stringFromDate: without this
+    });
+    return [dateFormatter stringFromDate:date];
 }
 
 + (NSString *)xmlSimpleEscape:(NSString *)originalString {
@@ -13,6 +13,7 @@
 #import "BPXCTestFile.h"
 
 @class BPConfiguration;
+@class BPStats;
 @class BPTreeParser;
 @class SimDevice;
 
@@ -24,6 +25,11 @@
 @property (nonatomic, strong) SimDevice *device;
 @property (nonatomic, strong) NSURL *preferencesFile;
 
+/*!
+ * @discussion Where the template timers go. Defaults to the shared stats
+ */
+@property (nonatomic, strong) BPStats *stats;
+
 + (instancetype)simulatorWithConfiguration:(BPConfiguration *)config;
 
 - (void)createSimulatorWithDeviceName:(NSString *)deviceName completion:(void (^)(NSError *))completion;
@@ -36,6 +42,8 @@
 
 - (BOOL)uninstallApplicationWithError:(NSError **)errPtr;
 
+- (BOOL)isApplicationInstalled;
+
 - (void)bootWithCompletion:(void (^)(NSError *error))completion;
 
 - (BOOL)installApplicationWithError:(NSError *__autoreleasing *)errPtr;
@@ -13,6 +13,7 @@
 #import "BPConstants.h"
 #import "BPCreateSimulatorHandler.h"
 #import "BPSimulator.h"
+#import "BPStats.h"
 #import "BPTreeParser.h"
 #import "BPUtils.h"
 #import "BPWaitTimer.h"
@@ -20,6 +21,12 @@
 #import "SimulatorHelper.h"
 #import "PrivateHeaders/CoreSimulator/SimDeviceBootInfo.h"
 
+// How many template simulators are provisioned at the same time in clone mode.
+static const NSUInteger kMaxConcurrentTemplates = 4;
+// How long to wait for the test host to show up on a template after installing it.
+static const NSTimeInterval kTemplateInstallTimeout = 15.0;
+static const NSTimeInterval kTemplatePollInterval = 0.25;
+
 @interface BPSimulator()
 
 @property (nonatomic, strong) BPConfiguration *config;
@@ -35,43 +42,60 @@
 + (instancetype)simulatorWithConfiguration:(BPConfiguration *)config {
     BPSimulator *sim = [[self alloc] init];
     sim.config = config;
+    sim.stats = [BPStats sharedStats];
     return sim;
 }
 
 - (NSMutableDictionary *)createSimulatorAndInstallAppWithBundles:(NSArray<BPXCTestFile *>*)testBundles {
-    NSMutableDictionary* testHostSimTemplates = [[NSMutableDictionary alloc] init];
-    NSString *simulatorUDIDString = nil;
-    NSError *error = nil;
+    NSMutableOrderedSet<NSString *> *hostBundles = [[NSMutableOrderedSet alloc] init];
     if (self.config.appBundlePath) {
         // This is for integration testing for bluepill and bluepill-cli when we assign self.config.appBundlePath
-        simulatorUDIDString = [self installApplicationWithHost:self.config.appBundlePath withError:&error];
-        if (!simulatorUDIDString || error) {
-            [BPUtils printInfo:ERROR withString:@"Create simualtor and install application failed with error: %@", error];
-            return FALSE;
-        }
-        testHostSimTemplates[self.config.appBundlePath] = simulatorUDIDString;
-        [BPUtils printInfo:INFO withString:@"Created sim template: %@ for app host: %@", simulatorUDIDString, self.config.appBundlePath];
+        [hostBundles addObject:self.config.appBundlePath];
     } else {
         // This is for testing in command line when we pass the xctestrun file
-        NSMutableSet *hostBundles = [[NSMutableSet alloc] init];
         for (BPXCTestFile* bundle in testBundles) {
             [hostBundles addObject:bundle.testHostPath];
         }
         if ([testBundles count] == 0) {
             [BPUtils printInfo:ERROR withString:@"No host bundle founnd!"];
         }
-        for (NSString *appPath in hostBundles) {
+    }
+
+    // Templates are independent of each other, so provision a few of them at once.
+    NSUInteger concurrency = MAX(1, MIN(kMaxConcurrentTemplates, [self.config.numSims unsignedIntegerValue]));
+    [BPUtils printInfo:INFO withString:@"Creating %lu sim templates, up to %lu at a time.",
+     (unsigned long)hostBundles.count, (unsigned long)concurrency];
+    NSMutableDictionary* testHostSimTemplates = [[NSMutableDictionary alloc] init];
+    dispatch_semaphore_t slots = dispatch_semaphore_create(concurrency);
+    dispatch_group_t group = dispatch_group_create();
+    __block BOOL failed = NO;
+    for (NSString *appPath in hostBundles) {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        BOOL giveUp;
+        @synchronized (testHostSimTemplates) {
+            giveUp = failed;
+        }
+        if (giveUp) {
+            dispatch_semaphore_signal(slots);
+            break;
+        }
+        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
             NSError *error = nil;
-            simulatorUDIDString = [self installApplicationWithHost:appPath withError:&error];
-            if (!simulatorUDIDString || error) {
-                [BPUtils printInfo:ERROR withString:@"Created simulator template and install applicationn failed with error: %@", error];
-                return FALSE;
+            NSString *simulatorUDIDString = [self installApplicationWithHost:appPath withError:&error];
+            @synchronized (testHostSimTemplates) {
+                if (!simulatorUDIDString || error) {
+                    [BPUtils printInfo:ERROR withString:@"Created simulator template and install applicationn failed with error: %@", error];
+                    failed = YES;
+                } else {
+                    [BPUtils printInfo:INFO withString:@"Created sim template: %@ for app host: %@", simulatorUDIDString, appPath];
+                    testHostSimTemplates[appPath] = simulatorUDIDString;
+                }
             }
-            [BPUtils printInfo:INFO withString:@"Created sim template: %@ for app host: %@", simulatorUDIDString, appPath];
-            testHostSimTemplates[appPath] = simulatorUDIDString;
-        }
+            dispatch_semaphore_signal(slots);
+        });
     }
-    return testHostSimTemplates;
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    return failed ? nil : testHostSimTemplates;
 }
 
 - (NSString *)getErrorDescription:(NSError *__autoreleasing *)errPtr {
@@ -79,6 +103,13 @@
 }
 
 - (NSString *)installApplicationWithHost:(NSString *)testHost withError:(NSError *__autoreleasing *)errPtr {
+    [self.stats startTimer:PROVISION_TEMPLATE(testHost)];
+    NSString *simulatorUDIDString = [self provisionTemplateWithHost:testHost withError:errPtr];
+    [self.stats endTimer:PROVISION_TEMPLATE(testHost) withResult:simulatorUDIDString ? @"INFO" : @"ERROR"];
+    return simulatorUDIDString;
+}
+
+- (NSString *)provisionTemplateWithHost:(NSString *)testHost withError:(NSError *__autoreleasing *)errPtr {
     SimServiceContext *sc = [SimServiceContext sharedServiceContextForDeveloperDir:self.config.xcodePath error:errPtr];
     if (!sc && *errPtr) {
         [BPUtils printInfo:ERROR withString:@"SimServiceContext failed: %@", [*errPtr localizedDescription]];
@@ -89,23 +120,29 @@
         [BPUtils printInfo:ERROR withString:@"SimDeviceSet failed: %@", [*errPtr localizedDescription]];
         return nil;
     }
+    [self.stats startTimer:BOOT_TEMPLATE(testHost)];
     SimDevice *simDevice = [deviceSet createDeviceWithType:self.config.simDeviceType
                                                    runtime:self.config.simRuntime
                                                       name:[NSString stringWithFormat:@"BP-Template-%u", getpid()]
                                                      error:errPtr];
-    if (!self.simDeviceTemplates) {
-        self.simDeviceTemplates = [[NSMutableArray alloc] init];
-    }
-    [self.simDeviceTemplates addObject:simDevice];
-    if (!simDevice && *errPtr) {
-        [BPUtils printInfo:ERROR withString:@"Create simulator failed with error: %@", [*errPtr localizedDescription]];
+    if (!simDevice) {
+        [self.stats endTimer:BOOT_TEMPLATE(testHost) withResult:@"ERROR"];
+        [BPUtils printInfo:ERROR withString:@"Create simulator failed with error: %@", [self getErrorDescription:errPtr]];
         return nil;
     }
+    @synchronized (self) {
+        if (!self.simDeviceTemplates) {
+            self.simDeviceTemplates = [[NSMutableArray alloc] init];
+        }
+        [self.simDeviceTemplates addObject:simDevice];
+    }
     [simDevice bootWithOptions:nil error:errPtr];
     if (*errPtr) {
+        [self.stats endTimer:BOOT_TEMPLATE(testHost) withResult:@"ERROR"];
         [BPUtils printInfo:ERROR withString:@"Boot simulator failed with error: %@", [*errPtr localizedDescription]];
         return nil;
     }
+    [self.stats endTimer:BOOT_TEMPLATE(testHost) withResult:@"INFO"];
     // Add photos and videos to the simulator.
     [self addPhotosToSimulator];
     [self addVideosToSimulator];
@@ -115,11 +152,13 @@
         return nil;
     }
     // Install the host application
+    [self.stats startTimer:INSTALL_TEMPLATE(testHost)];
     NSError *installError = nil;
     bool installed = [simDevice installApplication:[NSURL fileURLWithPath:testHost]
                                        withOptions:@{kCFBundleIdentifier: hostBundleId}
                                              error:&installError];
     if (!installed) {
+        [self.stats endTimer:INSTALL_TEMPLATE(testHost) withResult:@"ERROR"];
         [BPUtils printInfo:ERROR withString:@"Install application failed with error: %@", [installError localizedDescription]];
         [deviceSet deleteDeviceAsync:simDevice completionHandler:^(NSError *error) {
             if (error) {
@@ -128,8 +167,13 @@
         }];
         return nil;
     } else {
-        // wait for few seconds to make sure the app is being installed correctly
-        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 15, NO);
+        // make sure the app is installed correctly before the template is shut down
+        BOOL ready = [self waitForApplication:hostBundleId onTemplate:simDevice];
+        [self.stats endTimer:INSTALL_TEMPLATE(testHost) withResult:ready ? @"INFO" : @"WARNING"];
+        if (!ready) {
+            [BPUtils printInfo:WARNING withString:@"%@ was not ready on template %@ after %.0f seconds, shutting it down anyway.",
+             hostBundleId, simDevice.UDID.UUIDString, kTemplateInstallTimeout];
+        }
         [self shutdownSimulator:simDevice withError:errPtr];
         if(*errPtr) {
             [BPUtils printInfo:ERROR withString:@"Shutdown simulator failed with error: %@", [*errPtr localizedDescription]];
@@ -144,6 +188,26 @@
     return simDevice.UDID.UUIDString;
 }
 
+// The template is ready once it has finished booting and reports the app as installed, with its bundle in place.
+- (BOOL)waitForApplication:(NSString *)bundleID onTemplate:(SimDevice *)simDevice {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:kTemplateInstallTimeout];
+    while (YES) {
+        SimDeviceBootInfo *bootStatus = simDevice.bootStatus;
+        if (!bootStatus || bootStatus.status == SimDeviceBootInfoStatusFinished) {
+            NSError *error;
+            NSDictionary *appInfo = [simDevice propertiesOfApplication:bundleID error:&error];
+            NSString *path = [appInfo[@"Path"] isKindOfClass:[NSString class]] ? appInfo[@"Path"] : nil;
+            if (path && [[NSFileManager defaultManager] fileExistsAtPath:path]) {
+                return YES;
+            }
+        }
+        if ([deadline timeIntervalSinceNow] <= 0) {
+            return NO;
+        }
+        [NSThread sleepForTimeInterval:kTemplatePollInterval];
+    }
+}
+
 - (void)deleteTemplateSimulator {
     NSError *error;
     SimServiceContext *sc = [SimServiceContext sharedServiceContextForDeveloperDir:self.config.xcodePath error:&error];
@@ -459,6 +523,12 @@
                                        error:errPtr];
 }
 
+- (BOOL)isApplicationInstalled {
+    NSString *hostBundleId = [SimulatorHelper bundleIdForPath:self.config.appBundlePath];
+
+    return [self.device applicationIsInstalled:hostBundleId type:nil error:nil];
+}
+
 - (void)launchApplicationAndExecuteTestsWithParser:(BPTreeParser *)parser andCompletion:(void (^)(NSError *, pid_t))completion {
     NSString *hostBundleId = [SimulatorHelper bundleIdForPath:self.config.appBundlePath];
     NSString *hostAppExecPath = [SimulatorHelper executablePathforPath:self.config.appBundlePath];
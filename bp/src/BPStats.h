@@ -18,6 +18,10 @@
 #define LAUNCH_APPLICATION(x)    [NSString stringWithFormat:@"[Attempt %lu] Launch Application", (x)]
 #define DELETE_SIMULATOR(x)      [NSString stringWithFormat:@"[Attempt %lu] Delete Simulator", (x)]
 #define DELETE_SIMULATOR_CB(x)   [NSString stringWithFormat:@"[Attempt %lu] Delete Simulator due to BAD STATE", (x)]
+#define LOAD_TEST_BUNDLE(x)      [NSString stringWithFormat:@"Loading App: %@", (x)]
+#define PROVISION_TEMPLATE(x)    [NSString stringWithFormat:@"Template %@", (x)]
+#define BOOT_TEMPLATE(x)         [NSString stringWithFormat:@"Template %@: Create and Boot", (x)]
+#define INSTALL_TEMPLATE(x)      [NSString stringWithFormat:@"Template %@: Install Application", (x)]
 
 #define ALL_TESTS              @"All Tests"
 #define TEST_CASE_FORMAT       @"[Attempt %lu] %@/%@"
@@ -29,6 +33,8 @@
 
 @property (nonatomic, assign) NSInteger attemptNumber;
 @property (nonatomic, assign) BOOL cleanRun;
+// Written out as the process_labels of the trace, e.g. the test host a bp process ran.
+@property (nonatomic, strong) NSString *processLabel;
 
 + (instancetype)sharedStats;
 
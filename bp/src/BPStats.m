@@ -73,24 +73,30 @@
 }
 
 -(void)startTimer:(NSString *)name atTime:(NSDate *)date {
-    BPStat *stat = [self statForName:name createIfNotExist:YES];
-    stat.name = name;
-    if (stat.startTime == nil) {
-        stat.startTime = date;
+    @synchronized (self) {
+        BPStat *stat = [self statForName:name createIfNotExist:YES];
+        stat.name = name;
+        if (stat.startTime == nil) {
+            stat.startTime = date;
+        }
     }
 }
 
 - (void)endTimer:(NSString *)name withResult:(NSString *) result {
-    BPStat *stat = [self statForName:name createIfNotExist:NO];
-    if (!stat) {
-        [BPUtils printInfo:ERROR withString:@"EndTimerFailure: EndTimer called without starting a timer for '%@'", name];
+    NSDate *endTime = [NSDate date];
+    @synchronized (self) {
+        BPStat *stat = [self statForName:name createIfNotExist:NO];
+        if (stat) {
+            stat.endTime = endTime;
+            stat.result = result;
+            return;
+        }
+    }
+    [BPUtils printInfo:ERROR withString:@"EndTimerFailure: EndTimer called without starting a timer for '%@'", name];
 #ifdef DEBUG
-        [NSException raise:@"EndTimerFailure" format:@"EndTimer called without starting a timer for '%@'", name];
+    [NSException raise:@"EndTimerFailure" format:@"EndTimer called without starting a timer for '%@'", name];
 #endif
-        return; // We'll just ignore it
-    }
-    stat.endTime = [NSDate date];
-    stat.result = result;
+    // We'll just ignore it
 }
 
 - (void)addCounter:(NSString *)name withValues:(NSDictionary <NSString *, NSNumber *>*)counters {
@@ -98,7 +104,9 @@
     event.name = name;
     event.timeStamp = [NSDate date];
     event.counters = counters;
-    [self.counters addObject:event];
+    @synchronized (self) {
+        [self.counters addObject:event];
+    }
 }
 
 - (NSString *)getJsonStat:(NSString *)name {
@@ -132,6 +140,7 @@
 - (void)exitWithWriter:(BPWriter *)writer exitCode:(int)exitCode {
     self.applicationTime.endTime = [NSDate date];
     [self generateFullReportWithWriter:writer exitCode:exitCode];
+    [writer close];
 }
 
 - (void)addTest {
@@ -200,6 +209,14 @@
                        bundleID
                        ]];
 
+    if (self.processLabel) {
+        // The label is a bundle name, which may hold anything JSON needs escaped
+        NSDictionary *labels = @{@"name": @"process_labels", @"ph": @"M", @"pid": @1, @"tid": @(bundleID),
+                                 @"args": @{@"labels": self.processLabel}};
+        NSData *json = [NSJSONSerialization dataWithJSONObject:labels options:0 error:nil];
+        [writer writeLine:@"%@,", [[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding]];
+    }
+
     NSString *bundleName = @"Bluepill";
     if (bpNum > 0) {
         bundleName = [NSString stringWithFormat:@"BP-%lu", bpNum];
@@ -217,12 +234,16 @@
 
     NSMutableArray<NSString *> *allStatStrings = [[NSMutableArray alloc] init];
 
-    // now output all the stats...
-    for (NSString *name in self.stats) {
-        [allStatStrings addObject:[self getJsonStat:name]];
+    NSArray<BPCounter *> *counters;
+    @synchronized (self) {
+        // now output all the stats...
+        for (NSString *name in self.stats) {
+            [allStatStrings addObject:[self getJsonStat:name]];
+        }
+        counters = [self.counters copy];
     }
     // finally, print counters
-    for (BPCounter *counter in self.counters) {
+    for (BPCounter *counter in counters) {
         NSMutableArray *args = [[NSMutableArray alloc] init];
         for (NSString *key in counter.counters) {
             [args addObject:[NSString stringWithFormat:@"\"%@\": %@", key, counter.counters[key]]];
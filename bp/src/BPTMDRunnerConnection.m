@@ -12,6 +12,7 @@
 #import "BPUtils.h"
 #import "SimulatorHelper.h"
 #import "BPConfiguration.h"
+#import "BPTreeParser.h"
 
 // XCTAutomationSupport framework
 #import "PrivateHeaders/XCTAutomationSupport/XCElementSnapshot.h"
@@ -22,6 +23,9 @@
 #import "PrivateHeaders/XCTest/XCTMessagingChannel_DaemonToIDE-Protocol.h"
 #import "PrivateHeaders/XCTest/XCTMessagingChannel_IDEToDaemon-Protocol.h"
 #import "PrivateHeaders/XCTest/XCTTestIdentifier.h"
+#import "PrivateHeaders/XCTest/XCTIssue.h"
+#import "PrivateHeaders/XCTest/XCTSourceCodeContext.h"
+#import "PrivateHeaders/XCTest/XCTSourceCodeLocation.h"
 
 
 // DTX framework
@@ -151,6 +155,8 @@
 
 - (void)startTestPlan {
     [BPUtils printInfo:INFO withString:@"Test plan started!"];
+    // From here on the results come from the callbacks below rather than from parsing the output
+    self.context.parser.structuredResults = (self.testRunnerProxy != nil);
     [self.testRunnerProxy _IDE_startExecutingTestPlanWithProtocolVersion:@(BP_TM_PROTOCOL_VERSION)];
 }
 
@@ -235,7 +241,15 @@ static inline NSString* getVideoPath(NSString *directory, NSString *testClass, N
 
 
 - (id)_XCT_testCaseWithIdentifier:(XCTTestIdentifier *)arg1 didRecordIssue:(XCTIssue *)arg2 {
-    return nil;
+    if (arg2.isExpectedFailure) {
+        return nil;
+    }
+    XCTSourceCodeLocation *location = arg2.sourceCodeContext.location;
+    return [self _XCT_testCaseDidFailForTestClass:arg1.firstComponent
+                                           method:arg1.lastComponent
+                                      withMessage:arg2.compactDescription
+                                             file:location.fileURL.path
+                                             line:@(location.lineNumber)];
 }
 
 
@@ -245,20 +259,25 @@ static inline NSString* getVideoPath(NSString *directory, NSString *testClass, N
 
 
 - (id)_XCT_testCaseWithIdentifier:(XCTTestIdentifier *)arg1 wasSkippedWithMessage:(NSString *)arg2 sourceCodeContext:(XCTSourceCodeContext *)arg3 {
-    return nil;
+    XCTSourceCodeLocation *location = arg3.location;
+    return [self _XCT_testCaseWasSkippedForTestClass:arg1.firstComponent
+                                              method:arg1.lastComponent
+                                         withMessage:arg2
+                                                file:location.fileURL.path
+                                                line:@(location.lineNumber)];
 }
 
 - (id)_XCT_testCaseDidStartWithIdentifier:(XCTTestIdentifier *)arg1 {
-    return nil;
+    return [self _XCT_testCaseDidStartForTestClass:arg1.firstComponent method:arg1.lastComponent];
 }
 
 
 - (id)_XCT_testCaseDidStartWithIdentifier:(XCTTestIdentifier *)arg1 iteration:(NSNumber *)arg2 {
-    return nil;
+    return [self _XCT_testCaseDidStartForTestClass:arg1.firstComponent method:arg1.lastComponent];
 }
 
 - (id)_XCT_testSuiteWithIdentifier:(XCTTestIdentifier *)arg1 didFinishAt:(NSString *)arg2 runCount:(NSNumber *)arg3 skipCount:(NSNumber *)arg4 failureCount:(NSNumber *)arg5 expectedFailureCount:(NSNumber *)arg6 uncaughtExceptionCount:(NSNumber *)arg7 testDuration:(NSNumber *)arg8 totalDuration:(NSNumber *)arg9 {
-    return nil;
+    return [self _XCT_testSuite:[arg1 _identifierString] didFinishAt:arg2 runCount:arg3 skipCount:arg4 failureCount:arg5 expectedFailureCount:arg6 uncaughtExceptionCount:arg7 testDuration:arg8 totalDuration:arg9];
 }
 
 
@@ -314,6 +333,11 @@ static inline NSString* getVideoPath(NSString *directory, NSString *testClass, N
 
 - (id)_XCT_testCaseDidFinishForTestClass:(NSString *)testClass method:(NSString *)method withStatus:(NSString *)statusString duration:(NSNumber *)duration {
     [BPUtils printInfo:DEBUGINFO withString: @"BPTestBundleConnection_XCT_testCaseDidFinishForTestClass: %@, method: %@, withStatus: %@, duration: %@", testClass, method, statusString, duration];
+    [self.context.parser onStructuredTestCaseFinishedWithName:method
+                                                      inClass:testClass
+                                                       passed:([statusString isEqualToString:@"passed"] ||
+                                                               [statusString isEqualToString:@"skipped"])
+                                                     duration:[duration doubleValue]];
     if ([self shouldRecordVideo]) {
         [self stopVideoRecording:NO];
         if ([statusString isEqual: @"passed"] && ![self.context.config keepPassingVideos]) {
@@ -329,15 +353,23 @@ static inline NSString* getVideoPath(NSString *directory, NSString *testClass, N
 
 - (id)_XCT_testCaseDidFailForTestClass:(NSString *)testClass method:(NSString *)method withMessage:(NSString *)message file:(NSString *)file line:(NSNumber *)line {
     [BPUtils printInfo:DEBUGINFO withString:@"BPTestBundleConnection_XCT_testCaseDidFailForTestClass: %@, method: %@, withMessage: %@, file: %@, line: %@", testClass, method, message, file, line];
+    [self.context.parser onStructuredTestCaseFailedWithName:method
+                                                    inClass:testClass
+                                                     inFile:file
+                                               onLineNumber:[line unsignedIntegerValue]
+                                                withMessage:message];
     return nil;
 }
 
-- (id)_XCT_testCaseWasSkippedForTestClass:(NSString *)arg1 method:(NSString *)arg2 withMessage:(NSString *)arg3 file:(NSString *)arg4 line:(NSNumber *)arg5 {
+- (id)_XCT_testCaseWasSkippedForTestClass:(NSString *)testClass method:(NSString *)method withMessage:(NSString *)message file:(NSString *)file line:(NSNumber *)line {
+    [BPUtils printInfo:DEBUGINFO withString:@"BPTestBundleConnection_XCT_testCaseWasSkippedForTestClass: %@, method: %@, withMessage: %@, file: %@, line: %@", testClass, method, message, file, line];
+    [self.context.parser onStructuredTestCaseSkippedWithName:method inClass:testClass withMessage:message];
     return nil;
 }
 
 - (id)_XCT_testCaseDidStartForTestClass:(NSString *)testClass method:(NSString *)method {
     [BPUtils printInfo:DEBUGINFO withString:@"BPTestBundleConnection_XCT_testCaseDidStartForTestClass: %@ and method: %@", testClass, method];
+    [self.context.parser onStructuredTestCaseStartedWithName:method inClass:testClass];
     if ([self shouldRecordVideo]) {
         [self startVideoRecordingForTestClass:testClass method:method];
     }
@@ -346,25 +378,34 @@ static inline NSString* getVideoPath(NSString *directory, NSString *testClass, N
 
 - (id)_XCT_testSuite:(NSString *)tests didStartAt:(NSString *)time {
     [BPUtils printInfo:DEBUGINFO withString:@"BPTestBundleConnection_XCT_testSuite: %@, start %@", tests, time];
+    [self.context.parser onStructuredTestSuiteStarted:tests atTime:time];
     return nil;
 }
 
 - (id)_XCT_testSuite:(NSString *)arg1 didFinishAt:(NSString *)time runCount:(NSNumber *)count withFailures:(NSNumber *)failureCount unexpected:(NSNumber *)unexpectedCount testDuration:(NSNumber *)testDuration totalDuration:(NSNumber *)totalTime {
     [BPUtils printInfo:DEBUGINFO withString: @"BPTestBundleConnection_XCT_testSuite: %@, didFinishAt: %@, runCount: %@, withFailures: %@, unexpectedCount: %@, testDuration: %@, totalDuration: %@", arg1, time, count, failureCount, unexpectedCount, testDuration, totalTime];
-    
+    [self.context.parser onStructuredTestSuiteFinished:arg1
+                                                atTime:time
+                                              runCount:[count unsignedIntegerValue]
+                                              failures:[failureCount unsignedIntegerValue]
+                                            unexpected:[unexpectedCount unsignedIntegerValue]
+                                         totalDuration:[totalTime doubleValue]];
+
     if ([self shouldRecordVideo]) {
         [self stopVideoRecording:YES];
     }
     return nil;
 }
 
+// Uncaught exceptions are the unexpected failures, like in "Executed 9 tests, with 2 failures (1 unexpected)"
 - (id)_XCT_testSuite:(NSString *)arg1 didFinishAt:(NSString *)arg2 runCount:(NSNumber *)arg3 skipCount:(NSNumber *)arg4 failureCount:(NSNumber *)arg5 expectedFailureCount:(NSNumber *)arg6 uncaughtExceptionCount:(NSNumber *)arg7 testDuration:(NSNumber *)arg8 totalDuration:(NSNumber *)arg9 {
-    return nil;
+    NSNumber *failures = @([arg5 unsignedIntegerValue] + [arg7 unsignedIntegerValue]);
+    return [self _XCT_testSuite:arg1 didFinishAt:arg2 runCount:arg3 withFailures:failures unexpected:arg7 testDuration:arg8 totalDuration:arg9];
 }
 
 
 - (id)_XCT_testSuite:(NSString *)arg1 didFinishAt:(NSString *)arg2 runCount:(NSNumber *)arg3 skipCount:(NSNumber *)arg4 failureCount:(NSNumber *)arg5 unexpectedFailureCount:(NSNumber *)arg6 testDuration:(NSNumber *)arg7 totalDuration:(NSNumber *)arg8 {
-    return nil;
+    return [self _XCT_testSuite:arg1 didFinishAt:arg2 runCount:arg3 withFailures:arg5 unexpected:arg6 testDuration:arg7 totalDuration:arg8];
 }
 
 #pragma mark XCTMessagingRole_SelfDiagnosisIssueReporting
@@ -0,0 +1,50 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class BPTestClass;
+
+/*!
+ On-disk cache of the test classes/cases discovered in a test binary.
+
+ Entries are keyed by the Mach-O UUID of the binary (or a SHA-256 of its contents when
+ it was linked without one), so an unchanged bundle is never scanned twice. Each entry is
+ a small JSON file written atomically (temp file + rename), which makes it safe for several
+ bluepill/bp processes to share the same directory: readers either see a complete entry or
+ none at all, and anything unreadable is treated as a miss.
+ */
+@interface BPTestInventoryCache : NSObject
+
+// Directory holding the cache entries. Caching is disabled while this is nil.
+@property (atomic, strong) NSString *directory;
+@property (atomic, assign, readonly) NSUInteger hits;
+@property (atomic, assign, readonly) NSUInteger misses;
+
++ (instancetype)sharedCache;
+
+/*!
+ @discussion The cache key of a test binary.
+ @param path The path to the binary inside the .xctest bundle.
+ @return The key, or nil if caching is disabled or the binary can't be read.
+ */
+- (NSString *)keyForBinary:(NSString *)path;
+
+/*!
+ @discussion Look up a cache entry, counting a hit or a miss.
+ @return The cached test classes, or nil on a miss.
+ */
+- (NSArray<BPTestClass *> *)testClassesForKey:(NSString *)key;
+
+/*!
+ @discussion Store the test classes of a binary. Failures are logged and otherwise ignored.
+ */
+- (void)storeTestClasses:(NSArray<BPTestClass *> *)testClasses forKey:(NSString *)key;
+
+@end
@@ -0,0 +1,126 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import "BPTestInventoryCache.h"
+#import "BPMachOSymbols.h"
+#import "BPTestCase.h"
+#import "BPTestClass.h"
+#import "BPUtils.h"
+#import <CommonCrypto/CommonDigest.h>
+
+// Bump this whenever the way tests are discovered changes, so stale entries are ignored.
+static const NSInteger BPTestInventoryCacheVersion = 1;
+
+@interface BPTestInventoryCache ()
+@property (atomic, assign, readwrite) NSUInteger hits;
+@property (atomic, assign, readwrite) NSUInteger misses;
+@end
+
+@implementation BPTestInventoryCache
+
++ (instancetype)sharedCache {
+    static BPTestInventoryCache *instance;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instance = [[self alloc] init];
+    });
+    return instance;
+}
+
+- (NSString *)keyForBinary:(NSString *)path {
+    if (!self.directory) {
+        return nil;
+    }
+    NSString *uuid = [BPMachOSymbols UUIDOfBinary:path];
+    if (uuid) {
+        return [NSString stringWithFormat:@"v%ld-%@", (long)BPTestInventoryCacheVersion, uuid];
+    }
+    // No LC_UUID (linked with -no_uuid): fall back to hashing the contents.
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        return nil;
+    }
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *key = [NSMutableString stringWithFormat:@"v%ld-%lu-", (long)BPTestInventoryCacheVersion, (unsigned long)data.length];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [key appendFormat:@"%02x", digest[i]];
+    }
+    return key;
+}
+
+- (NSString *)pathForKey:(NSString *)key {
+    return [self.directory stringByAppendingPathComponent:[key stringByAppendingPathExtension:@"json"]];
+}
+
+- (NSArray<BPTestClass *> *)testClassesForKey:(NSString *)key {
+    NSArray<BPTestClass *> *testClasses = [self readEntryAtPath:[self pathForKey:key]];
+    @synchronized (self) {
+        if (testClasses) {
+            self.hits++;
+        } else {
+            self.misses++;
+        }
+    }
+    return testClasses;
+}
+
+- (NSArray<BPTestClass *> *)readEntryAtPath:(NSString *)path {
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    if (!data) {
+        return nil;
+    }
+    NSDictionary *entry = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    if (![entry isKindOfClass:[NSDictionary class]] ||
+        ![entry[@"version"] isEqual:@(BPTestInventoryCacheVersion)] ||
+        ![entry[@"testClasses"] isKindOfClass:[NSArray class]]) {
+        [BPUtils printInfo:WARNING withString:@"Ignoring invalid test inventory cache entry %@", path];
+        return nil;
+    }
+    NSMutableArray<BPTestClass *> *testClasses = [[NSMutableArray alloc] init];
+    for (NSDictionary *classEntry in entry[@"testClasses"]) {
+        if (![classEntry isKindOfClass:[NSDictionary class]] ||
+            ![classEntry[@"name"] isKindOfClass:[NSString class]] ||
+            ![classEntry[@"testCases"] isKindOfClass:[NSArray class]]) {
+            return nil;
+        }
+        BPTestClass *testClass = [[BPTestClass alloc] initWithName:classEntry[@"name"]];
+        for (NSString *testName in classEntry[@"testCases"]) {
+            if (![testName isKindOfClass:[NSString class]]) {
+                return nil;
+            }
+            [testClass addTestCase:[[BPTestCase alloc] initWithName:testName]];
+        }
+        [testClasses addObject:testClass];
+    }
+    return testClasses;
+}
+
+- (void)storeTestClasses:(NSArray<BPTestClass *> *)testClasses forKey:(NSString *)key {
+    NSMutableArray *classEntries = [[NSMutableArray alloc] initWithCapacity:testClasses.count];
+    for (BPTestClass *testClass in testClasses) {
+        NSMutableArray *testNames = [[NSMutableArray alloc] initWithCapacity:testClass.testCases.count];
+        for (BPTestCase *testCase in testClass.testCases) {
+            [testNames addObject:testCase.name];
+        }
+        [classEntries addObject:@{@"name": testClass.name, @"testCases": testNames}];
+    }
+    NSDictionary *entry = @{@"version": @(BPTestInventoryCacheVersion), @"testClasses": classEntries};
+    NSError *error;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:entry options:0 error:&error];
+    // Writing atomically goes through a temporary file and a rename, so a process reading
+    // the same entry concurrently never sees it half written.
+    if (!data ||
+        ![[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:&error] ||
+        ![data writeToFile:[self pathForKey:key] options:NSDataWritingAtomic error:&error]) {
+        [BPUtils printInfo:WARNING withString:@"Could not write test inventory cache entry %@: %@", key, [error localizedDescription]];
+    }
+}
+
+@end
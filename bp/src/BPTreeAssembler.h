@@ -11,14 +11,21 @@
 
 @class BPTestSuiteLogEntry;
 @class BPTestCaseLogEntry;
+@class BPJUnitJournal;
+@class BPStats;
 
+// The result tree of one execution context. It lives across the attempts of the context until reset.
 @interface BPTreeAssembler : NSObject
 
 @property (nonatomic, strong) BPTestSuiteLogEntry *root;
 @property (nonatomic, assign) BPTestSuiteLogEntry *current;
 @property (nonatomic, assign) BPTestCaseLogEntry *currentTest;
+// Where the results are journaled as they come in, until a report is written from the tree
+@property (nonatomic, strong) BPJUnitJournal *journal;
+// The stats of the context, which start a clean run when the tree is reset
+@property (nonatomic, strong, readonly) BPStats *stats;
 
-+ (instancetype)sharedInstance;
+- (instancetype)initWithStats:(BPStats *)stats;
 
 - (void)testAborted:(NSString *)testName inClass:(NSString *)testClass;
 - (void)reset;
@@ -8,17 +8,17 @@
 //  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
 
 #import "BPTreeAssembler.h"
+#import "BPJUnitJournal.h"
 #import "BPStats.h"
 
 @implementation BPTreeAssembler
 
-+ (instancetype)sharedInstance {
-    static id instance;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        instance = [[self alloc] init];
-    });
-    return instance;
+- (instancetype)initWithStats:(BPStats *)stats {
+    self = [super init];
+    if (self) {
+        _stats = stats;
+    }
+    return self;
 }
 
 - (void)testAborted:(NSString *)testName inClass:(NSString *)testClass {
@@ -29,6 +29,8 @@
     self.root = nil;
     self.current = nil;
     self.currentTest = nil;
-    [BPStats sharedStats].cleanRun = YES;
+    [self.journal discard];
+    self.journal = nil;
+    self.stats.cleanRun = YES;
 }
 @end
@@ -13,6 +13,7 @@
 
 @property (nonatomic, assign) NSTimeInterval totalTime;
 @property (nonatomic, strong, nullable) NSString *line;
+// The log is accumulated in an append-only UTF-8 buffer and only turned into a string when read
 @property (nonatomic, strong, nullable) NSString *log;
 @property (nonatomic, assign) BOOL ended;
 @property (nonatomic, assign) BOOL passed;
@@ -20,6 +21,14 @@
 @property (nonatomic, strong, nullable) NSDate *startTime;
 @property (nonatomic, strong, nullable) NSDate *endTime;
 
+// Bytes of log kept in memory at both its start and its end, 0 for no limit. The lines in between
+// are appended to a file in logSpillDirectory, or dropped without one, and log says where they went.
+@property (nonatomic, assign) NSUInteger maxLogSize;
+@property (nonatomic, strong, nullable) NSString *logSpillDirectory;
+@property (nonatomic, strong, readonly, nullable) NSString *logSpillPath;
+
+- (void)appendLogLine:(nonnull NSString *)line;
+
 @end
 
 @interface BPTestCaseLogEntry : BPLogEntry
@@ -54,6 +63,8 @@
 @property (nonatomic, assign) NSUInteger reportedNumberOfFailures;
 @property (nonatomic, assign) NSUInteger reportedNumberOfErrors;
 
+// Test case children must have their class and name set before they are added,
+// they are indexed by those for testCaseWithClass:andName:
 - (void)addChild:(nonnull BPLogEntry *)logEntry;
 - (nullable BPTestCaseLogEntry *)testCaseWithClass:(nonnull NSString *)testCaseClass andName:(nonnull NSString *)testCaseName;
 @end
@@ -8,9 +8,140 @@
 //  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
 
 #import "BPTreeObjects.h"
+#import "BPUtils.h"
+
+@interface BPLogEntry ()
+
+// The whole log while it's under maxLogSize, then only its start
+@property (nonatomic, strong, nullable) NSMutableData *logBuffer;
+// The end of the log once it's over maxLogSize, between maxLogSize and twice that
+@property (nonatomic, strong, nullable) NSMutableData *tailBuffer;
+@property (nonatomic, assign) unsigned long long omittedLength;
+@property (nonatomic, strong, readwrite, nullable) NSString *logSpillPath;
+// Open from the first spill until the entry ends
+@property (nonatomic, assign, nullable) FILE *logSpillFile;
+@property (nonatomic, strong, nullable) NSString *materializedLog;
+
+@end
 
 @implementation BPLogEntry
 
+- (void)dealloc {
+    [self closeSpillFile];
+}
+
+- (void)setEnded:(BOOL)ended {
+    _ended = ended;
+    if (ended) {
+        [self closeSpillFile];
+    }
+}
+
+- (NSString *)log {
+    if (!self.logBuffer) {
+        return nil;
+    }
+    if (!self.materializedLog) {
+        NSData *data = self.logBuffer;
+        if (self.tailBuffer) {
+            NSMutableData *truncated = [self.logBuffer mutableCopy];
+            if (self.omittedLength) {
+                NSString *marker = self.logSpillPath
+                    ? [NSString stringWithFormat:@"[... %llu bytes of output omitted, see %@ ...]\n", self.omittedLength, self.logSpillPath]
+                    : [NSString stringWithFormat:@"[... %llu bytes of output omitted ...]\n", self.omittedLength];
+                [truncated appendData:[marker dataUsingEncoding:NSUTF8StringEncoding]];
+            }
+            [truncated appendData:self.tailBuffer];
+            data = truncated;
+        }
+        self.materializedLog = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] ?: @"";
+    }
+    return self.materializedLog;
+}
+
+- (void)setLog:(NSString *)log {
+    self.logBuffer = log ? [[log dataUsingEncoding:NSUTF8StringEncoding] mutableCopy] : nil;
+    self.tailBuffer = nil;
+    self.omittedLength = 0;
+    [self closeSpillFile];
+    self.logSpillPath = nil;
+    self.materializedLog = nil;
+}
+
+- (void)appendLogLine:(NSString *)line {
+    if (!self.logBuffer) {
+        self.logBuffer = [[NSMutableData alloc] init];
+    }
+    self.materializedLog = nil;
+    const char *bytes = [line UTF8String];
+    size_t length = bytes ? strlen(bytes) : 0;
+    NSMutableData *buffer = self.logBuffer;
+    if (self.maxLogSize && (self.tailBuffer || [self.logBuffer length] + length + 1 > self.maxLogSize)) {
+        if (!self.tailBuffer) {
+            self.tailBuffer = [[NSMutableData alloc] init];
+        }
+        buffer = self.tailBuffer;
+    }
+    if (bytes) {
+        [buffer appendBytes:bytes length:length];
+    }
+    [buffer appendBytes:"\n" length:1];
+    if (buffer == self.tailBuffer && [self.tailBuffer length] > 2 * self.maxLogSize) {
+        [self spillTail];
+    }
+}
+
+// Move everything but the last maxLogSize bytes of the tail, cut at a line, out of memory.
+- (void)spillTail {
+    const char *bytes = [self.tailBuffer bytes];
+    NSUInteger length = [self.tailBuffer length];
+    NSUInteger keepFrom = length - self.maxLogSize;
+    // The tail always ends with a newline
+    const char *newline = memchr(bytes + keepFrom, '\n', length - keepFrom);
+    NSUInteger cut = newline - bytes + 1;
+    [self writeToSpillFile:bytes length:cut];
+    self.omittedLength += cut;
+    [self.tailBuffer replaceBytesInRange:NSMakeRange(0, cut) withBytes:NULL length:0];
+}
+
+- (void)writeToSpillFile:(const char *)bytes length:(NSUInteger)length {
+    if (!self.logSpillDirectory) {
+        return;
+    }
+    if (!self.logSpillPath) {
+        NSMutableString *name = [[self logName] mutableCopy];
+        [name replaceOccurrencesOfString:@"/" withString:@"_" options:0 range:NSMakeRange(0, [name length])];
+        [name replaceOccurrencesOfString:@" " withString:@"_" options:0 range:NSMakeRange(0, [name length])];
+        NSError *error;
+        NSString *template = [self.logSpillDirectory stringByAppendingPathComponent:[name stringByAppendingString:@"-system-out.log"]];
+        self.logSpillPath = [BPUtils mkstemp:template withError:&error];
+        if (!self.logSpillPath) {
+            [BPUtils printInfo:WARNING withString:@"Could not create a file for the output of %@, dropping it: %@", [self logName], [error localizedDescription]];
+            self.logSpillDirectory = nil;
+            return;
+        }
+    }
+    if (!self.logSpillFile) {
+        self.logSpillFile = fopen([self.logSpillPath UTF8String], "a");
+    }
+    // Flushed every time, so that the file is complete whenever the report that refers to it is written.
+    // Each write is at least maxLogSize bytes.
+    if (!self.logSpillFile || fwrite(bytes, 1, length, self.logSpillFile) != length || fflush(self.logSpillFile) != 0) {
+        [BPUtils printInfo:WARNING withString:@"Failed to write the output of %@ to %@: %s", [self logName], self.logSpillPath, strerror(errno)];
+    }
+}
+
+- (void)closeSpillFile {
+    if (self.logSpillFile) {
+        fclose(self.logSpillFile);
+        self.logSpillFile = NULL;
+    }
+}
+
+- (NSString *)logName {
+    return @"log";
+}
+
 - (NSString *)debugDescription {
     return [self description];
 }
@@ -19,6 +150,10 @@
 
 @implementation BPTestCaseLogEntry
 
+- (NSString *)logName {
+    return [NSString stringWithFormat:@"%@-%@", self.testCaseClass, self.testCaseName];
+}
+
 - (NSString *)description {
     NSString *str = [NSString stringWithFormat:
                      @"%@/%@ Time: %f Ended: %@ Passed: %@ Filename: %@ Line number: %lu Error Message: %@ Log: %@\n",
@@ -29,19 +164,25 @@
 
 @end
 
+@interface BPTestSuiteLogEntry ()
+
+// "class/name" -> the first test case child with that class and name
+@property (nonatomic, strong, nullable) NSMutableDictionary<NSString *, BPTestCaseLogEntry *> *testCaseIndex;
+
+@end
+
 @implementation BPTestSuiteLogEntry
 
++ (NSString *)testCaseKeyWithClass:(NSString *)testCaseClass andName:(NSString *)testCaseName {
+    return [NSString stringWithFormat:@"%@/%@", testCaseClass, testCaseName];
+}
+
+- (NSString *)logName {
+    return self.testSuiteName ?: [super logName];
+}
+
 - (nullable BPTestCaseLogEntry *)testCaseWithClass:(NSString *)testCaseClass andName:(NSString *)testCaseName {
-    for (BPLogEntry* logEntry in self.children) {
-        if ([logEntry isKindOfClass:[BPTestCaseLogEntry class]]) {
-            BPTestCaseLogEntry* testCaseLogEntry = (BPTestCaseLogEntry *)logEntry;
-            if ([testCaseLogEntry.testCaseClass isEqualToString:testCaseClass] &&
-                [testCaseLogEntry.testCaseName isEqualToString:testCaseName]) {
-                return testCaseLogEntry;
-            }
-        }
-    }
-    return nil;
+    return self.testCaseIndex[[BPTestSuiteLogEntry testCaseKeyWithClass:testCaseClass andName:testCaseName]];
 }
 
 - (void)addChild:(BPLogEntry *)logEntry {
@@ -49,6 +190,17 @@
         self.children = [[NSMutableArray alloc] init];
     }
     [self.children addObject:logEntry];
+    if ([logEntry isKindOfClass:[BPTestCaseLogEntry class]]) {
+        BPTestCaseLogEntry *testCaseLogEntry = (BPTestCaseLogEntry *)logEntry;
+        if (!self.testCaseIndex) {
+            self.testCaseIndex = [[NSMutableDictionary alloc] init];
+        }
+        NSString *key = [BPTestSuiteLogEntry testCaseKeyWithClass:testCaseLogEntry.testCaseClass andName:testCaseLogEntry.testCaseName];
+        // Keep the first match, same as the linear search this replaces
+        if (!self.testCaseIndex[key]) {
+            self.testCaseIndex[key] = testCaseLogEntry;
+        }
+    }
 }
 
 - (NSString *)description {
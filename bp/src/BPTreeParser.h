@@ -46,12 +46,27 @@
 @protocol BPExecutionPhaseProtocol;
 
 @class BPWriter;
+@class BPJUnitJournal;
+@class BPTreeAssembler;
 
 @interface BPTreeParser : NSObject
 
 @property (nonatomic, weak, nullable) id<BPExecutionPhaseProtocol> delegate;
-
+// Bytes of output kept in memory at the start and at the end of every test case, 0 for no limit.
+// The output in between is written to a file in logSpillDirectory, which the report refers to.
+@property (nonatomic, assign) NSUInteger maxLogSize;
+// The same for the output of every test suite
+@property (nonatomic, assign) NSUInteger maxSuiteLogSize;
+@property (nonatomic, strong, nullable) NSString *logSpillDirectory;
+// Every suite and finished test case is recorded here as it comes in. Like the tree, the journal
+// carries over to the next parser of the same assembler until cleanup, which discards it.
+@property (nonatomic, strong, nullable) BPJUnitJournal *journal;
+// Holds the result tree, which outlives the parser so that a relaunch after a crash continues it
+@property (nonatomic, strong, readonly, nonnull) BPTreeAssembler *assembler;
+
+// Parse into a tree of its own
 - (nonnull instancetype)initWithWriter:(nonnull BPWriter *)writer;
+- (nonnull instancetype)initWithWriter:(nonnull BPWriter *)writer assembler:(nonnull BPTreeAssembler *)assembler;
 
 - (void)handleChunkData:(nonnull NSData *)chunk;
 - (void)completed;
@@ -59,4 +74,30 @@
 - (nullable NSString *)generateLog:(nonnull id<BPReporter>)reporter;
 - (void)setParserStateCompleted;
 
+// Set once the test results are reported through testmanagerd. The tree is then built from the
+// structured results below, and the output is only kept as system-out and to pick up crashes.
+@property (atomic, assign) BOOL structuredResults;
+
+- (void)onStructuredTestSuiteStarted:(nonnull NSString *)testSuiteName atTime:(nullable NSString *)time;
+- (void)onStructuredTestSuiteFinished:(nonnull NSString *)testSuiteName
+                               atTime:(nullable NSString *)time
+                             runCount:(NSUInteger)runCount
+                             failures:(NSUInteger)failures
+                           unexpected:(NSUInteger)unexpectedFailures
+                        totalDuration:(NSTimeInterval)totalDuration;
+- (void)onStructuredTestCaseStartedWithName:(nonnull NSString *)testName inClass:(nonnull NSString *)testClass;
+- (void)onStructuredTestCaseFailedWithName:(nonnull NSString *)testName
+                                   inClass:(nonnull NSString *)testClass
+                                    inFile:(nullable NSString *)filePath
+                              onLineNumber:(NSUInteger)lineNumber
+                               withMessage:(nullable NSString *)message;
+// A skipped test is not a failure, whatever status it finishes with. The message goes to its system-out.
+- (void)onStructuredTestCaseSkippedWithName:(nonnull NSString *)testName
+                                    inClass:(nonnull NSString *)testClass
+                                withMessage:(nullable NSString *)message;
+- (void)onStructuredTestCaseFinishedWithName:(nonnull NSString *)testName
+                                     inClass:(nonnull NSString *)testClass
+                                      passed:(BOOL)passed
+                                    duration:(NSTimeInterval)duration;
+
 @end
@@ -11,8 +11,10 @@
 #import "BPTreeObjects.h"
 #import "BPReporters.h"
 #import "BPExecutionPhaseProtocol.h"
+#import "BPJUnitJournal.h"
 #import "BPWriter.h"
 #import "BPUtils.h"
+#import "BPStats.h"
 #import "BPTreeAssembler.h"
 #import <time.h>
 #import <xlocale.h>
@@ -26,11 +28,88 @@ static const NSString * const kChildKey = @"child";
 static const NSString * const kStarted = @"started";
 static const NSString * const kPassed = @"passed";
 
+// Every pattern we match on contains at least one of these literal markers, so a line
+// that contains none of them can never match and never needs to touch a regex.
+// The markers are searched anywhere in the line (not just as a prefix) because
+// XCTest output is often prefixed, e.g. "XCTestOutputBarrierTest Case '-[...]' started."
+typedef NS_OPTIONS(NSUInteger, BPLineTraits) {
+    BPLineTraitNone          = 0,
+    BPLineTraitSuiteEnded    = 1 << 0, // TEST_SUITE_ENDED
+    BPLineTraitSuite         = 1 << 1, // TEST_SUITE_START
+    BPLineTraitTestCase      = 1 << 2, // TEST_CASE_STARTED, TEST_CASE_PASSED
+    BPLineTraitError         = 1 << 3, // TEST_CASE_FAILED, TEST_CASE_CRASHED4
+    BPLineTraitFatalError    = 1 << 4, // TEST_CASE_CRASHED
+    BPLineTraitStackTrace    = 1 << 5, // TEST_CASE_CRASHED2
+    BPLineTraitAssertion     = 1 << 6, // TEST_CASE_CRASHED3
+    BPLineTraitUITestFailure = 1 << 7, // UITEST_CASE_FAILED
+};
+
+static BPLineTraits BPClassifyLine(const char *line) {
+    BPLineTraits traits = BPLineTraitNone;
+    if (!line) {
+        return traits;
+    }
+    if (strstr(line, "Test Case '-[")) {
+        traits |= BPLineTraitTestCase;
+    }
+    if (strstr(line, "Test Suite '")) {
+        traits |= BPLineTraitSuite;
+    }
+    if (strstr(line, "Executed ")) {
+        traits |= BPLineTraitSuiteEnded;
+    }
+    if (strstr(line, ": error: ")) {
+        traits |= BPLineTraitError;
+    }
+    if (strstr(line, "fatal error: ")) {
+        traits |= BPLineTraitFatalError;
+    }
+    if (strstr(line, "stack trace for ")) {
+        traits |= BPLineTraitStackTrace;
+    }
+    if (strstr(line, "*** Assertion failure in ")) {
+        traits |= BPLineTraitAssertion;
+    }
+    if (strstr(line, "Assertion Failure:")) {
+        traits |= BPLineTraitUITestFailure;
+    }
+    return traits;
+}
+
+// The regular expressions are compiled exactly once and shared by every parser.
+// NSRegularExpression is immutable and safe to use from multiple threads.
+static NSArray<NSTextCheckingResult *> *BPMatchesInLine(NSString *pattern, NSString *line) {
+    static NSDictionary<NSString *, NSRegularExpression *> *regexes;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableDictionary *compiled = [[NSMutableDictionary alloc] init];
+        for (NSString *p in @[TEST_SUITE_START, TEST_SUITE_ENDED, TEST_CASE_STARTED, TEST_CASE_FAILED, UITEST_CASE_FAILED,
+                              TEST_CASE_CRASHED, TEST_CASE_CRASHED2, TEST_CASE_CRASHED3, TEST_CASE_CRASHED4, TEST_CASE_PASSED]) {
+            compiled[p] = [NSRegularExpression regularExpressionWithPattern:p options:0 error:nil];
+        }
+        regexes = [compiled copy];
+    });
+    NSRegularExpression *regex = regexes[pattern];
+    NSCAssert(regex, @"No precompiled regex for pattern %@", pattern);
+    return [regex matchesInString:line options:0 range:NSMakeRange(0, [line length])];
+}
+
+static NSDateFormatter *BPSuiteDateFormatter(void) {
+    static NSDateFormatter *dateFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        dateFormatter.dateFormat = @"YYYY-MM-dd HH:mm:ss.SSS";
+    });
+    return dateFormatter;
+}
+
 @interface BPTreeParser () <BPExecutionPhaseProtocol, BPMonitorCallbackProtocol>
 
 @property (nonatomic, strong) BPWriter *log;
 
-@property (nonatomic, strong) NSString *line;
+// Bytes of the current line that arrived without their terminating newline yet
+@property (nonatomic, strong) NSMutableData *partialLine;
 @property (nonatomic, strong) BPTestSuiteLogEntry *root;
 @property (nonatomic, assign) BPTestSuiteLogEntry *current;
 @property (nonatomic, assign) BPTestCaseLogEntry *currentTest;
@@ -46,14 +125,35 @@ static const NSString * const kPassed = @"passed";
 
 @property (nonatomic, assign) BOOL moveToParent;
 
+// With structured results, the output is matched to the tests through XCTest's own progress lines in it,
+// since it arrives on another queue than the results and can lag behind or run ahead of them.
+// Both sides count the runs of every test, so that a test that is run again is told apart from its last run.
+@property (nonatomic, strong) NSString *outputTestKey;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *outputTestRuns;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *structuredTestRuns;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, BPTestCaseLogEntry *> *structuredTestCases;
+// Output of tests whose start hasn't been reported yet.
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *pendingOutput;
+@property (nonatomic, strong) NSMutableSet<BPTestCaseLogEntry *> *skippedTests;
+
 @end
 
 @implementation BPTreeParser
 
 - (instancetype)initWithWriter:(BPWriter *)writer {
+    return [self initWithWriter:writer assembler:[[BPTreeAssembler alloc] initWithStats:[BPStats sharedStats]]];
+}
+
+- (instancetype)initWithWriter:(BPWriter *)writer assembler:(BPTreeAssembler *)assembler {
     self = [super init];
     if (self) {
-        self.line = @"";
+        _assembler = assembler;
+        self.partialLine = [[NSMutableData alloc] init];
+        self.outputTestRuns = [[NSMutableDictionary alloc] init];
+        self.structuredTestRuns = [[NSMutableDictionary alloc] init];
+        self.structuredTestCases = [[NSMutableDictionary alloc] init];
+        self.pendingOutput = [[NSMutableDictionary alloc] init];
+        self.skippedTests = [[NSMutableSet alloc] init];
         self.log = writer;
         [self writeHeader];
     }
@@ -61,27 +161,35 @@ static const NSString * const kPassed = @"passed";
 }
 
 - (BPTestSuiteLogEntry *)root {
-    return [BPTreeAssembler sharedInstance].root;
+    return self.assembler.root;
 }
 
 - (void)setRoot:(BPTestSuiteLogEntry *)root {
-    [BPTreeAssembler sharedInstance].root = root;
+    self.assembler.root = root;
 }
 
 - (BPTestSuiteLogEntry *)current {
-    return [BPTreeAssembler sharedInstance].current;
+    return self.assembler.current;
 }
 
 - (void)setCurrent:(BPTestSuiteLogEntry *)current {
-    [BPTreeAssembler sharedInstance].current = current;
+    self.assembler.current = current;
 }
 
 - (BPTestCaseLogEntry *)currentTest {
-    return [BPTreeAssembler sharedInstance].currentTest;
+    return self.assembler.currentTest;
 }
 
 - (void)setCurrentTest:(BPTestCaseLogEntry *)currentTest {
-    [BPTreeAssembler sharedInstance].currentTest = currentTest;
+    self.assembler.currentTest = currentTest;
+}
+
+- (BPJUnitJournal *)journal {
+    return self.assembler.journal;
+}
+
+- (void)setJournal:(BPJUnitJournal *)journal {
+    self.assembler.journal = journal;
 }
 
 - (void)writeHeader {
@@ -91,39 +199,51 @@ static const NSString * const kPassed = @"passed";
 }
 
 - (void)handleChunkData:(nonnull NSData *)chunk {
-    if ([chunk length] > 0) {
-        NSString *str = [[NSString alloc] initWithData:chunk encoding:NSUTF8StringEncoding];
-        if (!str) {
-            [BPUtils printInfo:WARNING withString:@"Failed to UTF8 decode chunk: %@", chunk];
-            str = [[NSString alloc] initWithData:chunk encoding:NSASCIIStringEncoding];
-            [BPUtils printInfo:WARNING withString:@"ASCII: %@", str];
+    // Split on raw '\n' bytes and only decode complete lines. A '\n' byte can never appear
+    // inside a multi-byte UTF-8 sequence, so a character torn across two chunks is simply
+    // carried over in partialLine until the rest of the line arrives.
+    const char *bytes = [chunk bytes];
+    size_t length = [chunk length];
+    size_t lineStart = 0;
+    while (lineStart < length) {
+        const char *newline = memchr(bytes + lineStart, '\n', length - lineStart);
+        if (!newline) {
+            break;
         }
-        if (!str) {
-            [BPUtils printInfo:ERROR withString:@"Failed to ASCII decode chunk: %@", chunk];
-            exit(1);
+        size_t lineEnd = newline - bytes;
+        NSString *line;
+        if ([self.partialLine length]) {
+            [self.partialLine appendBytes:bytes + lineStart length:lineEnd - lineStart];
+            line = [self decodeLineBytes:[self.partialLine bytes] length:[self.partialLine length]];
+            [self.partialLine setLength:0];
+        } else {
+            line = [self decodeLineBytes:bytes + lineStart length:lineEnd - lineStart];
         }
-        NSRange range = [str rangeOfCharacterFromSet:[NSCharacterSet newlineCharacterSet]];
-        unsigned long numLines = 0;
-        unsigned long maxLines = [chunk length];
-        while (range.location != NSNotFound) {
-            self.line = [self.line stringByAppendingString:[str substringToIndex:range.location] ?: @""];
-            [self.log writeLine:@"%@", self.line];
-            [self parseLine:self.line];
-            if (numLines++ > maxLines) {
-                [BPUtils printInfo:ERROR withString:@"Infinite Loop Averted!: range {%lu, %lu}, %lu, %@",
-                 (unsigned long)range.length, (unsigned long)range.location, (unsigned long)[chunk length], str];
-                [BPUtils printInfo:ERROR withString:@"Data: %@", chunk];
-                // Fail hard.
-                exit(1);
-            }
-            self.line = @"";
-            str = [str substringFromIndex:range.location+range.length];
-            range = [str rangeOfCharacterFromSet:[NSCharacterSet newlineCharacterSet]];
+        [self.log writeLine:@"%@", line];
+        // The structured results arrive on another queue and build the same tree
+        @synchronized (self) {
+            [self parseLine:line];
         }
-        self.line = str;
+        lineStart = lineEnd + 1;
+    }
+    if (lineStart < length) {
+        [self.partialLine appendBytes:bytes + lineStart length:length - lineStart];
     }
 }
 
+- (NSString *)decodeLineBytes:(const char *)bytes length:(size_t)length {
+    if (length > 0 && bytes[length - 1] == '\r') {
+        length--;
+    }
+    NSString *line = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    if (!line) {
+        // Latin-1 maps every byte to a character, so this never fails.
+        [BPUtils printInfo:WARNING withString:@"Failed to UTF8 decode line, falling back to Latin-1"];
+        line = [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+    }
+    return line;
+}
+
 - (void)parseLine:(nullable NSString *)line {
     [BPUtils printInfo:DEBUGINFO withString:@"[OUTPUT] %@", line];
     [self onOutputReceived:line];
@@ -131,18 +251,22 @@ static const NSString * const kPassed = @"passed";
         return;
     }
 
-    NSRange lineRange = NSMakeRange(0, [line length]);
     BOOL logLine = YES;
-    NSRegularExpression *regex;
     NSArray *matches;
+    BPLineTraits traits = BPClassifyLine([line UTF8String]);
+    // With structured results, XCTest's own progress lines carry nothing we don't already know,
+    // the failures are reported with their location, and only crashes still need to be read here.
+    if (self.structuredResults) {
+        logLine = ![self trackOutputTestWithLine:line traits:traits];
+        traits &= (BPLineTraitFatalError | BPLineTraitStackTrace | BPLineTraitAssertion);
+    }
 
     if ([line isEqualToString:@"BP_APP_PROC_ENDED"]) {
         logLine = NO;
     }
 
     // 	 Executed 9 tests, with 2 failures (1 unexpected) in 2.980 (3.206) seconds
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_SUITE_ENDED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitSuiteEnded) ? BPMatchesInLine(TEST_SUITE_ENDED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 6) {
             logLine = NO;
@@ -151,15 +275,10 @@ static const NSString * const kPassed = @"passed";
             NSString *numberOfUnexpectedString = [line substringWithRange:[result rangeAtIndex:3]];
             NSString *time2String = [line substringWithRange:[result rangeAtIndex:5]];
 
-            NSInteger failures = [numberOfFailuresString integerValue];
-            NSInteger unexpectedFailures = [numberOfUnexpectedString integerValue];
-            self.current.reportedNumberOfTests = [numberOfTestsString integerValue];
-            self.current.reportedNumberOfErrors = failures - unexpectedFailures;
-            self.current.reportedNumberOfFailures = unexpectedFailures;
-            self.current.reportedTotalTime = [time2String doubleValue];
-
-            [self onTestSuiteEnded:self.current.testSuiteName
-                            isRoot:(self.current == self.root)];
+            [self reportTestSuiteTotalsWithTests:[numberOfTestsString integerValue]
+                                        failures:[numberOfFailuresString integerValue]
+                                      unexpected:[numberOfUnexpectedString integerValue]
+                                       totalTime:[time2String doubleValue]];
         }
     }
 
@@ -167,16 +286,12 @@ static const NSString * const kPassed = @"passed";
     // - We handled the "Executed..." line and therefore are free to move to the parent
     // - There was no "Executed..." line and therefore we are free to move to the parent
     // After moving, reset the flag back to 0.
-    if (self.moveToParent && self.current.parent) {
-        self.current = self.current.parent;
-    }
-    self.moveToParent = NO;
+    [self moveToParentIfNeeded];
 
     // Test Suite 'mntf_UISwiftTests' started at 2016-10-07 12:52:05.091
     // Test Suite 'Debug-iphonesimulator' passed at 2016-10-07 12:52:05.091.
     // Test Suite 'mntf_UISwiftTests' failed at 2016-10-07 12:52:08.297.
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_SUITE_START options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitSuite) ? BPMatchesInLine(TEST_SUITE_START, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 4) {
             logLine = NO;
@@ -184,97 +299,33 @@ static const NSString * const kPassed = @"passed";
             NSString *started = [line substringWithRange:[result rangeAtIndex:2]];
             NSString *dateString = [line substringWithRange:[result rangeAtIndex:3]];
 
-            NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-            dateFormatter.dateFormat = @"YYYY-MM-dd HH:mm:ss.SSS";
-            NSDate *date = [dateFormatter dateFromString:dateString];
-
-            BOOL start = [kStarted isEqualToString:started];
-            if (start) {
-                BPTestSuiteLogEntry *logEntry = [[BPTestSuiteLogEntry alloc] init];
-                if (!self.root) {
-                    self.root = logEntry;
-                    self.current = self.root;
-                    self.hasRoot = YES;
-                    self.currentRootName = testSuiteName;
-                } else {
-                    if (!self.hasRoot) {
-                        // We're on a secondary run where we have a root node but this execution does not yet have a root.
-                        // It pretty much means we should ignore this suite and everything should be added to the current root.
-                        // Plus reset the 'current' nodes.
-                        self.current = self.root;
-                        self.currentTest = nil;
-                        self.hasRoot = YES;
-                        self.currentRootName = testSuiteName;
-                        // Force the root node to 'open' again. See below for more information.
-                        self.root.ended = NO;
-                        continue;
-                    }
-                    [self.current addChild:logEntry];
-                    logEntry.parent = self.current;
-                    self.current = logEntry;
-                }
-                self.current.testSuiteName = testSuiteName;
-                self.current.startTime = date;
-                self.current.line = line;
-                // Force the node to 'open' again because we could be running more tests in a suite from a previous crash
-                // By forcing the node to not ended, we'll allow it to be closed again after more children are appended
-                // Since this is always the start of a node, there is no reason it shouldn't be open at this point
-                self.current.ended = NO;
-
-                [self onTestSuiteBegan:testSuiteName onDate:date isRoot:(self.current == self.root)];
+            NSDate *date = [BPSuiteDateFormatter() dateFromString:dateString];
+
+            if ([kStarted isEqualToString:started]) {
+                [self beginTestSuite:testSuiteName onDate:date line:line];
             } else {
-                // An ending block
-                // It either has to close the current node
-                // Or it has to close the parent node
-                BPTestSuiteLogEntry *node = self.current;
-                if (([node.testSuiteName isEqualToString:testSuiteName] || [self.currentRootName isEqualToString:testSuiteName]) && node.ended == NO) {
-                    self.current = node;
-                } else if (([node.parent.testSuiteName isEqualToString:testSuiteName]) && node.parent.ended == NO) {
-                    self.current = node.parent;
-                } else {
-                    [BPUtils printInfo:ERROR withString:
-                     @"ERROR: WHERE ARE WE??? We're closing a node for a test suite that hasn't been started [Expected: %@, Current: %@]. Ended: %@\nProblem line: %@",
-                      testSuiteName,
-                      node.testSuiteName,
-                      node.ended ? @"YES" : @"NO",
-                      line];
-                }
-                self.current.endTime = date;
-                self.current.ended = YES;
-                self.current.passed = [kPassed isEqualToString:started];
-                self.moveToParent = YES;
+                [self closeTestSuite:testSuiteName passed:[kPassed isEqualToString:started] onDate:date line:line];
             }
         }
     }
 
     // Test Case '-[mntf_iosUITests.mntf_UISwiftTests testWaitForCheckpoint]' started.
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_STARTED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitTestCase) ? BPMatchesInLine(TEST_CASE_STARTED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 3) {
             logLine = NO;
             NSString *originalClassName = [line substringWithRange:[result rangeAtIndex:1]];
-            NSString *testCaseClass = [self adjustClassName:originalClassName];
             NSString *testCaseName = [line substringWithRange:[result rangeAtIndex:2]];
-            if ([self isSwiftTest:originalClassName]) {
-                testCaseName = [NSString stringWithFormat:@"%@()", testCaseName];
-            }
-            BPTestCaseLogEntry *testCaseLogEntry = [[BPTestCaseLogEntry alloc] init];
-            testCaseLogEntry.testCaseClass = testCaseClass;
-            testCaseLogEntry.testCaseName = testCaseName;
-            testCaseLogEntry.line = line;
-            testCaseLogEntry.startTime = [NSDate date];
-            [self.current addChild:testCaseLogEntry];
-            self.currentTest = testCaseLogEntry;
-            [self onTestCaseBeganWithName:testCaseName inClass:testCaseClass];
+            [self beginTestCase:[self adjustTestName:testCaseName forClass:originalClassName]
+                        inClass:[self adjustClassName:originalClassName]
+                           line:line];
         }
     }
 
     // /Users/agandhi/Documents/Source/msg/mntf-ios_trunk/mntf-iosUITests/mntf_iosUISwiftTests.swift:67: error: -[mntf_iosUITests.mntf_UISwiftTests testAdd] : XCTAssertTrue failed - This doesn't contain the string we're looking for!
     // /Users/agandhi/Documents/Source/msg/mntf-ios_trunk/mntf-iosUITests/mntf_iosUISwiftTests.swift:75: error: -[mntf_iosUITests.mntf_UISwiftTests testGetName] : failed: caught "MyException", "My Reason"
     // /export/home/tester/hudson/data/workspace/MP_TRUNKDEV_DISTRIBUTED_TEST/voyager-ios_7dee32c1fdb9facfff35737351eeab72cfa90126/Testing/VoyagerIntTestsLib/Shared/VoyagerIntTestCase.swift:172: error: -[VoyagerFeedIndividualPageTests.FeedEmptyFeedVariant1SplashTest testHighlightedDeepLinkEmptyFeedHidden] : The step timed out after 10.00 seconds: Waiting for notification "concurrent_dispatch_queue_finish"
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_FAILED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitError) ? BPMatchesInLine(TEST_CASE_FAILED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 6) {
             logLine = YES; // We still want to log this line
@@ -285,13 +336,8 @@ static const NSString * const kPassed = @"passed";
             NSRange rangeOfFailure = [result rangeAtIndex:5];
             NSString *errorMessage = [line substringWithRange:rangeOfFailure];
 
-            BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
-            if (testCaseLogEntry) {
-                testCaseLogEntry.filename = filename;
-                testCaseLogEntry.lineNumber = [lineNumber integerValue];
-                testCaseLogEntry.failure = NO; // failure means app crashed
-                testCaseLogEntry.errorMessage = errorMessage;
-            } else {
+            if (![self recordErrorInTestCase:testCaseName inClass:testCaseClass
+                                      inFile:filename onLineNumber:[lineNumber integerValue] withMessage:errorMessage]) {
                 [BPUtils printInfo:ERROR withString:
                  @"HOW DID WE GET AN ERROR THAT WASN'T PARSED? We received an error in a test case that wasn't started or did not parse properly.\nProblem line: %@",
                   line];
@@ -301,8 +347,7 @@ static const NSString * const kPassed = @"passed";
     }
 
     // fatal error: unexpectedly found nil while unwrapping an Optional value
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_CRASHED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitFatalError) ? BPMatchesInLine(TEST_CASE_CRASHED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 2) {
             logLine = YES; // We still want to log this line
@@ -331,8 +376,7 @@ static const NSString * const kPassed = @"passed";
     // already closed out the test.
 
     // stack trace for SIGNAL 11 (Segmentation fault: 11):
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_CRASHED2 options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitStackTrace) ? BPMatchesInLine(TEST_CASE_CRASHED2, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 2) {
             logLine = YES; // We still want to log this line
@@ -356,8 +400,7 @@ static const NSString * const kPassed = @"passed";
     }
 
     // *** Assertion failure in -[UICollectionView _dequeueReusableViewOfKind:withIdentifier:forIndexPath:viewCategory:], /BuildRoot/Library/Caches/com.apple.xbs/Sources/UIKit_Sim/UIKit-3600.5.2/UICollectionView.m:4922
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_CRASHED3 options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitAssertion) ? BPMatchesInLine(TEST_CASE_CRASHED3, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 4) {
             logLine = YES;
@@ -383,8 +426,7 @@ static const NSString * const kPassed = @"passed";
     }
 
     // /export/home/tester/hudson/data/workspace/MP_TRUNKDEV_DISTRIBUTED_TEST/voyager-ios_b7eadfa63fdc85ff5143ed9ff580bb1a9ab7bc25/Testing/VoyagerIdentityTests/Me/Notifications/MeFeedAggregatePropCardTest.swift:421: error: -[VoyagerMeTests.MeFeedAggregatePropCardTest testExpandableAggregatePropCard] : Error Domain=com.LIMixture.MixtureProtocol.MixtureValidator Code=-101 "(null)" UserInfo={CapturedTrackingEvents=(
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_CRASHED4 options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitError) ? BPMatchesInLine(TEST_CASE_CRASHED4, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 4) {
             logLine = YES;
@@ -409,8 +451,7 @@ static const NSString * const kPassed = @"passed";
         }
     }
     // XCTestOutputBarrier    t =     6.50s         Assertion Failure: BPSampleAppUITests.m:30: No matches found for Find: Elements containing elements matching type Button with identifier 'Tap Me 2' from input {(
-    regex = [NSRegularExpression regularExpressionWithPattern:UITEST_CASE_FAILED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitUITestFailure) ? BPMatchesInLine(UITEST_CASE_FAILED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 4) {
             logLine = YES;
@@ -435,64 +476,329 @@ static const NSString * const kPassed = @"passed";
 
     // Test Case '-[mntf_iosUITests.mntf_UISwiftTests testWaitForCheckpoint]' passed (1.037 seconds).
     // Test Case '-[mntf_iosUITests.mntf_UISwiftTests testWaitForCheckpoint]' failed (1.037 seconds).
-    regex = [NSRegularExpression regularExpressionWithPattern:TEST_CASE_PASSED options:0 error:nil];
-    matches = [regex matchesInString:line options:0 range:lineRange];
+    matches = (traits & BPLineTraitTestCase) ? BPMatchesInLine(TEST_CASE_PASSED, line) : nil;
     for (NSTextCheckingResult *result in matches) {
         if ([result numberOfRanges] == 5) {
             logLine = NO;
             NSString *originalClassName = [line substringWithRange:[result rangeAtIndex:1]];
             NSString *testCaseClass = [self adjustClassName:originalClassName];
-            NSString *testCaseName = [line substringWithRange:[result rangeAtIndex:2]];
-            if ([self isSwiftTest:originalClassName]) {
-                testCaseName = [NSString stringWithFormat:@"%@()", testCaseName];
-            }
+            NSString *testCaseName = [self adjustTestName:[line substringWithRange:[result rangeAtIndex:2]] forClass:originalClassName];
             NSString *passed = [line substringWithRange:[result rangeAtIndex:3]];
             NSString *time = [line substringWithRange:[result rangeAtIndex:4]];
 
-            BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
-            if (testCaseLogEntry) {
-                testCaseLogEntry.totalTime = [time doubleValue];
-                testCaseLogEntry.ended = YES;
-                testCaseLogEntry.endTime = [NSDate date];
-                testCaseLogEntry.passed = [kPassed isEqualToString:passed];
-                testCaseLogEntry.failure = NO;
-                if (testCaseLogEntry.passed) {
-                    [self onTestCasePassedWithName:testCaseName inClass:testCaseClass reportedDuration:testCaseLogEntry.totalTime];
-                } else {
-                    [self onTestCaseFailedWithName:testCaseName inClass:testCaseClass
-                                            inFile:testCaseLogEntry.filename onLineNumber:testCaseLogEntry.lineNumber
-                                      wasException:testCaseLogEntry.failure];
-                }
-            } else {
+            if (![self finishTestCase:testCaseName inClass:testCaseClass
+                               passed:[kPassed isEqualToString:passed] duration:[time doubleValue]]) {
                 [BPUtils printInfo:ERROR withString:
                  @"HOW ON EARTH DID THIS HAPPEN? The test case passed but we failed to handle it properly\nProblem line: %@",
                   line];
             }
-            self.currentTest = nil;
         }
     }
 
     if (logLine) {
-        BPLogEntry *logEntry;
-        if (self.currentTest) {
-            if (!self.currentTest.log) {
-                self.currentTest.log = @"";
-            }
-            logEntry = self.currentTest;
+        if (self.structuredResults) {
+            [self appendStructuredLogLine:line];
         } else {
-            if (!self.current.log) {
-                self.current.log = @"";
+            BPLogEntry *logEntry = self.currentTest ?: self.current;
+            [logEntry appendLogLine:line];
+        }
+    }
+}
+
+// Whether this is one of the lines XCTest prints to mark the progress of the tests. The test case
+// lines also tell which test the output in between belongs to.
+- (BOOL)trackOutputTestWithLine:(NSString *)line traits:(BPLineTraits)traits {
+    if (traits & BPLineTraitTestCase) {
+        for (NSTextCheckingResult *result in BPMatchesInLine(TEST_CASE_STARTED, line)) {
+            if ([result numberOfRanges] == 3) {
+                NSString *originalClassName = [line substringWithRange:[result rangeAtIndex:1]];
+                NSString *testCaseName = [self adjustTestName:[line substringWithRange:[result rangeAtIndex:2]] forClass:originalClassName];
+                self.outputTestKey = [self nextRunOfTestCase:testCaseName
+                                                     inClass:[self adjustClassName:originalClassName]
+                                                      inRuns:self.outputTestRuns];
+                return YES;
             }
-            logEntry = self.current;
         }
-        if (logEntry.log == nil) {
-            logEntry.log = @"";
+        if ([BPMatchesInLine(TEST_CASE_PASSED, line) count]) {
+            self.outputTestKey = nil;
+            return YES;
+        }
+    }
+    return ((traits & BPLineTraitSuiteEnded) && [BPMatchesInLine(TEST_SUITE_ENDED, line) count]) ||
+           ((traits & BPLineTraitSuite) && [BPMatchesInLine(TEST_SUITE_START, line) count]);
+}
+
+- (NSString *)nextRunOfTestCase:(NSString *)testCaseName
+                        inClass:(NSString *)testCaseClass
+                         inRuns:(NSMutableDictionary<NSString *, NSNumber *> *)runs {
+    NSString *testKey = [NSString stringWithFormat:@"%@/%@", testCaseClass, testCaseName];
+    NSUInteger run = [runs[testKey] unsignedIntegerValue] + 1;
+    runs[testKey] = @(run);
+    return [NSString stringWithFormat:@"%@#%lu", testKey, (unsigned long)run];
+}
+
+- (void)appendStructuredLogLine:(NSString *)line {
+    NSString *testKey = self.outputTestKey;
+    if (!testKey) {
+        [self.current appendLogLine:line];
+        return;
+    }
+    BPTestCaseLogEntry *testCaseLogEntry = self.structuredTestCases[testKey];
+    if (testCaseLogEntry) {
+        [testCaseLogEntry appendLogLine:line];
+        return;
+    }
+    if (!self.pendingOutput[testKey]) {
+        self.pendingOutput[testKey] = [[NSMutableArray alloc] init];
+    }
+    [self.pendingOutput[testKey] addObject:line];
+}
+
+#pragma mark - Tree assembly
+
+- (void)beginTestSuite:(NSString *)testSuiteName onDate:(NSDate *)date line:(NSString *)line {
+    BPTestSuiteLogEntry *logEntry = [[BPTestSuiteLogEntry alloc] init];
+    logEntry.maxLogSize = self.maxSuiteLogSize;
+    logEntry.logSpillDirectory = self.logSpillDirectory;
+    if (!self.root) {
+        self.root = logEntry;
+        self.current = self.root;
+        self.hasRoot = YES;
+        self.currentRootName = testSuiteName;
+    } else {
+        if (!self.hasRoot) {
+            // We're on a secondary run where we have a root node but this execution does not yet have a root.
+            // It pretty much means we should ignore this suite and everything should be added to the current root.
+            // Plus reset the 'current' nodes.
+            self.current = self.root;
+            self.currentTest = nil;
+            self.hasRoot = YES;
+            self.currentRootName = testSuiteName;
+            // Force the root node to 'open' again. See below for more information.
+            self.root.ended = NO;
+            return;
+        }
+        [self.current addChild:logEntry];
+        logEntry.parent = self.current;
+        self.current = logEntry;
+    }
+    self.current.testSuiteName = testSuiteName;
+    self.current.startTime = date;
+    self.current.line = line;
+    // Force the node to 'open' again because we could be running more tests in a suite from a previous crash
+    // By forcing the node to not ended, we'll allow it to be closed again after more children are appended
+    // Since this is always the start of a node, there is no reason it shouldn't be open at this point
+    self.current.ended = NO;
+    [self.journal recordTestSuite:self.current
+                      inTestSuite:self.current.parent
+                         withName:[JUnitReporter xmlSimpleEscape:testSuiteName]
+                        timestamp:[JUnitReporter timestampFromDate:date] ?: @""];
+
+    [self onTestSuiteBegan:testSuiteName onDate:date isRoot:(self.current == self.root)];
+}
+
+- (void)closeTestSuite:(NSString *)testSuiteName passed:(BOOL)passed onDate:(NSDate *)date line:(NSString *)line {
+    // An ending block
+    // It either has to close the current node
+    // Or it has to close the parent node
+    BPTestSuiteLogEntry *node = self.current;
+    if (([node.testSuiteName isEqualToString:testSuiteName] || [self.currentRootName isEqualToString:testSuiteName]) && node.ended == NO) {
+        self.current = node;
+    } else if (([node.parent.testSuiteName isEqualToString:testSuiteName]) && node.parent.ended == NO) {
+        self.current = node.parent;
+    } else {
+        [BPUtils printInfo:ERROR withString:
+         @"ERROR: WHERE ARE WE??? We're closing a node for a test suite that hasn't been started [Expected: %@, Current: %@]. Ended: %@\nProblem line: %@",
+          testSuiteName,
+          node.testSuiteName,
+          node.ended ? @"YES" : @"NO",
+          line];
+    }
+    self.current.endTime = date;
+    self.current.ended = YES;
+    self.current.passed = passed;
+    self.moveToParent = YES;
+}
+
+- (void)reportTestSuiteTotalsWithTests:(NSInteger)tests failures:(NSInteger)failures unexpected:(NSInteger)unexpectedFailures totalTime:(NSTimeInterval)totalTime {
+    self.current.reportedNumberOfTests = tests;
+    self.current.reportedNumberOfErrors = failures - unexpectedFailures;
+    self.current.reportedNumberOfFailures = unexpectedFailures;
+    self.current.reportedTotalTime = totalTime;
+    [self.journal recordTestSuite:self.current withReportedTime:totalTime];
+
+    [self onTestSuiteEnded:self.current.testSuiteName
+                    isRoot:(self.current == self.root)];
+}
+
+- (void)moveToParentIfNeeded {
+    if (self.moveToParent && self.current.parent) {
+        self.current = self.current.parent;
+    }
+    self.moveToParent = NO;
+}
+
+- (void)beginTestCase:(NSString *)testCaseName inClass:(NSString *)testCaseClass line:(NSString *)line {
+    BPTestCaseLogEntry *testCaseLogEntry = [[BPTestCaseLogEntry alloc] init];
+    testCaseLogEntry.testCaseClass = testCaseClass;
+    testCaseLogEntry.testCaseName = testCaseName;
+    testCaseLogEntry.line = line;
+    testCaseLogEntry.startTime = [NSDate date];
+    testCaseLogEntry.maxLogSize = self.maxLogSize;
+    testCaseLogEntry.logSpillDirectory = self.logSpillDirectory;
+    [self.current addChild:testCaseLogEntry];
+    self.currentTest = testCaseLogEntry;
+    [self onTestCaseBeganWithName:testCaseName inClass:testCaseClass];
+}
+
+- (BOOL)recordErrorInTestCase:(NSString *)testCaseName inClass:(NSString *)testCaseClass
+                       inFile:(NSString *)filename onLineNumber:(NSInteger)lineNumber withMessage:(NSString *)errorMessage {
+    BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
+    if (!testCaseLogEntry) {
+        return NO;
+    }
+    testCaseLogEntry.filename = filename;
+    testCaseLogEntry.lineNumber = lineNumber;
+    testCaseLogEntry.failure = NO; // failure means app crashed
+    testCaseLogEntry.errorMessage = errorMessage;
+    return YES;
+}
+
+- (BOOL)finishTestCase:(NSString *)testCaseName inClass:(NSString *)testCaseClass passed:(BOOL)passed duration:(NSTimeInterval)duration {
+    BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
+    self.currentTest = nil;
+    if (!testCaseLogEntry) {
+        return NO;
+    }
+    testCaseLogEntry.totalTime = duration;
+    testCaseLogEntry.ended = YES;
+    testCaseLogEntry.endTime = [NSDate date];
+    testCaseLogEntry.passed = passed;
+    testCaseLogEntry.failure = NO;
+    [self journalTestCase:testCaseLogEntry];
+    if (testCaseLogEntry.passed) {
+        [self onTestCasePassedWithName:testCaseName inClass:testCaseClass reportedDuration:testCaseLogEntry.totalTime];
+    } else {
+        [self onTestCaseFailedWithName:testCaseName inClass:testCaseClass
+                                inFile:testCaseLogEntry.filename onLineNumber:testCaseLogEntry.lineNumber
+                          wasException:testCaseLogEntry.failure];
+    }
+    return YES;
+}
+
+// Test cases are journaled in the suite being run, as soon as they finish or are aborted.
+- (void)journalTestCase:(BPTestCaseLogEntry *)testCaseLogEntry {
+    BPJUnitJournal *journal = self.journal;
+    if (!journal) {
+        return;
+    }
+    NSInteger indent = 1;
+    for (BPTestSuiteLogEntry *suite = self.current; suite.parent; suite = suite.parent) {
+        indent++;
+    }
+    [journal recordTestCase:testCaseLogEntry
+                inTestSuite:self.current
+                   withTime:testCaseLogEntry.totalTime
+                    failure:(!testCaseLogEntry.passed && testCaseLogEntry.failure)
+                      error:(!testCaseLogEntry.passed && !testCaseLogEntry.failure)
+                      junit:[JUnitReporter junitForTestCase:testCaseLogEntry withIndentLevel:indent]];
+}
+
+#pragma mark - Structured results
+
+- (void)onStructuredTestSuiteStarted:(NSString *)testSuiteName atTime:(NSString *)time {
+    @synchronized (self) {
+        [self beginTestSuite:testSuiteName onDate:[self dateFromTime:time] line:nil];
+    }
+}
+
+- (void)onStructuredTestSuiteFinished:(NSString *)testSuiteName
+                               atTime:(NSString *)time
+                             runCount:(NSUInteger)runCount
+                             failures:(NSUInteger)failures
+                           unexpected:(NSUInteger)unexpectedFailures
+                        totalDuration:(NSTimeInterval)totalDuration {
+    @synchronized (self) {
+        [self closeTestSuite:testSuiteName passed:(failures == 0) onDate:[self dateFromTime:time] line:nil];
+        [self reportTestSuiteTotalsWithTests:runCount failures:failures unexpected:unexpectedFailures totalTime:totalDuration];
+        [self moveToParentIfNeeded];
+    }
+}
+
+- (void)onStructuredTestCaseStartedWithName:(NSString *)testName inClass:(NSString *)testClass {
+    @synchronized (self) {
+        NSString *testCaseName = [self adjustTestName:testName forClass:testClass];
+        NSString *testCaseClass = [self adjustClassName:testClass];
+        [self beginTestCase:testCaseName inClass:testCaseClass line:nil];
+        NSString *testKey = [self nextRunOfTestCase:testCaseName inClass:testCaseClass inRuns:self.structuredTestRuns];
+        self.structuredTestCases[testKey] = self.currentTest;
+        for (NSString *line in self.pendingOutput[testKey]) {
+            [self.currentTest appendLogLine:line];
+        }
+        [self.pendingOutput removeObjectForKey:testKey];
+    }
+}
+
+- (void)onStructuredTestCaseFailedWithName:(NSString *)testName
+                                   inClass:(NSString *)testClass
+                                    inFile:(NSString *)filePath
+                              onLineNumber:(NSUInteger)lineNumber
+                               withMessage:(NSString *)message {
+    @synchronized (self) {
+        NSString *testCaseName = [self adjustTestName:testName forClass:testClass];
+        NSString *testCaseClass = [self adjustClassName:testClass];
+        if (![self recordErrorInTestCase:testCaseName inClass:testCaseClass
+                                  inFile:filePath onLineNumber:lineNumber withMessage:message]) {
+            [BPUtils printInfo:ERROR withString:@"Received a failure for %@/%@, which wasn't started.", testCaseClass, testCaseName];
+        }
+    }
+}
+
+- (void)onStructuredTestCaseSkippedWithName:(NSString *)testName
+                                    inClass:(NSString *)testClass
+                                withMessage:(NSString *)message {
+    @synchronized (self) {
+        NSString *testCaseName = [self adjustTestName:testName forClass:testClass];
+        NSString *testCaseClass = [self adjustClassName:testClass];
+        BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
+        if (!testCaseLogEntry) {
+            [BPUtils printInfo:ERROR withString:@"Received a skip for %@/%@, which wasn't started.", testCaseClass, testCaseName];
+            return;
+        }
+        [testCaseLogEntry appendLogLine:[NSString stringWithFormat:@"Test skipped: %@", message ?: @""]];
+        [self.skippedTests addObject:testCaseLogEntry];
+    }
+}
+
+- (void)onStructuredTestCaseFinishedWithName:(NSString *)testName
+                                     inClass:(NSString *)testClass
+                                      passed:(BOOL)passed
+                                    duration:(NSTimeInterval)duration {
+    @synchronized (self) {
+        NSString *testCaseName = [self adjustTestName:testName forClass:testClass];
+        NSString *testCaseClass = [self adjustClassName:testClass];
+        BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testCaseClass andName:testCaseName];
+        if (testCaseLogEntry && [self.skippedTests containsObject:testCaseLogEntry]) {
+            [self.skippedTests removeObject:testCaseLogEntry];
+            passed = YES;
+        }
+        if (![self finishTestCase:testCaseName inClass:testCaseClass passed:passed duration:duration]) {
+            [BPUtils printInfo:ERROR withString:@"Received a result for %@/%@, which wasn't started.", testCaseClass, testCaseName];
         }
-        logEntry.log = [logEntry.log stringByAppendingString:line];
-        logEntry.log = [logEntry.log stringByAppendingString:@"\n"];
     }
 }
 
+- (NSDate *)dateFromTime:(NSString *)time {
+    return (time ? [BPSuiteDateFormatter() dateFromString:time] : nil) ?: [NSDate date];
+}
+
+- (NSString *)adjustTestName:(NSString *)testName forClass:(NSString *)originalClassName {
+    if ([self isSwiftTest:originalClassName] && ![testName hasSuffix:@"()"]) {
+        return [NSString stringWithFormat:@"%@()", testName];
+    }
+    return testName;
+}
+
 - (BOOL)isSwiftTest:(NSString *)className {
     return [className containsString:@"."];
 }
@@ -505,26 +811,53 @@ static const NSString * const kPassed = @"passed";
 }
 
 - (void)onTestAbortedWithName:(NSString *)testName inClass:(NSString *)testClass errorMessage:(NSString *)message {
-    BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testClass andName:testName];
-    if (testCaseLogEntry) {
-        if (!testCaseLogEntry.errorMessage || ![testCaseLogEntry.errorMessage length]) {
-            testCaseLogEntry.errorMessage = message;
+    @synchronized (self) {
+        BPTestCaseLogEntry *testCaseLogEntry = [self.current testCaseWithClass:testClass andName:testName];
+        if (testCaseLogEntry) {
+            if (!testCaseLogEntry.errorMessage || ![testCaseLogEntry.errorMessage length]) {
+                testCaseLogEntry.errorMessage = message;
+            }
+            testCaseLogEntry.passed = NO;
+            testCaseLogEntry.failure = YES;
+            [self journalTestCase:testCaseLogEntry];
+        }
+        [self attachPendingOutput];
+        self.aborted = YES;
+    }
+}
+
+// Output of a test whose start never got reported, most likely because it crashed, is kept with the suite.
+- (void)attachPendingOutput {
+    BPLogEntry *logEntry = self.current ?: self.root;
+    for (NSString *testKey in [[self.pendingOutput allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        for (NSString *line in self.pendingOutput[testKey]) {
+            [logEntry appendLogLine:line];
         }
-        testCaseLogEntry.passed = NO;
-        testCaseLogEntry.failure = YES;
     }
-    self.aborted = YES;
+    [self.pendingOutput removeAllObjects];
 }
 
 - (void)completed {
+    @synchronized (self) {
+        [self attachPendingOutput];
+    }
     if (self.aborted) {
         [self closeOffAllSuites];
     }
     [self calculateTotals];
+    [self.log flush];
 }
 
 - (void)cleanup {
-    [[BPTreeAssembler sharedInstance] reset];
+    [self.assembler reset];
+    @synchronized (self) {
+        self.outputTestKey = nil;
+        [self.outputTestRuns removeAllObjects];
+        [self.structuredTestRuns removeAllObjects];
+        [self.structuredTestCases removeAllObjects];
+        [self.pendingOutput removeAllObjects];
+        [self.skippedTests removeAllObjects];
+    }
 }
 
 - (void)calculateTotals {
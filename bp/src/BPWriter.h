@@ -19,6 +19,12 @@ typedef NS_ENUM(NSInteger, BPWriterDestination) {
 
 @interface BPWriter : NSObject
 
+/*!
+ * @discussion when YES, file writes are performed on a background queue so callers never block on disk.
+ * Defaults to NO. Call flush or close to wait for pending writes.
+ */
+@property (nonatomic, assign) BOOL asynchronous;
+
 - (nonnull instancetype)initWithDestination:(BPWriterDestination)destination;
 - (nonnull instancetype)initWithDestination:(BPWriterDestination)destination andPath:(nullable NSString *)filePath;
 
@@ -37,4 +43,20 @@ typedef NS_ENUM(NSInteger, BPWriterDestination) {
  */
 - (void)removeFile;
 
+/*!
+ * @discussion write any buffered output to the destination
+ */
+- (void)flush;
+
+/*!
+ * @discussion flush buffered output and close the file. A later write reopens it for append.
+ */
+- (void)close;
+
+/*!
+ * @discussion flush every writer that has a file open. Call it on the way out of the process, since
+ * buffered output that is still pending is lost when the process exits.
+ */
++ (void)flushAllWriters;
+
 @end
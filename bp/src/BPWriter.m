@@ -9,11 +9,36 @@
 
 #import "BPWriter.h"
 
+// Size of the user-space buffer for file destinations. Output is flushed when it fills up,
+// when it has been sitting for kFlushInterval, on flush/close/dealloc, and by flushAllWriters.
+static const size_t kFileBufferSize = 64 * 1024;
+static const NSTimeInterval kFlushInterval = 1.0;
+
+// Set on each writer's queue to the writer, to tell whether we're already on it
+static const void *const kWriterQueueKey = &kWriterQueueKey;
+
+// Writers with an open file, so that the exit path can flush the ones nobody closed
+static NSHashTable<BPWriter *> *openWriters(void) {
+    static NSHashTable *writers;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        writers = [NSHashTable weakObjectsHashTable];
+    });
+    return writers;
+}
+
 @interface BPWriter ()
 
 @property (nonatomic, assign) BPWriterDestination destination;
 @property (nonatomic, strong) NSString *filePath;
 
+// All file state below is only touched on `queue`
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t flushTimer;
+@property (nonatomic, assign) FILE *filePointer;
+@property (nonatomic, assign) char *fileBuffer;
+@property (nonatomic, assign) BOOL dirty;
+
 @end
 
 @implementation BPWriter
@@ -31,13 +56,35 @@
         }
         self.destination = destination;
         self.filePath = filePath;
+        if (destination == BPWriterDestinationFile) {
+            self.queue = dispatch_queue_create("com.linkedin.bluepill.writer", DISPATCH_QUEUE_SERIAL);
+            dispatch_queue_set_specific(self.queue, kWriterQueueKey, (__bridge void *)self, NULL);
+        }
     }
     return self;
 }
 
+- (void)dealloc {
+    if (!self.queue) {
+        return;
+    }
+    // The last reference can go away on the queue itself, when the flush timer or a pending
+    // asynchronous write is done with the writer.
+    if (dispatch_get_specific(kWriterQueueKey) == (__bridge void *)self) {
+        [self closeFile];
+    } else {
+        // Don't retain a writer that is going away
+        __unsafe_unretained typeof(self) unretainedSelf = self;
+        dispatch_sync(self.queue, ^{
+            [unretainedSelf closeFile];
+        });
+    }
+}
+
 - (void)removeFile {
     switch (self.destination) {
         case BPWriterDestinationFile: {
+            [self close];
             NSError *error = nil;
             if ([[NSFileManager defaultManager] fileExistsAtPath:self.filePath]) {
                 [[NSFileManager defaultManager] removeItemAtPath:self.filePath error:&error];
@@ -66,12 +113,14 @@
             fprintf(stderr, "%s\n", [str UTF8String]);
             break;
         case BPWriterDestinationFile: {
-            FILE *filePointer = fopen([self.filePath UTF8String], "a+");
-            if (filePointer) {
-                fprintf(filePointer, "%s\n", [str UTF8String]);
-                fclose(filePointer);
+            // Retain self until the line is out, so pending asynchronous writes are never dropped
+            void (^write)(void) = ^{
+                [self appendToFile:str];
+            };
+            if (self.asynchronous) {
+                dispatch_async(self.queue, write);
             } else {
-                fprintf(stderr, "Could not open file %s for append!", [self.filePath UTF8String]);
+                dispatch_sync(self.queue, write);
             }
             break;
         }
@@ -87,4 +136,99 @@
     fprintf(stderr, "%s\n", [str UTF8String]);
 }
 
+- (void)flush {
+    if (self.destination != BPWriterDestinationFile) {
+        fflush(self.destination == BPWriterDestinationStdout ? stdout : stderr);
+        return;
+    }
+    dispatch_sync(self.queue, ^{
+        [self flushFile];
+    });
+}
+
++ (void)flushAllWriters {
+    NSArray<BPWriter *> *writers;
+    @synchronized (openWriters()) {
+        writers = [openWriters() allObjects];
+    }
+    for (BPWriter *writer in writers) {
+        [writer flush];
+    }
+}
+
+- (void)close {
+    if (self.destination != BPWriterDestinationFile) {
+        [self flush];
+        return;
+    }
+    dispatch_sync(self.queue, ^{
+        [self closeFile];
+    });
+}
+
+#pragma mark - File handling (on queue)
+
+- (void)appendToFile:(NSString *)str {
+    if (!self.filePointer && ![self openFile]) {
+        return;
+    }
+    fprintf(self.filePointer, "%s\n", [str UTF8String]);
+    self.dirty = YES;
+}
+
+- (BOOL)openFile {
+    self.filePointer = fopen([self.filePath UTF8String], "a");
+    if (!self.filePointer) {
+        fprintf(stderr, "Could not open file %s for append!\n", [self.filePath UTF8String]);
+        return NO;
+    }
+    self.fileBuffer = malloc(kFileBufferSize);
+    if (self.fileBuffer) {
+        setvbuf(self.filePointer, self.fileBuffer, _IOFBF, kFileBufferSize);
+    }
+
+    // Make sure buffered output doesn't sit around for long when the output is slow
+    self.flushTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(self.flushTimer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kFlushInterval * NSEC_PER_SEC)),
+                              (uint64_t)(kFlushInterval * NSEC_PER_SEC),
+                              (uint64_t)(kFlushInterval * NSEC_PER_SEC / 10));
+    __weak typeof(self) __self = self;
+    dispatch_source_set_event_handler(self.flushTimer, ^{
+        [__self flushFile];
+    });
+    dispatch_resume(self.flushTimer);
+    @synchronized (openWriters()) {
+        [openWriters() addObject:self];
+    }
+    return YES;
+}
+
+- (void)flushFile {
+    if (self.filePointer && self.dirty) {
+        fflush(self.filePointer);
+        self.dirty = NO;
+    }
+}
+
+- (void)closeFile {
+    // Stop the periodic flush first, it must not touch the stream once it's closed
+    if (self.flushTimer) {
+        dispatch_source_cancel(self.flushTimer);
+        self.flushTimer = nil;
+    }
+    if (self.filePointer) {
+        fclose(self.filePointer);
+        self.filePointer = NULL;
+        self.dirty = NO;
+        @synchronized (openWriters()) {
+            [openWriters() removeObject:self];
+        }
+    }
+    if (self.fileBuffer) {
+        free(self.fileBuffer);
+        self.fileBuffer = NULL;
+    }
+}
+
 @end
@@ -9,15 +9,14 @@
 
 #import "BPXCTestFile.h"
 #import "BPConstants.h"
+#import "BPMachOSymbols.h"
 #import "BPTestClass.h"
+#import "BPTestInventoryCache.h"
 #import "BPUtils.h"
 #import "SimulatorHelper.h"
 
 @implementation BPXCTestFile
 
-NSString *swiftNmCmdline = @"nm -gU '%@' | cut -d' ' -f3 | xargs -s 131072 xcrun swift-demangle | cut -d' ' -f3 | grep -e '[\\.|_]'test";
-NSString *objcNmCmdline = @"nm -U '%@' | grep ' t ' | cut -d' ' -f3,4 | cut -d'-' -f2 | cut -d'[' -f2 | cut -d']' -f1 | grep ' test'";
-
 + (instancetype)BPXCTestFileFromXCTestBundle:(NSString *)testBundlePath
                             andHostAppBundle:(NSString *)testHostPath
                                    withError:(NSError *__autoreleasing *)errPtr {
@@ -45,47 +44,50 @@ NSString *objcNmCmdline = @"nm -U '%@' | grep ' t ' | cut -d' ' -f3,4 | cut -d'-
     xcTestFile.UITargetAppPath = UITargetAppPath;
     xcTestFile.testBundlePath = [path stringByDeletingLastPathComponent];
 
-    NSString *cmd = [NSString stringWithFormat:swiftNmCmdline, path];
-    NSString *output = [BPUtils runShell:cmd];
-    NSArray<NSString *>* testsArray = [output componentsSeparatedByString:@"\n"];
+    BPTestInventoryCache *cache = [BPTestInventoryCache sharedCache];
+    NSString *cacheKey = [cache keyForBinary:path];
+    NSArray<BPTestClass *> *cachedClasses = cacheKey ? [cache testClassesForKey:cacheKey] : nil;
+    if (cachedClasses) {
+        xcTestFile.testClasses = cachedClasses;
+        return xcTestFile;
+    }
+
+    NSArray<NSArray<NSString *> *> *swiftTests = nil;
+    NSArray<NSArray<NSString *> *> *objcTests = nil;
+    NSError *error;
+    if (![BPMachOSymbols readTestsFromBinary:path swiftTests:&swiftTests objcTests:&objcTests withError:&error]) {
+        [BPUtils printInfo:ERROR withString:@"Could not list tests in %@: %@", path, [error localizedDescription]];
+        cacheKey = nil;
+    }
     NSMutableDictionary *testClassesDict = [[NSMutableDictionary alloc] init];
     NSMutableArray *allClasses = [[NSMutableArray alloc] init];
 
-    for (NSString *testName in testsArray) {
-        NSArray *parts = [testName componentsSeparatedByString:@"."];
-        if (parts.count != 3) {
-            continue;
-        }
-        BPTestClass *testClass = testClassesDict[parts[1]];
+    for (NSArray<NSString *> *test in swiftTests) {
+        BPTestClass *testClass = testClassesDict[test[0]];
         if (!testClass) {
-            testClass = [[BPTestClass alloc] initWithName:parts[1]];
-            testClassesDict[parts[1]] = testClass;
+            testClass = [[BPTestClass alloc] initWithName:test[0]];
+            testClassesDict[test[0]] = testClass;
             [allClasses addObject:testClass];
         }
-        if (![parts[2] containsString:@"DISABLE"]) {
-            NSString *trimmedTestName = [BPUtils removeSwiftArgumentsFromTestName:parts[2]];
-            [testClass addTestCase:[[BPTestCase alloc] initWithName:trimmedTestName]];
+        if (![test[1] containsString:@"DISABLE"]) {
+            [testClass addTestCase:[[BPTestCase alloc] initWithName:test[1]]];
         }
     }
 
-    cmd = [NSString stringWithFormat:objcNmCmdline, path];
-    output = [BPUtils runShell:cmd];
-    testsArray = [output componentsSeparatedByString:@"\n"];
-    for (NSString *line in testsArray) {
-        NSArray *parts = [line componentsSeparatedByString:@" "];
-        if (parts.count != 2) {
-            continue;
-        }
-        BPTestClass *testClass = testClassesDict[parts[0]];
+    for (NSArray<NSString *> *test in objcTests) {
+        BPTestClass *testClass = testClassesDict[test[0]];
         if (!testClass) {
-            testClass = [[BPTestClass alloc] initWithName:parts[0]];
-            testClassesDict[parts[0]] = testClass;
+            testClass = [[BPTestClass alloc] initWithName:test[0]];
+            testClassesDict[test[0]] = testClass;
             [allClasses addObject:testClass];
         }
-        [testClass addTestCase:[[BPTestCase alloc] initWithName:parts[1]]];
+        [testClass addTestCase:[[BPTestCase alloc] initWithName:test[1]]];
     }
 
     xcTestFile.testClasses = [NSArray arrayWithArray:allClasses];
+    if (cacheKey) {
+        [cache storeTestClasses:xcTestFile.testClasses forKey:cacheKey];
+    }
     return xcTestFile;
 }
 
@@ -12,11 +12,15 @@
 
 @class BPConfiguration;
 @class BPSimulator;
+@class BPStats;
 
 @interface Bluepill : NSObject
 
 @property (nonatomic, readonly) NSString *test_simulatorUDID;
 @property (nonatomic, readonly) BPSimulator *test_simulator;
+// Where the timers and counters of every execution context go. Defaults to the shared stats;
+// give each instance its own to run several of them in the same process.
+@property (nonatomic, strong) BPStats *stats;
 
 /*!
  * @discussion bp instance
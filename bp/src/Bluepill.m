@@ -11,6 +11,7 @@
 #import "BPConfiguration.h"
 #import "BPSimulator.h"
 #import "BPTreeParser.h"
+#import "BPTreeAssembler.h"
 #import "BPReporters.h"
 #import "BPWriter.h"
 #import "BPStats.h"
@@ -18,6 +19,7 @@
 #import "BPWaitTimer.h"
 #import "BPExecutionContext.h"
 #import "BPHandler.h"
+#import "BPJUnitJournal.h"
 #import <libproc.h>
 #import "BPTMDControlConnection.h"
 #import "BPTMDRunnerConnection.h"
@@ -40,8 +42,6 @@ static void onInterrupt(int ignore) {
     interrupted = 1;
 }
 
-static int checkDisconnectDelay = 0;
-
 @interface Bluepill()<BPTestBundleConnectionDelegate>
 
 @property (nonatomic, strong) BPConfiguration *config;
@@ -62,6 +62,7 @@ static int checkDisconnectDelay = 0;
 - (instancetype)initWithConfiguration:(BPConfiguration *)config {
     if (self = [super init]) {
         self.config = config;
+        self.stats = [BPStats sharedStats];
         unsigned int numProps = 0;
         objc_property_t *props = class_copyPropertyList([config class], &numProps);
         for (NSUInteger i = 0; i < numProps; ++i) {
@@ -79,8 +80,11 @@ static int checkDisconnectDelay = 0;
  @return The exit status of the last execution of tests
  */
 - (BPExitStatus)run {
-    // Set up our SIGINT handler
+    // Set up our SIGINT handler. SIGTERM and SIGHUP get the same cleanup, so buffered output
+    // makes it out through the normal exit path.
     signal(SIGINT, onInterrupt);
+    signal(SIGTERM, onInterrupt);
+    signal(SIGHUP, onInterrupt);
     // Because failed tests are stored in the config so that they are not rerun,
     // We need to copy this here and any time we retry due to a test failure (not crash)
     self.executionConfigCopy = [self.config copy];
@@ -100,6 +104,25 @@ static int checkDisconnectDelay = 0;
         CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.01, NO);
     }
 
+    if (self.config.simulatorHandoffFile && self.config.reuseSimUDID && interrupted) {
+        // Nobody is going to pick the simulator up, don't leave it behind.
+        [BPUtils printInfo:WARNING withString:@"Deleting simulator %@ instead of handing it over.", self.config.reuseSimUDID];
+        __block BOOL deleted = NO;
+        [self deleteSimulatorWithContext:self.context completion:^{
+            deleted = YES;
+        }];
+        while (!deleted) {
+            CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.01, NO);
+        }
+    } else if (self.config.simulatorHandoffFile && self.config.reuseSimUDID) {
+        NSError *error;
+        if (![self.config.reuseSimUDID writeToFile:self.config.simulatorHandoffFile atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+            [BPUtils printInfo:ERROR withString:@"Could not hand over simulator %@: %@", self.config.reuseSimUDID, [error localizedDescription]];
+        } else {
+            [BPUtils printInfo:INFO withString:@"Keeping simulator %@ for the next bundle.", self.config.reuseSimUDID];
+        }
+    }
+
     // Tests completed or interruption received, show some quick stats as we exit
     [BPUtils printInfo:INFO withString:@"Number of Executions: %lu", self.retries + 1];
     [BPUtils printInfo:INFO withString:@"Final Exit Status: %@", [BPExitStatusHelper stringFromExitStatus:self.finalExitStatus]];
@@ -162,6 +185,9 @@ static int checkDisconnectDelay = 0;
 //  - BPExitStatusUninstallAppFailed
 //  - BPExitStatusLaunchAppFailed
 - (void)recover {
+    // The tree is dropped without a report, keep what finished
+    [self writeReportFromJournalWithContext:self.context];
+
     // If error retry reach to the max, then return
     if (![self canRetryOnError]) {
         self.finalExitStatus |= self.context.finalExitStatus;
@@ -192,6 +218,7 @@ static int checkDisconnectDelay = 0;
 // Proceed to next test case
 - (void)proceed {
     if (![self canRetryOnError]) {
+        [self writeReportFromJournalWithContext:self.context];
         self.finalExitStatus |= self.context.finalExitStatus;
         [BPUtils printInfo:ERROR withString:@"No retries left. Giving up."];
         [BPUtils printInfo:INFO withString:@"%s:%d finalExitStatus = %@", __FILE__, __LINE__, [BPExitStatusHelper stringFromExitStatus:self.finalExitStatus]];
@@ -223,6 +250,9 @@ static int checkDisconnectDelay = 0;
     context.config.allTestCases = [[NSArray alloc] initWithArray: xctTestFile.allTestCases];
 
     context.attemptNumber = self.retries + 1;
+    context.executedTests = [[NSMutableSet alloc] init];
+    context.stats = self.stats;
+    context.assembler = [[BPTreeAssembler alloc] initWithStats:context.stats];
     self.context = context; // Store the context on self so that it's accessible to the interrupt handler in the loop
 }
 
@@ -230,7 +260,7 @@ static int checkDisconnectDelay = 0;
     // Creates all of the objects we'll need for running the tests. Sets up logging, etc.
 
     [BPUtils printInfo:INFO withString:@"Running Tests. Attempt Number %lu.", context.attemptNumber];
-    [BPStats sharedStats].attemptNumber = context.attemptNumber;
+    context.stats.attemptNumber = context.attemptNumber;
 
     NSString *simulatorLogPath;
     if (context.config.outputDirectory) {
@@ -247,11 +277,24 @@ static int checkDisconnectDelay = 0;
 
     // This is the raw output from the simulator running tests
     BPWriter *simulatorWriter = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:simulatorLogPath];
-    context.parser = [[BPTreeParser alloc] initWithWriter:simulatorWriter];
+    // Every line of simulator output goes through here, don't make the parser wait on disk
+    simulatorWriter.asynchronous = YES;
+    context.parser = [[BPTreeParser alloc] initWithWriter:simulatorWriter assembler:context.assembler];
+    context.parser.maxLogSize = [context.config.maxTestOutputSize unsignedIntegerValue] * 1024;
+    context.parser.maxSuiteLogSize = [context.config.maxSuiteOutputSize unsignedIntegerValue] * 1024;
+    context.parser.logSpillDirectory = context.config.outputDirectory;
 
     if (context.attemptNumber == 1) {
         [context.parser cleanup];
     }
+    if (context.config.outputDirectory && !context.parser.journal) {
+        NSError *err;
+        context.parser.journal = [BPJUnitJournal journalAtPath:[self reportPathWithContext:context extension:@"journal"]
+                                                     withError:&err];
+        if (!context.parser.journal) {
+            [BPUtils printInfo:ERROR withString:@"Not journaling test results: %@", [err localizedDescription]];
+        }
+    }
 
     context.runner = [self createSimulatorRunnerWithContext:context];
 
@@ -261,6 +304,8 @@ static int checkDisconnectDelay = 0;
     
     if (context.config.deleteSimUDID) {
         NEXT([self deleteSimulatorOnlyTaskWithContext:context]);
+    } else if (context.config.reuseSimUDID) {
+        NEXT([self reuseSimulatorWithContext:context]);
     } else {
         NEXT([self createSimulatorWithContext:context]);
     }
@@ -281,7 +326,7 @@ static int checkDisconnectDelay = 0;
     NSString *deviceName = [NSString stringWithFormat:@"BP%d-%lu-%lu", getpid(), context.attemptNumber, self.maxCreateTries];
 
     __weak typeof(self) __self = self;
-    [[BPStats sharedStats] startTimer:stepName];
+    [context.stats startTimer:stepName];
     [BPUtils printInfo:INFO withString:@"%@", stepName];
 
     BPWaitTimer *timer = [BPWaitTimer timerWithInterval:[self.config.createTimeout doubleValue]];
@@ -291,13 +336,13 @@ static int checkDisconnectDelay = 0;
     __weak typeof(handler) __handler = handler;
 
     handler.beginWith = ^{
-        [[BPStats sharedStats] endTimer:stepName withResult:__handler.error ? @"ERROR" : @"INFO"];
+        [context.stats endTimer:stepName withResult:__handler.error ? @"ERROR" : @"INFO"];
         [BPUtils printInfo:(__handler.error ? ERROR : INFO)
                 withString:@"Completed: %@ %@", stepName, context.runner.UDID];
     };
 
     handler.onSuccess = ^{
-        [[BPStats sharedStats] startTimer:SIMULATOR_LIFETIME(context.runner.UDID) atTime:simStart];
+        [context.stats startTimer:SIMULATOR_LIFETIME(context.runner.UDID) atTime:simStart];
         if (self.config.scriptFilePath) {
             [context.runner runScriptFile:self.config.scriptFilePath];
         }
@@ -311,8 +356,8 @@ static int checkDisconnectDelay = 0;
     };
 
     handler.onError = ^(NSError *error) {
-        [[BPStats sharedStats] startTimer:SIMULATOR_LIFETIME(context.runner.UDID) atTime:simStart];
-        [[BPStats sharedStats] addSimulatorCreateFailure];
+        [context.stats startTimer:SIMULATOR_LIFETIME(context.runner.UDID) atTime:simStart];
+        [context.stats addSimulatorCreateFailure];
         [BPUtils printInfo:ERROR withString:@"%@", [error localizedDescription]];
         // If we failed to create the simulator, there's no reason for us to try to delete it, which can just cause more issues
         if (--__self.maxCreateTries > 0) {
@@ -327,8 +372,8 @@ static int checkDisconnectDelay = 0;
     };
 
     handler.onTimeout = ^{
-        [[BPStats sharedStats] addSimulatorCreateFailure];
-        [[BPStats sharedStats] endTimer:stepName withResult:@"TIMEOUT"];
+        [context.stats addSimulatorCreateFailure];
+        [context.stats endTimer:stepName withResult:@"TIMEOUT"];
         [BPUtils printInfo:ERROR withString:@"Timeout: %@", stepName];
     };
 
@@ -339,20 +384,54 @@ static int checkDisconnectDelay = 0;
     }
 }
 
+- (void)reuseSimulatorWithContext:(BPExecutionContext *)context {
+    NSString *deviceUDID = context.config.reuseSimUDID;
+    // A simulator is handed over once; if this attempt doesn't keep it, the next one starts from scratch.
+    self.config.reuseSimUDID = nil;
+    context.config.reuseSimUDID = nil;
+
+    NSString *stepName = REUSE_SIMULATOR(context.attemptNumber);
+    NSDate *simStart = [NSDate date];
+    [context.stats startTimer:stepName];
+    [BPUtils printInfo:INFO withString:@"%@ %@", stepName, deviceUDID];
+    NSUUID *uuid = [[NSUUID alloc] initWithUUIDString:deviceUDID];
+    BOOL success = uuid && [context.runner useSimulatorWithDeviceUDID:uuid];
+    [context.stats endTimer:stepName withResult:success ? @"INFO" : @"ERROR"];
+    [context.stats startTimer:SIMULATOR_LIFETIME(context.runner.UDID) atTime:simStart];
+
+    __weak typeof(self) __self = self;
+    if (!success) {
+        // Don't let a bad simulator fail the tests, evict it and create a new one instead.
+        [BPUtils printInfo:WARNING withString:@"Simulator %@ can't be reused, deleting it.", deviceUDID];
+        [self deleteSimulatorWithContext:context completion:^{
+            context.runner = [__self createSimulatorRunnerWithContext:context];
+            NEXT([__self createSimulatorWithContext:context]);
+        }];
+        return;
+    }
+    // The app was uninstalled before the simulator was handed over, make sure nothing is left over
+    // from the previous tests all the same.
+    if ([context.runner isApplicationInstalled]) {
+        NEXT([self uninstallApplicationWithContext:context]);
+    } else {
+        NEXT([self installApplicationWithContext:context]);
+    }
+}
+
 - (void)installApplicationWithContext:(BPExecutionContext *)context {
     NSString *stepName = INSTALL_APPLICATION(context.attemptNumber);
-    [[BPStats sharedStats] startTimer:stepName];
+    [context.stats startTimer:stepName];
     [BPUtils printInfo:INFO withString:@"%@", stepName];
 
     NSError *error = nil;
     BOOL success = [context.runner installApplicationWithError:&error];
 
     __weak typeof(self) __self = self;
-    [[BPStats sharedStats] endTimer:stepName withResult:success? @"INFO": @"ERROR"];
+    [context.stats endTimer:stepName withResult:success? @"INFO": @"ERROR"];
     [BPUtils printInfo:(success ? INFO : ERROR) withString:@"Completed: %@", stepName];
 
     if (!success) {
-        [[BPStats sharedStats] addSimulatorInstallFailure];
+        [context.stats addSimulatorInstallFailure];
         [BPUtils printInfo:ERROR withString:@"Could not install app in simulator: %@", [error localizedDescription]];
         if (--__self.maxInstallTries > 0) {
             if ([[error description] containsString:@"Booting"]) {
@@ -378,17 +457,17 @@ static int checkDisconnectDelay = 0;
 
 - (void)uninstallApplicationWithContext:(BPExecutionContext *)context {
     NSString *stepName = UNINSTALL_APPLICATION(context.attemptNumber);
-    [[BPStats sharedStats] startTimer:stepName];
+    [context.stats startTimer:stepName];
     [BPUtils printInfo:INFO withString:@"%@", stepName];
 
     NSError *error = nil;
     BOOL success = [context.runner uninstallApplicationWithError:&error];
 
-    [[BPStats sharedStats] endTimer:stepName withResult:success ? @"INFO" : @"ERROR"];
+    [context.stats endTimer:stepName withResult:success ? @"INFO" : @"ERROR"];
     [BPUtils printInfo:(success ? INFO : ERROR) withString:@"Completed: %@", stepName];
 
     if (!success) {
-        [[BPStats sharedStats] addSimulatorInstallFailure];
+        [context.stats addSimulatorInstallFailure];
         [BPUtils printInfo:ERROR withString:@"Could not uninstall app in simulator: %@", [error localizedDescription]];
         NEXT([self deleteSimulatorWithContext:context andStatus:BPExitStatusUninstallAppFailed]);
     } else {
@@ -400,7 +479,7 @@ static int checkDisconnectDelay = 0;
     NSString *stepName = LAUNCH_APPLICATION(context.attemptNumber);
     [BPUtils printInfo:INFO withString:@"%@", stepName];
 
-    [[BPStats sharedStats] startTimer:LAUNCH_APPLICATION(context.attemptNumber)];
+    [context.stats startTimer:LAUNCH_APPLICATION(context.attemptNumber)];
 
     __weak typeof(self) __self = self;
 
@@ -420,17 +499,22 @@ static int checkDisconnectDelay = 0;
     };
 
     handler.onError = ^(NSError *error) {
-        [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"ERROR"];
+        [context.stats endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"ERROR"];
         [BPUtils printInfo:ERROR withString:@"Could not launch app and tests: %@", [error localizedDescription]];
         NEXT([__self deleteSimulatorWithContext:context andStatus:BPExitStatusLaunchAppFailed]);
     };
 
     handler.onTimeout = ^{
-        [[BPStats sharedStats] addSimulatorLaunchFailure];
-        [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"TIMEOUT"];
+        [context.stats addSimulatorLaunchFailure];
+        [context.stats endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"TIMEOUT"];
         [BPUtils printInfo:FAILED withString:@"Timeout: %@", stepName];
     };
 
+    if (!context.runner.monitor) {
+        context.runner.monitor = [[SimulatorMonitor alloc] initWithConfiguration:context.config];
+    }
+    context.runner.monitor.executedTests = context.executedTests;
+    context.runner.monitor.stats = context.stats;
     [context.runner launchApplicationAndExecuteTestsWithParser:context.parser andCompletion:handler.defaultHandlerBlock];
 }
 
@@ -449,7 +533,7 @@ static int checkDisconnectDelay = 0;
     
     [runnerConnection startTestPlan];
 
-    checkDisconnectDelay = [self.config.testBundleDisconnectTimeout intValue];
+    context.disconnectDelay = [self.config.testBundleDisconnectTimeout integerValue];
     NEXT([self checkProcessWithContext:context conenction:runnerConnection]);
 
 }
@@ -457,15 +541,15 @@ static int checkDisconnectDelay = 0;
     BOOL isRunning = [self isProcessRunningWithContext:context];
     if (!isRunning && [context.runner isFinished]) {
         [BPUtils printInfo:INFO withString:@"Finished"];
-        [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:[BPExitStatusHelper stringFromExitStatus:context.exitStatus]];
+        [context.stats endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:[BPExitStatusHelper stringFromExitStatus:context.exitStatus]];
         [self runnerCompletedWithContext:context];
         return;
     }
     if (![context.runner isSimulatorRunning]) {
-        [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"SIMULATOR CRASHED"];
+        [context.stats endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"SIMULATOR CRASHED"];
         [BPUtils printInfo:ERROR withString:@"SIMULATOR CRASHED!!!"];
         context.simulatorCrashed = YES;
-        [[BPStats sharedStats] addSimulatorCrash];
+        [context.stats addSimulatorCrash];
         [self deleteSimulatorWithContext:context andStatus:BPExitStatusSimulatorCrashed];
         return;
     }
@@ -477,17 +561,17 @@ static int checkDisconnectDelay = 0;
     // However, we have a short-circuit for tests because those may not actually run any app
     if (!isRunning && context.pid > 0 && [context.runner isApplicationLaunched] && !self.config.testing_NoAppWillRun) {
         // The tests ended before they even got started or the process is gone for some other reason
-        [[BPStats sharedStats] endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"APP CRASHED"];
+        [context.stats endTimer:LAUNCH_APPLICATION(context.attemptNumber) withResult:@"APP CRASHED"];
         [BPUtils printInfo:ERROR withString:@"Application crashed!"];
-        [[BPStats sharedStats] addApplicationCrash];
+        [context.stats addApplicationCrash];
         [self deleteSimulatorWithContext:context andStatus:BPExitStatusAppCrashed];
         return;
     }
 
     if (connection.disconnected) {
         // break early if possible
-        if (checkDisconnectDelay > 0) {
-            checkDisconnectDelay --;
+        if (context.disconnectDelay > 0) {
+            context.disconnectDelay --;
         } else {
             [BPUtils printInfo:INFO withString:@"Connection disconnected, deleteing simulator"];
             [self deleteSimulatorWithContext:context andStatus:BPExitStatusLaunchAppFailed];
@@ -510,23 +594,29 @@ static int checkDisconnectDelay = 0;
     [context.parser completed];
 
     if (context.simulatorCrashed == NO && context.config.outputDirectory) {
-        NSString *fileName = [NSString stringWithFormat:@"TEST-%@-%lu-results.xml",
-                              [[context.config.testBundlePath lastPathComponent] stringByDeletingPathExtension],
-                              (long)context.attemptNumber];
-        NSString *outputFile = [context.config.outputDirectory stringByAppendingPathComponent:fileName];
+        NSString *outputFile = [self reportPathWithContext:context extension:@"xml"];
 
         [BPUtils printInfo:INFO withString:@"Writing JUnit report to: %@", outputFile];
         BPWriter *junitLog = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:outputFile];
         [junitLog writeLine:@"%@", [context.parser generateLog:[[JUnitReporter alloc] init]]];
+        [junitLog close];
         [context.parser cleanup];
     }
 
     if (context.simulatorCrashed) {
         // If we crashed, we need to retry
         [self deleteSimulatorWithContext:context andStatus:BPExitStatusSimulatorCrashed];
-    } else if (self.config.keepSimulator
-               && (context.runner.exitStatus == BPExitStatusAllTestsPassed
-                || context.runner.exitStatus == BPExitStatusTestsFailed)) {
+    } else if (self.config.keepSimulator && context.runner.exitStatus == BPExitStatusAllTestsPassed
+               && [self uninstallApplicationForHandoffWithContext:context]) {
+      context.exitStatus = [context.runner exitStatus];
+      // The last attempt hands the simulator over through simulatorHandoffFile.
+      self.config.reuseSimUDID = context.runner.UDID;
+      context.config.reuseSimUDID = context.runner.UDID;
+      NEXT([self finishWithContext:context]);
+    } else if (self.config.keepSimulator && context.runner.exitStatus == BPExitStatusTestsFailed
+               && !self.config.simulatorHandoffFile) {
+      // Kept for looking into the failures. A simulator that failed tests is never handed to another bundle
+      // since whatever broke them may still be around, so with a handoff file it's deleted below instead.
       context.exitStatus = [context.runner exitStatus];
       NEXT([self finishWithContext:context]);
     } else {
@@ -540,6 +630,54 @@ static int checkDisconnectDelay = 0;
     }
 }
 
+// A simulator is only handed over through simulatorHandoffFile once the app is uninstalled, so that the
+// next bundle doesn't get a simulator it can't clean up. If the uninstall fails, it's deleted instead.
+- (BOOL)uninstallApplicationForHandoffWithContext:(BPExecutionContext *)context {
+    if (!self.config.simulatorHandoffFile) {
+        return YES;
+    }
+    NSString *stepName = UNINSTALL_APPLICATION(context.attemptNumber);
+    [context.stats startTimer:stepName];
+    [BPUtils printInfo:INFO withString:@"%@", stepName];
+
+    NSError *error = nil;
+    BOOL success = [context.runner uninstallApplicationWithError:&error];
+
+    [context.stats endTimer:stepName withResult:success ? @"INFO" : @"ERROR"];
+    [BPUtils printInfo:(success ? INFO : ERROR) withString:@"Completed: %@", stepName];
+    if (!success) {
+        [BPUtils printInfo:WARNING withString:@"Could not uninstall app before handing over simulator %@, deleting it: %@",
+         context.runner.UDID, [error localizedDescription]];
+    }
+    return success;
+}
+
+- (NSString *)reportPathWithContext:(BPExecutionContext *)context extension:(NSString *)extension {
+    NSString *fileName = [NSString stringWithFormat:@"TEST-%@-%lu-results.%@",
+                          [[context.config.testBundlePath lastPathComponent] stringByDeletingPathExtension],
+                          (long)context.attemptNumber, extension];
+    return [context.config.outputDirectory stringByAppendingPathComponent:fileName];
+}
+
+// When the tree is given up before its report was written, e.g. after a simulator crash, the
+// results that were journaled are reported instead. The report is named after the journal.
+- (void)writeReportFromJournalWithContext:(BPExecutionContext *)context {
+    BPJUnitJournal *journal = context.parser.journal;
+    if (!journal) {
+        return;
+    }
+    NSString *outputFile = [[journal.path stringByDeletingPathExtension] stringByAppendingPathExtension:@"xml"];
+    NSError *error;
+    if ([BPJUnitJournal writeReportFromJournalAtPath:journal.path toFile:outputFile withError:&error]) {
+        [BPUtils printInfo:INFO withString:@"Wrote JUnit report from the journal to: %@", outputFile];
+    } else {
+        // Nothing was journaled if the tests never started
+        [BPUtils printInfo:DEBUGINFO withString:@"No JUnit report from the journal: %@", [error localizedDescription]];
+    }
+    [journal discard];
+    context.parser.journal = nil;
+}
+
 - (void)deleteSimulatorWithContext:(BPExecutionContext *)context andStatus:(BPExitStatus)status {
     context.exitStatus = status;
     __weak typeof(self) __self = self;
@@ -552,7 +690,7 @@ static int checkDisconnectDelay = 0;
 - (void)deleteSimulatorWithContext:(BPExecutionContext *)context completion:(void (^)(void))completion {
     NSString *simUDID = context.runner.UDID;
     NSString *stepName = DELETE_SIMULATOR(context.attemptNumber);
-    [[BPStats sharedStats] startTimer:stepName];
+    [context.stats startTimer:stepName];
     [BPUtils printInfo:INFO withString:@"%@", stepName];
     
     BPWaitTimer *timer = [BPWaitTimer timerWithInterval:[self.config.deleteTimeout doubleValue]];
@@ -562,24 +700,24 @@ static int checkDisconnectDelay = 0;
     __weak typeof(handler) __handler = handler;
 
     handler.beginWith = ^{
-        [[BPStats sharedStats] endTimer:stepName withResult:__handler.error?@"ERROR":@"INFO"];
+        [context.stats endTimer:stepName withResult:__handler.error?@"ERROR":@"INFO"];
         [BPUtils printInfo:(__handler.error ? ERROR : INFO) withString:@"Completed: %@ %@", stepName, context.runner.UDID];
     };
 
     handler.onSuccess = ^{
-        [[BPStats sharedStats] endTimer:SIMULATOR_LIFETIME(simUDID) withResult:@"INFO"];
+        [context.stats endTimer:SIMULATOR_LIFETIME(simUDID) withResult:@"INFO"];
         completion();
     };
 
     handler.onError = ^(NSError *error) {
-        [[BPStats sharedStats] addSimulatorDeleteFailure];
+        [context.stats addSimulatorDeleteFailure];
         [BPUtils printInfo:ERROR withString:@"%@", [error localizedDescription]];
         completion();
     };
 
     handler.onTimeout = ^{
-        [[BPStats sharedStats] addSimulatorDeleteFailure];
-        [[BPStats sharedStats] endTimer:stepName withResult:@"TIMEOUT"];
+        [context.stats addSimulatorDeleteFailure];
+        [context.stats endTimer:stepName withResult:@"TIMEOUT"];
         [BPUtils printInfo:ERROR
                 withString:@"Timeout: %@", stepName];
         completion();
@@ -609,8 +747,23 @@ static int checkDisconnectDelay = 0;
  4. happy all pass -> AllPassed
  5. failure and still fails -> TestFailed
  */
+// If we re-execute, we don't want to run the tests that already ran to completion again
+- (void)updateTestsToSkipWithContext:(BPExecutionContext *)context {
+    NSSet<NSString *> *executedTests;
+    @synchronized (context.executedTests) {
+        executedTests = [context.executedTests copy];
+    }
+    if ([executedTests count] == 0) {
+        return;
+    }
+    NSMutableSet *testsToSkip = [[NSMutableSet alloc] initWithArray:context.config.testCasesToSkip ?: @[]];
+    [testsToSkip unionSet:executedTests];
+    context.config.testCasesToSkip = [testsToSkip allObjects];
+}
+
 - (void)finishWithContext:(BPExecutionContext *)context {
     context.finalExitStatus |= context.exitStatus;
+    [self updateTestsToSkipWithContext:context];
     [BPUtils printInfo:INFO withString:@"Attempt's Exit Status: %@, Bundle exit status: %@",
      [BPExitStatusHelper stringFromExitStatus:context.exitStatus],
      [BPExitStatusHelper stringFromExitStatus:context.finalExitStatus]];
@@ -618,6 +771,7 @@ static int checkDisconnectDelay = 0;
     switch (context.exitStatus) {
         // BP exit handler
         case BPExitStatusInterrupted:
+            [self writeReportFromJournalWithContext:context];
             self.exitLoop = YES;
             return;
 
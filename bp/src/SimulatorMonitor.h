@@ -19,6 +19,7 @@ typedef NS_ENUM(NSInteger, State) {
 
 @class SimDevice;
 @class BPConfiguration;
+@class BPStats;
 
 @interface SimulatorMonitor : NSObject<BPExecutionPhaseProtocol, BPExitStatusProtocol>
 
@@ -29,6 +30,12 @@ typedef NS_ENUM(NSInteger, State) {
 @property (nonatomic, assign) State testsState;
 @property (nonatomic) pid_t appPID;
 
+/*!
+ * @discussion Tests ("class/name") that ran to completion and should be skipped if the tests are re-executed.
+ * Tests are added from the output queue and from the testmanagerd callbacks, synchronize on the set to read it.
+ */
+@property (nonatomic, strong) NSMutableSet<NSString *> *executedTests;
+
 /*!
  * @discussion Sets timeouts for max test runtime
  */
@@ -39,6 +46,11 @@ typedef NS_ENUM(NSInteger, State) {
  */
 @property (nonatomic, assign) NSTimeInterval maxTestExecutionTime;
 
+/*!
+ * @discussion Where the test timers and counters go. Defaults to the shared stats
+ */
+@property (nonatomic, strong) BPStats *stats;
+
 - (instancetype)initWithConfiguration:(BPConfiguration *)config;
 
 @end
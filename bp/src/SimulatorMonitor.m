@@ -7,6 +7,8 @@
 //  distributed under the License is distributed on an "AS IS" BASIS,
 //  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
 
+#import <stdatomic.h>
+
 #import "SimulatorMonitor.h"
 #import "BPConfiguration.h"
 #import "BPStats.h"
@@ -16,38 +18,68 @@
 
 @property (nonatomic, weak) id<BPMonitorCallbackProtocol> callback;
 
-@property (nonatomic, strong) NSDate *lastOutput;
-@property (nonatomic, strong) NSDate *lastTestCaseStartDate;
+@property (atomic, strong) NSDate *lastOutput;
+@property (atomic, strong) NSDate *lastTestCaseStartDate;
 @property (nonatomic, strong) NSString *currentTestName;
 @property (nonatomic, strong) NSString *currentClassName;
 @property (nonatomic, strong) NSString *previousTestName;
 @property (nonatomic, strong) NSString *previousClassName;
 @property (nonatomic, assign) BPExitStatus exitStatus;
-@property (nonatomic, assign) NSUInteger currentOutputId;
+// One-shot timers on the main queue, re-armed instead of queueing a block per line / per test
+@property (nonatomic, strong) dispatch_source_t outputTimer;
+@property (nonatomic, strong) dispatch_source_t testCaseTimer;
 @property (nonatomic, assign) NSUInteger failureCount;
 @property (nonatomic, assign) BOOL testsBegan;
 @property (nonatomic, strong) BPConfiguration *config;
-@property (nonatomic, strong) NSMutableSet *executedTests;
-@property (nonatomic, strong) NSMutableSet *failedTestCases;
+@property (nonatomic, strong) NSMutableSet<NSString *> *failedTestCases;
 
 @end
 
-@implementation SimulatorMonitor
+@implementation SimulatorMonitor {
+    // Set by the thread the output comes in on and cleared by the output timer on the main queue
+    atomic_bool _outputTimerArmed;
+}
 
 - (instancetype)initWithConfiguration:(BPConfiguration *)config {
     self = [super init];
     if (self) {
         self.config = config;
+        self.stats = [BPStats sharedStats];
         self.maxTimeWithNoOutput = [config.stuckTimeout integerValue];
         self.maxTestExecutionTime = [config.testCaseTimeout integerValue];
         self.appState = Idle;
         self.parserState = Idle;
         self.testsState = Idle;
         self.exitStatus = 0;
+
+        __weak typeof(self) __self = self;
+        self.outputTimer = [self createTimerWithHandler:^{
+            [__self onOutputTimerFired];
+        }];
+        self.testCaseTimer = [self createTimerWithHandler:^{
+            [__self onTestCaseTimerFired];
+        }];
     }
     return self;
 }
 
+- (void)dealloc {
+    dispatch_source_cancel(_outputTimer);
+    dispatch_source_cancel(_testCaseTimer);
+}
+
+- (dispatch_source_t)createTimerWithHandler:(dispatch_block_t)handler {
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+    dispatch_source_set_timer(timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    dispatch_source_set_event_handler(timer, handler);
+    dispatch_resume(timer);
+    return timer;
+}
+
+- (void)armTimer:(dispatch_source_t)timer after:(NSTimeInterval)seconds {
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(seconds * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, (uint64_t)(0.1 * NSEC_PER_SEC));
+}
+
 - (void)setMonitorCallback:(id<BPMonitorCallbackProtocol>)callback {
     self.callback = callback;
 }
@@ -55,9 +87,9 @@
 - (void)onAllTestsBegan {
     self.testsState = Running;
     // Don't overwrite the original start time on secondary attempts
-    if ([BPStats sharedStats].cleanRun) {
-        [BPStats sharedStats].cleanRun = NO;
-        [[BPStats sharedStats] startTimer:ALL_TESTS];
+    if (self.stats.cleanRun) {
+        self.stats.cleanRun = NO;
+        [self.stats startTimer:ALL_TESTS];
     }
     [BPUtils printInfo:INFO withString:@"All Tests started."];
 }
@@ -70,29 +102,40 @@
     } else {
         self.exitStatus = BPExitStatusAllTestsPassed;
     }
-    [[BPStats sharedStats] endTimer:ALL_TESTS withResult:[BPExitStatusHelper stringFromExitStatus: self.exitStatus]];
+    [self.stats endTimer:ALL_TESTS withResult:[BPExitStatusHelper stringFromExitStatus: self.exitStatus]];
     [BPUtils printInfo:INFO withString:@"All Tests Completed."];
 }
 
 - (void)onTestCaseBeganWithName:(NSString *)testName inClass:(NSString *)testClass {
-    [[BPStats sharedStats] startTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName]];
+    [self.stats startTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName]];
     self.lastTestCaseStartDate = [NSDate date];
     self.testsState = Running;
 
     self.currentTestName = testName;
     self.currentClassName = testClass;
 
-    __weak typeof(self) __self = self;
-    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.maxTestExecutionTime * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
-        if ([__self.currentTestName isEqualToString:testName] && [__self.currentClassName isEqualToString:testClass] && __self.testsState == Running) {
-            [BPUtils printInfo:TIMEOUT withString:@"%10.6fs %@/%@", __self.maxTestExecutionTime, testClass, testName];
-            [__self stopTestsWithErrorMessage:@"Test took too long to execute and was aborted." forTestName:testName inClass:testClass];
-            __self.exitStatus = BPExitStatusTestTimeout;
-            [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName] withResult:@"ERROR"];
-            [[BPStats sharedStats] addTestRuntimeTimeout];
-        }
-    });
-    [[BPStats sharedStats] addTest];
+    // Only the latest test can time out, so just move the deadline
+    [self armTimer:self.testCaseTimer after:self.maxTestExecutionTime];
+    [self.stats addTest];
+}
+
+- (void)onTestCaseTimerFired {
+    NSString *testName = self.currentTestName;
+    NSString *testClass = self.currentClassName;
+    if (testName == nil || testClass == nil || self.testsState != Running) {
+        return;
+    }
+    NSTimeInterval elapsed = [[NSDate date] timeIntervalSinceDate:self.lastTestCaseStartDate];
+    if (elapsed < self.maxTestExecutionTime) {
+        // A new test started while we were firing, wait for its own deadline
+        [self armTimer:self.testCaseTimer after:self.maxTestExecutionTime - elapsed];
+        return;
+    }
+    [BPUtils printInfo:TIMEOUT withString:@"%10.6fs %@/%@", self.maxTestExecutionTime, testClass, testName];
+    [self stopTestsWithErrorMessage:@"Test took too long to execute and was aborted." forTestName:testName inClass:testClass];
+    self.exitStatus = BPExitStatusTestTimeout;
+    [self.stats endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName] withResult:@"ERROR"];
+    [self.stats addTestRuntimeTimeout];
 }
 
 - (void)onTestCasePassedWithName:(NSString *)testName inClass:(NSString *)testClass reportedDuration:(NSTimeInterval)duration {
@@ -108,7 +151,7 @@
     self.previousClassName = self.currentClassName ?: self.previousClassName;
     self.currentTestName = nil;
     self.currentClassName = nil;
-    [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName] withResult:@"PASSED"];
+    [self.stats endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName] withResult:@"PASSED"];
 }
 
 - (void)onTestCaseFailedWithName:(NSString *)testName inClass:(NSString *)testClass
@@ -116,11 +159,9 @@
     NSDate *currentTime = [NSDate date];
     NSString *fullTestName = [NSString stringWithFormat:@"%@/%@", testClass, testName];
 
-    for (NSString *fullName in self.failedTestCases) {
-        if([fullTestName isEqualToString:fullName]) {
-            // this test has already failed once
-            return;
-        }
+    if ([self.failedTestCases containsObject:fullTestName]) {
+        // this test has already failed once
+        return;
     }
 
     if (self.failedTestCases == nil) {
@@ -143,10 +184,10 @@
     self.previousClassName = self.currentClassName ?: self.previousClassName;
     self.currentTestName = nil;
     self.currentClassName = nil;
-    [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName] withResult:@"FAILED"];
-    [[BPStats sharedStats] addTestError];
+    [self.stats endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName] withResult:@"FAILED"];
+    [self.stats addTestError];
     if (wasException) {
-        [[BPStats sharedStats] addTestFailure];
+        [self.stats addTestFailure];
     }
 }
 
@@ -158,23 +199,21 @@
     if (self.executedTests == nil) {
         self.executedTests = [[NSMutableSet alloc] init];
     }
-    [self.executedTests addObject:[testClass stringByAppendingFormat:@"/%@", testName]];
-
-    // If we crash, on the re-execution, we'll have a new list of tests to skip because we already ran these to completion.
-    NSSet *testsToSkip = [[NSSet alloc] initWithArray:self.config.testCasesToSkip ?: @[]];
-    
-    self.config.testCasesToSkip = [[testsToSkip setByAddingObjectsFromSet:self.executedTests] allObjects];
-
+    // If we crash, on the re-execution, these get added to the list of tests to skip because we already ran them to completion.
+    NSMutableSet<NSString *> *executedTests = self.executedTests;
+    @synchronized (executedTests) {
+        [executedTests addObject:[testClass stringByAppendingFormat:@"/%@", testName]];
+    }
 }
 
 - (void)onTestSuiteBegan:(NSString *)testSuiteName onDate:(NSDate *)startDate isRoot:(BOOL)isRoot {
     [BPUtils printInfo:INFO withString:@"Starting TestSuite %@", testSuiteName];
-    [[BPStats sharedStats] startTimer:[NSString stringWithFormat:TEST_SUITE_FORMAT, isRoot ? 1 : [BPStats sharedStats].attemptNumber, testSuiteName]];
+    [self.stats startTimer:[NSString stringWithFormat:TEST_SUITE_FORMAT, isRoot ? 1 : self.stats.attemptNumber, testSuiteName]];
 }
 
 - (void)onTestSuiteEnded:(NSString *)testSuiteName
                   isRoot:(BOOL)isRoot {
-    [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_SUITE_FORMAT, isRoot ? 1 : [BPStats sharedStats].attemptNumber, testSuiteName] withResult:@"INFO"];
+    [self.stats endTimer:[NSString stringWithFormat:TEST_SUITE_FORMAT, isRoot ? 1 : self.stats.attemptNumber, testSuiteName] withResult:@"INFO"];
 }
 
 - (void)onOutputReceived:(NSString *)output {
@@ -184,9 +223,6 @@
         self.parserState = Running;
     }
 
-    self.currentOutputId++; // Increment the Output ID for this instance since we've moved on to the next bit of output
-
-    __block NSUInteger previousOutputId = self.currentOutputId;
     __weak typeof(self) __self = self;
 
     // App crashed
@@ -201,7 +237,7 @@
                     [self updateExecutedTestCaseList:testName inClass:testClass];
                     [BPUtils printInfo:CRASH withString:@"%@/%@ crashed app. Retry disabled.", testClass, testName];
                 }
-                [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName] withResult:@"CRASHED"];
+                [self.stats endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName] withResult:@"CRASHED"];
             } else {
                 assert(__self.testsState == Idle);
                 [BPUtils printInfo:CRASH withString:@"App crashed before tests started."];
@@ -210,32 +246,55 @@
                                 forTestName:(self.currentTestName ?: self.previousTestName)
                                     inClass:(self.currentClassName ?: self.previousClassName)];
             self.exitStatus = BPExitStatusAppCrashed;
-            [[BPStats sharedStats] addApplicationCrash];
+            [self.stats addApplicationCrash];
         }
     }
     
-    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(__self.maxTimeWithNoOutput * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
-        if (__self.currentOutputId == previousOutputId && (__self.appState == Running)) {
-            NSString *testClass = (__self.currentClassName ?: __self.previousClassName);
-            NSString *testName = (__self.currentTestName ?: __self.previousTestName);
-            BOOL testsReallyStarted = [__self didTestsStart];
-            if (testClass == nil && testName == nil && (__self.appState == Running)) {
-                testsReallyStarted = false;
-                [BPUtils printInfo:ERROR withString:@"It appears that tests have not yet started. The test app has frozen prior to the first test."];
-            } else {
-                [BPUtils printInfo:TIMEOUT withString:@" %10.6fs waiting for output from %@/%@",
-                 __self.maxTimeWithNoOutput, testClass, testName];
-                [[BPStats sharedStats] endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, [BPStats sharedStats].attemptNumber, testClass, testName] withResult:@"TIMEOUT"];
-            }
-            // Set exit status before stopping the tests because stopping the tests will set the SimulatorState to Completed
-            __self.exitStatus = testsReallyStarted ? BPExitStatusTestTimeout : BPExitStatusSimulatorCrashed;
-            [__self stopTestsWithErrorMessage:@"Timed out waiting for the test to produce output. Test was aborted."
-                                  forTestName:testName
-                                      inClass:testClass];
-            [[BPStats sharedStats] addTestOutputTimeout];
-        }
-    });
     self.lastOutput = currentTime;
+    // The timer is armed once and re-arms itself from lastOutput when it fires,
+    // so a chatty test costs a timestamp update per line and nothing more.
+    if (!atomic_exchange(&_outputTimerArmed, true)) {
+        [self armTimer:self.outputTimer after:self.maxTimeWithNoOutput];
+    }
+}
+
+- (void)onOutputTimerFired {
+    NSTimeInterval elapsed = [[NSDate date] timeIntervalSinceDate:self.lastOutput];
+    if (elapsed < self.maxTimeWithNoOutput) {
+        [self armTimer:self.outputTimer after:self.maxTimeWithNoOutput - elapsed];
+        return;
+    }
+    // Stay disarmed until there is more output. Output that came in since lastOutput was read found
+    // the timer armed and left it alone, so look again once it can arm the timer itself.
+    atomic_store(&_outputTimerArmed, false);
+    elapsed = [[NSDate date] timeIntervalSinceDate:self.lastOutput];
+    if (elapsed < self.maxTimeWithNoOutput) {
+        bool disarmed = false;
+        if (atomic_compare_exchange_strong(&_outputTimerArmed, &disarmed, true)) {
+            [self armTimer:self.outputTimer after:self.maxTimeWithNoOutput - elapsed];
+        }
+        return;
+    }
+    if (self.appState != Running) {
+        return;
+    }
+    NSString *testClass = (self.currentClassName ?: self.previousClassName);
+    NSString *testName = (self.currentTestName ?: self.previousTestName);
+    BOOL testsReallyStarted = [self didTestsStart];
+    if (testClass == nil && testName == nil) {
+        testsReallyStarted = false;
+        [BPUtils printInfo:ERROR withString:@"It appears that tests have not yet started. The test app has frozen prior to the first test."];
+    } else {
+        [BPUtils printInfo:TIMEOUT withString:@" %10.6fs waiting for output from %@/%@",
+         self.maxTimeWithNoOutput, testClass, testName];
+        [self.stats endTimer:[NSString stringWithFormat:TEST_CASE_FORMAT, self.stats.attemptNumber, testClass, testName] withResult:@"TIMEOUT"];
+    }
+    // Set exit status before stopping the tests because stopping the tests will set the SimulatorState to Completed
+    self.exitStatus = testsReallyStarted ? BPExitStatusTestTimeout : BPExitStatusSimulatorCrashed;
+    [self stopTestsWithErrorMessage:@"Timed out waiting for the test to produce output. Test was aborted."
+                        forTestName:testName
+                            inClass:testClass];
+    [self.stats addTestOutputTimeout];
 }
 
 - (void)stopTestsWithErrorMessage:(NSString *)message forTestName:(NSString *)testName inClass:(NSString *)testClass {
@@ -17,6 +17,8 @@
 #import "BPStats.h"
 #import "BPUtils.h"
 #import "BPXCTestFile.h"
+#import "BPTestInventoryCache.h"
+#import "BPJUnitJournal.h"
 #import "BPCreateSimulatorHandler.h"
 #import "BPDeleteSimulatorHandler.h"
 #import "BPApplicationLaunchHandler.h"
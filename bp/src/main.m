@@ -10,10 +10,12 @@
 #import <Foundation/Foundation.h>
 #import "Bluepill.h"
 #import "BPConfiguration.h"
+#import "BPReplay.h"
 #import "BPSimulator.h"
 #import "BPUtils.h"
 #import "SimulatorHelper.h"
 #import "BPStats.h"
+#import "BPTestInventoryCache.h"
 #import "BPWriter.h"
 
 #import <getopt.h>
@@ -58,17 +60,28 @@ int main(int argc, char * argv[]) {
                     basename(argv[0]), [[err localizedDescription] UTF8String]);
             exit(1);
         }
+        [BPTestInventoryCache sharedCache].directory = config.testInventoryCacheDirectory;
+        // Lets bluepill attribute the simulator setup timers to a test host when packing later runs.
+        [BPStats sharedStats].processLabel = [(config.testRunnerAppPath ?: config.appBundlePath) lastPathComponent];
 
         BPExitStatus exitCode;
-        Bluepill *bp = [[Bluepill alloc] initWithConfiguration:config];
-        exitCode = [bp run];
+        if (config.replayLogPath) {
+            exitCode = [BPReplay replayOutputAtPath:config.replayLogPath withConfiguration:config error:&err];
+            if (err) {
+                fprintf(stderr, "%s: replay failed\n\t%s\n", basename(argv[0]), [[err localizedDescription] UTF8String]);
+            }
+        } else {
+            Bluepill *bp = [[Bluepill alloc] initWithConfiguration:config];
+            exitCode = [bp run];
+        }
         if (config.outputDirectory) {
-            NSString *fileName = [NSString stringWithFormat:@"%@-stats.json", [[config.testBundlePath lastPathComponent] stringByDeletingPathExtension]];
+            NSString *fileName = [NSString stringWithFormat:@"%@-stats.json", [BPReplay reportNameWithConfiguration:config]];
             NSString *outputFile = [config.outputDirectory stringByAppendingPathComponent:fileName];
             BPWriter *statsWriter = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:outputFile];
             [[BPStats sharedStats] exitWithWriter:statsWriter exitCode:(int)exitCode];
         }
 
+        [BPWriter flushAllWriters];
         [BPUtils printInfo:INFO withString:@"BP exiting %ld", (long)exitCode];
         return (int)exitCode;
     }
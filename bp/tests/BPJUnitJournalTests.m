@@ -0,0 +1,107 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPExecutionPhaseProtocol.h"
+#import "BPJUnitJournal.h"
+#import "BPReporters.h"
+#import "BPTreeParser.h"
+#import "BPUtils.h"
+#import "BPWriter.h"
+
+static NSString * const kOutput = @"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                                  @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"
+                                  @"Test Case '-[BPSampleTests testPass]' started.\n"
+                                  @"some app output\n"
+                                  @"Test Case '-[BPSampleTests testPass]' passed (0.125 seconds).\n"
+                                  @"Test Case '-[BPSampleTests testFail]' started.\n"
+                                  @"BPSampleTests.m:42: error: -[BPSampleTests testFail] : XCTAssertTrue failed\n"
+                                  @"Test Case '-[BPSampleTests testFail]' failed (0.250 seconds).\n"
+                                  @"Test Suite 'BPSampleTests' failed at 2016-10-07 12:52:05.500.\n"
+                                  @"\t Executed 2 tests, with 1 failure (0 unexpected) in 0.375 (0.400) seconds\n"
+                                  @"Test Suite 'All tests' failed at 2016-10-07 12:52:05.600.\n"
+                                  @"\t Executed 2 tests, with 1 failure (0 unexpected) in 0.375 (0.500) seconds\n";
+
+@interface BPJUnitJournalTests : XCTestCase
+@property (nonatomic, strong) NSString *directory;
+@property (nonatomic, strong) BPTreeParser *parser;
+@end
+
+@implementation BPJUnitJournalTests
+
+- (void)setUp {
+    [super setUp];
+    [BPUtils quietMode:[BPUtils isBuildScript]];
+    self.directory = [BPUtils mkdtemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"BPJUnitJournal"] withError:nil];
+    NSString *logPath = [self.directory stringByAppendingPathComponent:@"simulator.log"];
+    self.parser = [[BPTreeParser alloc] initWithWriter:[[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:logPath]];
+    NSError *error;
+    self.parser.journal = [BPJUnitJournal journalAtPath:[self.directory stringByAppendingPathComponent:@"results.journal"] withError:&error];
+    XCTAssertNotNil(self.parser.journal, @"%@", [error localizedDescription]);
+}
+
+- (void)tearDown {
+    [self.parser cleanup];
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    [super tearDown];
+}
+
+- (NSString *)reportFromJournal {
+    NSString *reportPath = [self.directory stringByAppendingPathComponent:@"results.xml"];
+    NSError *error;
+    XCTAssert([BPJUnitJournal writeReportFromJournalAtPath:self.parser.journal.path toFile:reportPath withError:&error],
+              @"%@", [error localizedDescription]);
+    return [NSString stringWithContentsOfFile:reportPath encoding:NSUTF8StringEncoding error:nil];
+}
+
+- (void)testReportFromJournalMatchesReporter {
+    [self.parser handleChunkData:[kOutput dataUsingEncoding:NSUTF8StringEncoding]];
+    [self.parser completed];
+    NSString *report = [self.parser generateLog:[[JUnitReporter alloc] init]];
+
+    XCTAssertEqualObjects([self reportFromJournal], report);
+}
+
+- (void)testReportFromJournalOfInterruptedRun {
+    // The run dies in the middle of the second test, and the last record is cut short
+    NSString *output = [kOutput substringToIndex:[kOutput rangeOfString:@"BPSampleTests.m:42"].location];
+    [self.parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    NSFileHandle *journal = [NSFileHandle fileHandleForWritingAtPath:self.parser.journal.path];
+    [journal seekToEndOfFile];
+    [journal writeData:[@"{\"testCase\":3,\"suite\":2,\"ti" dataUsingEncoding:NSUTF8StringEncoding]];
+    [journal closeFile];
+
+    NSString *report = [self reportFromJournal];
+    NSError *error;
+    NSXMLDocument *document = [[NSXMLDocument alloc] initWithXMLString:report options:0 error:&error];
+    XCTAssertNotNil(document, @"%@", [error localizedDescription]);
+    NSXMLElement *suite = [[document nodesForXPath:@"/testsuites/testsuite" error:nil] firstObject];
+    XCTAssertEqualObjects([[suite attributeForName:@"name"] stringValue], @"BPSampleTests");
+    XCTAssertEqualObjects([[suite attributeForName:@"tests"] stringValue], @"1");
+    XCTAssertEqualObjects([[suite attributeForName:@"failures"] stringValue], @"0");
+    XCTAssertEqualObjects([[suite attributeForName:@"errors"] stringValue], @"0");
+    XCTAssertEqualObjects([[[document rootElement] attributeForName:@"tests"] stringValue], @"1");
+    XCTAssertEqualObjects([[document nodesForXPath:@"//testcase/@name" error:nil] valueForKey:@"stringValue"], @[@"testPass"]);
+    XCTAssert([report containsString:@"some app output"]);
+}
+
+- (void)testAbortedTestReplacesItsResult {
+    NSString *output = [kOutput substringToIndex:[kOutput rangeOfString:@"Test Case '-[BPSampleTests testFail]' started"].location];
+    [self.parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    [(id<BPMonitorCallbackProtocol>)self.parser onTestAbortedWithName:@"testPass" inClass:@"BPSampleTests" errorMessage:@"App crashed"];
+
+    NSString *report = [self reportFromJournal];
+    NSXMLDocument *document = [[NSXMLDocument alloc] initWithXMLString:report options:0 error:nil];
+    XCTAssertEqual([[document nodesForXPath:@"//testcase" error:nil] count], 1);
+    XCTAssertEqual([[document nodesForXPath:@"//testcase/failure" error:nil] count], 1);
+    XCTAssertEqualObjects([[[document rootElement] attributeForName:@"failures"] stringValue], @"1");
+}
+
+@end
@@ -0,0 +1,136 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPMachOSymbols.h"
+#import "BPTestClass.h"
+#import "BPTestHelper.h"
+#import "BPXCTestFile.h"
+
+// The fixtures are minimal MH_BUNDLE files containing only a symbol table:
+//   macho_test_symbols      thin x86_64
+//   macho_test_symbols_fat  universal arm64 + x86_64, same symbols in both slices
+// Alongside the tests they carry non-test symbols (helpers, method descriptors,
+// undefined and exported ObjC symbols, ObjC methods outside __TEXT,__text, stabs)
+// which must all be ignored.
+@interface BPMachOSymbolsTests : XCTestCase
+@end
+
+@implementation BPMachOSymbolsTests
+
+- (NSArray *)expectedSwiftTests {
+    return @[@[@"SwiftTests", @"testThrows()"],
+             @[@"SwiftTests", @"testAsyncOne()"],
+             @[@"SwiftTests", @"DISABLE_testFoo()"],
+             @[@"BPSampleAppTests", @"testOne()"]];
+}
+
+- (NSArray *)expectedObjCTests {
+    return @[@[@"BPSampleAppObjCTests", @"testObjCOne"],
+             @[@"BPSampleAppObjCTests", @"testObjCTwo"]];
+}
+
+- (void)testReadsThinBinary {
+    NSString *path = [[BPTestHelper resourceFolderPath] stringByAppendingPathComponent:@"macho_test_symbols"];
+    NSArray *swiftTests, *objcTests;
+    NSError *error;
+    XCTAssert([BPMachOSymbols readTestsFromBinary:path swiftTests:&swiftTests objcTests:&objcTests withError:&error], @"%@", error);
+    XCTAssertEqualObjects(swiftTests, [self expectedSwiftTests]);
+    XCTAssertEqualObjects(objcTests, [self expectedObjCTests]);
+}
+
+- (void)testReadsFatBinary {
+    NSString *path = [[BPTestHelper resourceFolderPath] stringByAppendingPathComponent:@"macho_test_symbols_fat"];
+    NSArray *swiftTests, *objcTests;
+    NSError *error;
+    XCTAssert([BPMachOSymbols readTestsFromBinary:path swiftTests:&swiftTests objcTests:&objcTests withError:&error], @"%@", error);
+    XCTAssertEqualObjects(swiftTests, [self expectedSwiftTests]);
+    XCTAssertEqualObjects(objcTests, [self expectedObjCTests]);
+}
+
+- (void)testRejectsNonMachOFile {
+    NSString *path = [[BPTestHelper resourceFolderPath] stringByAppendingPathComponent:@"testConfig.json"];
+    NSError *error;
+    XCTAssertFalse([BPMachOSymbols readTestsFromBinary:path swiftTests:nil objcTests:nil withError:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testXCTestFileFromFixtureBundle {
+    NSString *bundlePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"BPMachOFixture.xctest"];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    [fm removeItemAtPath:bundlePath error:nil];
+    XCTAssert([fm createDirectoryAtPath:bundlePath withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSString *fixture = [[BPTestHelper resourceFolderPath] stringByAppendingPathComponent:@"macho_test_symbols_fat"];
+    XCTAssert([fm copyItemAtPath:fixture toPath:[bundlePath stringByAppendingPathComponent:@"BPMachOFixture"] error:nil]);
+
+    BPXCTestFile *xcTestFile = [BPXCTestFile BPXCTestFileFromXCTestBundle:bundlePath andHostAppBundle:nil withError:nil];
+    XCTAssertNotNil(xcTestFile);
+    NSMutableDictionary *classes = [NSMutableDictionary dictionary];
+    for (BPTestClass *testClass in xcTestFile.testClasses) {
+        classes[testClass.name] = @(testClass.numTests);
+    }
+    // The disabled test still registers its class but isn't counted.
+    XCTAssertEqualObjects(classes, (@{@"SwiftTests": @2, @"BPSampleAppTests": @1, @"BPSampleAppObjCTests": @2}));
+    XCTAssertEqualObjects([NSSet setWithArray:xcTestFile.allTestCases],
+                          ([NSSet setWithArray:@[@"SwiftTests/testThrows()", @"SwiftTests/testAsyncOne()",
+                                                 @"BPSampleAppTests/testOne()",
+                                                 @"BPSampleAppObjCTests/testObjCOne", @"BPSampleAppObjCTests/testObjCTwo"]]));
+    [fm removeItemAtPath:bundlePath error:nil];
+}
+
+- (void)testDemangleSwiftMethodSymbols {
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAAC7testOneyyF"],
+                          (@[@"BPSampleAppTests", @"BPSampleAppTests", @"testOne()"]));
+    // Class name built from a literal plus a word of the module name.
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftMethodSymbol:"$s16BPSampleAppTests05SwiftC0C12testAsyncOneyyYaKF"],
+                          (@[@"BPSampleAppTests", @"SwiftTests", @"testAsyncOne()"]));
+    // Method name made of a literal word followed by a word substitution from the class name.
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftMethodSymbol:"_$s7MyTests8FooSuiteC04testC0yyF"],
+                          (@[@"MyTests", @"FooSuite", @"testFoo()"]));
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftMethodSymbol:"__T07MyTests3FooC8testBaryyKF"],
+                          (@[@"MyTests", @"Foo", @"testBar()"]));
+    // Thunks, descriptors, methods with arguments, static methods and bad input are rejected.
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAAC7testOneyyFTq"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAAC7testOneyyFTo"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAAC7testArg5valueySi_tF"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAAC7testOneyyFZ"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s16BPSampleAppTestsAZC7testOneyyF"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s99BPSampleAppTestsyyF"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_main"]);
+}
+
+- (void)testDemangleSwiftSubstitutions {
+    NSMutableArray<NSString *> *substitutions = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 31; i++) {
+        [substitutions addObject:[NSString stringWithFormat:@"S%lu", (unsigned long)i]];
+    }
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"AA" withSubstitutions:substitutions], @[@"S0"]);
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"AZ" withSubstitutions:substitutions], @[@"S25"]);
+    // Indexes from 26 on are spelled out: A_ is 26 and A<n>_ is n + 27.
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"A_" withSubstitutions:substitutions], @[@"S26"]);
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"A0_" withSubstitutions:substitutions], @[@"S27"]);
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"A3_" withSubstitutions:substitutions], @[@"S30"]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftSubstitution:"A4_" withSubstitutions:substitutions]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftSubstitution:"A_" withSubstitutions:[substitutions subarrayWithRange:NSMakeRange(0, 26)]]);
+    // Lowercase letters continue the list, an uppercase letter ends it, and a number repeats the next letter.
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"AbC" withSubstitutions:substitutions], (@[@"S1", @"S2"]));
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"A2aczB" withSubstitutions:substitutions],
+                          (@[@"S0", @"S0", @"S2", @"S25", @"S1"]));
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftSubstitution:"Aa3B" withSubstitutions:substitutions], (@[@"S0", @"S1", @"S1", @"S1"]));
+    XCTAssertNil([BPMachOSymbols demangleSwiftSubstitution:"Aab" withSubstitutions:substitutions]);
+    XCTAssertNil([BPMachOSymbols demangleSwiftSubstitution:"A" withSubstitutions:substitutions]);
+
+    // A method named after its class, and a multi-substitution that names too much for a method.
+    XCTAssertEqualObjects([BPMachOSymbols demangleSwiftMethodSymbol:"_$s7MyTests7testFooCAByyF"],
+                          (@[@"MyTests", @"testFoo", @"testFoo()"]));
+    XCTAssertNil([BPMachOSymbols demangleSwiftMethodSymbol:"_$s7MyTests3FooCAaByyF"]);
+}
+
+@end
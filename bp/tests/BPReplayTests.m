@@ -0,0 +1,82 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPConfiguration.h"
+#import "BPExitStatus.h"
+#import "BPReplay.h"
+#import "BPReporters.h"
+#import "BPStats.h"
+#import "BPTreeParser.h"
+#import "BPUtils.h"
+#import "BPWriter.h"
+
+@interface BPReplayTests : XCTestCase
+@property (nonatomic, strong) BPConfiguration *config;
+@property (nonatomic, strong) NSString *outputDirectory;
+@end
+
+@implementation BPReplayTests
+
+- (void)setUp {
+    [super setUp];
+
+    [BPUtils quietMode:[BPUtils isBuildScript]];
+    self.outputDirectory = [BPUtils mkdtemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"BPReplay"] withError:nil];
+    self.config = [[BPConfiguration alloc] initWithProgram:BP_BINARY];
+    self.config.testing_NoAppWillRun = YES;
+    self.config.outputDirectory = self.outputDirectory;
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.outputDirectory error:nil];
+    [super tearDown];
+}
+
+- (NSString *)resourcePath:(NSString *)name {
+    return [[[NSBundle bundleForClass:[self class]] resourcePath] stringByAppendingPathComponent:name];
+}
+
+- (void)testReplayWritesTheSameReportAsParsing {
+    NSString *logPath = [self resourcePath:@"multiple_reports_for_one_error.log"];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[[BPWriter alloc] initWithDestination:BPWriterDestinationFile
+                                                                                              andPath:[BPUtils mkstemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"out"] withError:nil]]];
+    [parser handleChunkData:[NSData dataWithContentsOfFile:logPath]];
+    [parser completed];
+    NSString *parsedReport = [parser generateLog:[[JUnitReporter alloc] init]];
+    [parser cleanup];
+
+    NSError *error;
+    self.config.replayLogPath = logPath;
+    BPExitStatus exitStatus = [BPReplay replayOutputAtPath:logPath withConfiguration:self.config error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(exitStatus, BPExitStatusTestsFailed);
+
+    NSString *reportPath = [self.outputDirectory stringByAppendingPathComponent:@"TEST-multiple_reports_for_one_error-1-results.xml"];
+    NSString *replayedReport = [NSString stringWithContentsOfFile:reportPath encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects([replayedReport stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]],
+                          [parsedReport stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]]);
+    XCTAssert([[NSFileManager defaultManager] fileExistsAtPath:[self.outputDirectory stringByAppendingPathComponent:@"1-simulator.log"]]);
+}
+
+- (void)testReplayDetectsCrash {
+    NSString *logPath = [self resourcePath:@"parse_crash.log"];
+    BPExitStatus exitStatus = [BPReplay replayOutputAtPath:logPath withConfiguration:self.config error:nil];
+    XCTAssertEqual(exitStatus, BPExitStatusAppCrashed);
+}
+
+- (void)testReplayMissingFile {
+    NSError *error;
+    [BPReplay replayOutputAtPath:@"/does/not/exist.log" withConfiguration:self.config error:&error];
+    XCTAssertNotNil(error);
+}
+
+@end
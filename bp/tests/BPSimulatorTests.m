@@ -0,0 +1,123 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPConfiguration.h"
+#import "BPSimulator.h"
+#import "BPStats.h"
+#import "BPUtils.h"
+#import "BPWriter.h"
+#import "BPXCTestFile.h"
+
+@interface BPSimulator (Test)
+- (NSString *)provisionTemplateWithHost:(NSString *)testHost withError:(NSError **)errPtr;
+@end
+
+// Provisions templates without touching CoreSimulator, recording how many ran at once.
+@interface BPFakeTemplateSimulator : BPSimulator
+@property (nonatomic, assign) NSUInteger running;
+@property (nonatomic, assign) NSUInteger maxRunning;
+@property (nonatomic, strong) NSString *failingHost;
+@end
+
+@implementation BPFakeTemplateSimulator
+
+- (NSString *)provisionTemplateWithHost:(NSString *)testHost withError:(NSError **)errPtr {
+    @synchronized (self) {
+        self.running++;
+        self.maxRunning = MAX(self.maxRunning, self.running);
+    }
+    [NSThread sleepForTimeInterval:0.2];
+    @synchronized (self) {
+        self.running--;
+    }
+    if ([testHost isEqualToString:self.failingHost]) {
+        return nil;
+    }
+    return [[NSUUID UUID] UUIDString];
+}
+
+@end
+
+@interface BPSimulatorTests : XCTestCase
+@end
+
+@implementation BPSimulatorTests
+
+- (void)setUp {
+    [super setUp];
+
+    [BPUtils quietMode:[BPUtils isBuildScript]];
+}
+
+// Hosts from different build products often share a name, so each one is listed under its own directory.
+- (NSArray<BPXCTestFile *> *)bundlesWithHosts:(NSUInteger)count {
+    NSMutableArray<BPXCTestFile *> *bundles = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < count; i++) {
+        BPXCTestFile *bundle = [[BPXCTestFile alloc] init];
+        bundle.testHostPath = [NSString stringWithFormat:@"/tmp/BPSimulatorTests/Build%lu/App.app", (unsigned long)i];
+        [bundles addObject:bundle];
+    }
+    return bundles;
+}
+
+- (void)testTemplatesAreProvisionedConcurrently {
+    BPConfiguration *config = [BPConfiguration new];
+    config.numSims = @8;
+    BPFakeTemplateSimulator *sim = [BPFakeTemplateSimulator simulatorWithConfiguration:config];
+    // Report from stats of our own, reporting the shared ones would end them for every other test.
+    BPStats *stats = [[BPStats alloc] init];
+    sim.stats = stats;
+    NSArray<BPXCTestFile *> *bundles = [self bundlesWithHosts:6];
+
+    NSMutableDictionary *templates = [sim createSimulatorAndInstallAppWithBundles:bundles];
+
+    XCTAssertEqual(templates.count, bundles.count);
+    for (BPXCTestFile *bundle in bundles) {
+        XCTAssertNotNil(templates[bundle.testHostPath]);
+    }
+    XCTAssertEqual([[NSSet setWithArray:[templates allValues]] count], bundles.count);
+    XCTAssertGreaterThan(sim.maxRunning, 1);
+    XCTAssertLessThanOrEqual(sim.maxRunning, 4);
+
+    // Every host gets its own template timer, even when the hosts share a name.
+    NSString *reportPath = [BPUtils mkstemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"template-stats"] withError:nil];
+    BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:reportPath];
+    [stats exitWithWriter:writer exitCode:0];
+    NSString *report = [NSString stringWithContentsOfFile:reportPath encoding:NSUTF8StringEncoding error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:reportPath error:nil];
+    for (BPXCTestFile *bundle in bundles) {
+        XCTAssert([report containsString:PROVISION_TEMPLATE(bundle.testHostPath)],
+                  @"Missing template timer for %@", bundle.testHostPath);
+    }
+}
+
+- (void)testTemplateConcurrencyIsBoundedByNumSims {
+    BPConfiguration *config = [BPConfiguration new];
+    config.numSims = @1;
+    BPFakeTemplateSimulator *sim = [BPFakeTemplateSimulator simulatorWithConfiguration:config];
+
+    NSMutableDictionary *templates = [sim createSimulatorAndInstallAppWithBundles:[self bundlesWithHosts:3]];
+
+    XCTAssertEqual(templates.count, 3);
+    XCTAssertEqual(sim.maxRunning, 1);
+}
+
+- (void)testFailedTemplateFailsProvisioning {
+    BPConfiguration *config = [BPConfiguration new];
+    config.numSims = @4;
+    BPFakeTemplateSimulator *sim = [BPFakeTemplateSimulator simulatorWithConfiguration:config];
+    NSArray<BPXCTestFile *> *bundles = [self bundlesWithHosts:4];
+    sim.failingHost = bundles[2].testHostPath;
+
+    XCTAssertNil([sim createSimulatorAndInstallAppWithBundles:bundles]);
+}
+
+@end
@@ -0,0 +1,89 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPTestCase.h"
+#import "BPTestClass.h"
+#import "BPTestHelper.h"
+#import "BPTestInventoryCache.h"
+#import "BPXCTestFile.h"
+
+@interface BPTestInventoryCacheTests : XCTestCase
+@property (nonatomic, strong) NSString *cacheDirectory;
+@property (nonatomic, strong) NSString *bundlePath;
+@end
+
+@implementation BPTestInventoryCacheTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *tmp = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    self.cacheDirectory = [tmp stringByAppendingPathComponent:@"cache"];
+    self.bundlePath = [tmp stringByAppendingPathComponent:@"BPMachOFixture.xctest"];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    XCTAssert([fm createDirectoryAtPath:self.bundlePath withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSString *fixture = [[BPTestHelper resourceFolderPath] stringByAppendingPathComponent:@"macho_test_symbols_fat"];
+    XCTAssert([fm copyItemAtPath:fixture toPath:[self.bundlePath stringByAppendingPathComponent:@"BPMachOFixture"] error:nil]);
+    [BPTestInventoryCache sharedCache].directory = self.cacheDirectory;
+}
+
+- (void)tearDown {
+    [BPTestInventoryCache sharedCache].directory = nil;
+    [[NSFileManager defaultManager] removeItemAtPath:[self.cacheDirectory stringByDeletingLastPathComponent] error:nil];
+    [super tearDown];
+}
+
+- (void)testStoreAndLookup {
+    BPTestInventoryCache *cache = [BPTestInventoryCache sharedCache];
+    NSString *key = [cache keyForBinary:[self.bundlePath stringByAppendingPathComponent:@"BPMachOFixture"]];
+    XCTAssertNotNil(key);
+    NSUInteger hits = cache.hits, misses = cache.misses;
+    XCTAssertNil([cache testClassesForKey:key]);
+    XCTAssertEqual(cache.misses, misses + 1);
+
+    BPTestClass *testClass = [[BPTestClass alloc] initWithName:@"SomeTests"];
+    [testClass addTestCase:[[BPTestCase alloc] initWithName:@"testA"]];
+    [testClass addTestCase:[[BPTestCase alloc] initWithName:@"testB()"]];
+    [cache storeTestClasses:@[testClass] forKey:key];
+
+    NSArray<BPTestClass *> *cached = [cache testClassesForKey:key];
+    XCTAssertEqual(cache.hits, hits + 1);
+    XCTAssertEqual(cached.count, 1);
+    XCTAssertEqualObjects(cached[0].name, @"SomeTests");
+    XCTAssertEqualObjects([cached[0].testCases valueForKey:@"name"], (@[@"testA", @"testB()"]));
+}
+
+- (void)testXCTestFileUsesCache {
+    BPTestInventoryCache *cache = [BPTestInventoryCache sharedCache];
+    NSUInteger hits = cache.hits, misses = cache.misses;
+    BPXCTestFile *scanned = [BPXCTestFile BPXCTestFileFromXCTestBundle:self.bundlePath andHostAppBundle:nil withError:nil];
+    XCTAssertEqual(cache.misses, misses + 1);
+    BPXCTestFile *cached = [BPXCTestFile BPXCTestFileFromXCTestBundle:self.bundlePath andHostAppBundle:nil withError:nil];
+    XCTAssertEqual(cache.hits, hits + 1);
+    XCTAssertEqualObjects(cached.allTestCases, scanned.allTestCases);
+    XCTAssertEqual(cached.numTests, 5);
+}
+
+- (void)testCorruptEntryIsAMiss {
+    BPTestInventoryCache *cache = [BPTestInventoryCache sharedCache];
+    NSString *key = [cache keyForBinary:[self.bundlePath stringByAppendingPathComponent:@"BPMachOFixture"]];
+    XCTAssert([[NSFileManager defaultManager] createDirectoryAtPath:self.cacheDirectory withIntermediateDirectories:YES attributes:nil error:nil]);
+    NSString *entryPath = [self.cacheDirectory stringByAppendingPathComponent:[key stringByAppendingPathExtension:@"json"]];
+    XCTAssert([@"{\"version\": 1, \"testClasses\": [" writeToFile:entryPath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    NSUInteger misses = cache.misses;
+    BPXCTestFile *xcTestFile = [BPXCTestFile BPXCTestFileFromXCTestBundle:self.bundlePath andHostAppBundle:nil withError:nil];
+    XCTAssertEqual(cache.misses, misses + 1);
+    XCTAssertEqual(xcTestFile.numTests, 5);
+    // The entry was rewritten by the scan.
+    XCTAssertNotNil([cache testClassesForKey:key]);
+}
+
+@end
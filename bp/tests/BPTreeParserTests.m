@@ -20,6 +20,11 @@
 #import "BPReporters.h"
 #import "BPUtils.h"
 #import "BPTreeAssembler.h"
+#import "BPTreeObjects.h"
+
+@interface BPTreeParser (Test)
+- (void)parseLine:(NSString *)line;
+@end
 
 @interface BPTreeParserTests : XCTestCase
 
@@ -32,7 +37,6 @@
 - (void)setUp {
     [super setUp];
 
-    [BPTreeAssembler.sharedInstance reset];
     [BPUtils quietMode:[BPUtils isBuildScript]];
     [BPUtils enableDebugOutput:![BPUtils isBuildScript]];
     self.config = [[BPConfiguration alloc] initWithProgram:BP_BINARY];
@@ -76,6 +80,39 @@
     XCTAssert(monitor.exitStatus == BPExitStatusAppCrashed);
 }
 
+- (void)testParsersKeepSeparateTrees {
+    NSString *(^output)(NSString *) = ^(NSString *testName) {
+        return [NSString stringWithFormat:@"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"
+                @"Test Case '-[BPSampleTests %@]' started.\n"
+                @"Test Case '-[BPSampleTests %@]' passed (0.125 seconds).\n", testName, testName];
+    };
+    BPTreeAssembler *assembler = [[BPTreeAssembler alloc] initWithStats:[[BPStats alloc] init]];
+    BPTreeParser *first = [[BPTreeParser alloc] initWithWriter:[self writer] assembler:assembler];
+    BPTreeParser *second = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    [first handleChunkData:[output(@"testFirst") dataUsingEncoding:NSUTF8StringEncoding]];
+    [second handleChunkData:[output(@"testSecond") dataUsingEncoding:NSUTF8StringEncoding]];
+
+    // A relaunch after a crash continues the tree of the same assembler
+    BPTreeParser *relaunched = [[BPTreeParser alloc] initWithWriter:[self writer] assembler:assembler];
+    [relaunched handleChunkData:[output(@"testRelaunched") dataUsingEncoding:NSUTF8StringEncoding]];
+    [relaunched completed];
+    [second completed];
+
+    NSString *firstReport = [relaunched generateLog:[[JUnitReporter alloc] init]];
+    NSString *secondReport = [second generateLog:[[JUnitReporter alloc] init]];
+    XCTAssert([firstReport containsString:@"testFirst"]);
+    XCTAssert([firstReport containsString:@"testRelaunched"]);
+    XCTAssertFalse([firstReport containsString:@"testSecond"]);
+    XCTAssert([secondReport containsString:@"testSecond"]);
+    XCTAssertFalse([secondReport containsString:@"testFirst"]);
+
+    [relaunched cleanup];
+    XCTAssertNil(assembler.root);
+    XCTAssertNotNil(second.assembler.root);
+    XCTAssert(assembler.stats.cleanRun);
+}
+
 - (void)testMultipleReports {
     NSString *logPath = [[[NSBundle bundleForClass:[self class]] resourcePath] stringByAppendingPathComponent:@"multiple_reports_for_one_error.log"];
     NSString *wholeFile = [NSString stringWithContentsOfFile:logPath encoding:NSUTF8StringEncoding error:nil];
@@ -213,4 +250,323 @@
     XCTAssert(monitor.exitStatus == BPExitStatusAppCrashed);
 }
 
+- (void)testChunkedInputMatchesWholeInput {
+    NSString *logPath = [[[NSBundle bundleForClass:[self class]] resourcePath] stringByAppendingPathComponent:@"intermixed_crash.log"];
+    NSData *wholeData = [NSData dataWithContentsOfFile:logPath];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    [parser handleChunkData:wholeData];
+    [parser completed];
+    NSString *wholeReport = [parser generateLog:[[JUnitReporter alloc] init]];
+    [parser cleanup];
+
+    parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    NSUInteger chunkSize = 37; // Deliberately splits lines at arbitrary points
+    for (NSUInteger offset = 0; offset < wholeData.length; offset += chunkSize) {
+        NSUInteger length = MIN(chunkSize, wholeData.length - offset);
+        [parser handleChunkData:[wholeData subdataWithRange:NSMakeRange(offset, length)]];
+    }
+    [parser completed];
+    NSString *chunkedReport = [parser generateLog:[[JUnitReporter alloc] init]];
+
+    XCTAssertEqualObjects(wholeReport, chunkedReport);
+}
+
+- (void)testMultiByteCharacterSplitAcrossChunks {
+    NSString *output = @"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                       @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"
+                       @"Test Case '-[BPSampleTests testUnicode]' started.\n"
+                       @"h\u00e9llo w\u00f6rld \u2713\n"
+                       @"Test Case '-[BPSampleTests testUnicode]' passed (0.001 seconds).\n";
+    NSData *data = [output dataUsingEncoding:NSUTF8StringEncoding];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    // Feed one byte at a time so every multi-byte character is torn across chunks
+    for (NSUInteger offset = 0; offset < data.length; offset++) {
+        [parser handleChunkData:[data subdataWithRange:NSMakeRange(offset, 1)]];
+    }
+    [parser completed];
+    NSString *report = [parser generateLog:[[JUnitReporter alloc] init]];
+
+    XCTAssert([report containsString:@"h\u00e9llo w\u00f6rld \u2713"]);
+}
+
+- (void)testStructuredResultsMatchOutput {
+    NSString *output = @"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                       @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"
+                       @"Test Case '-[BPSampleTests testPass]' started.\n"
+                       @"some app output\n"
+                       @"Test Case '-[BPSampleTests testPass]' passed (0.125 seconds).\n"
+                       @"Test Case '-[BPSampleTests testFail]' started.\n"
+                       @"BPSampleTests.m:42: error: -[BPSampleTests testFail] : XCTAssertTrue failed\n"
+                       @"Test Case '-[BPSampleTests testFail]' failed (0.250 seconds).\n"
+                       @"Test Suite 'BPSampleTests' failed at 2016-10-07 12:52:05.500.\n"
+                       @"\t Executed 2 tests, with 1 failure (0 unexpected) in 0.375 (0.400) seconds\n"
+                       @"Test Suite 'All tests' failed at 2016-10-07 12:52:05.600.\n"
+                       @"\t Executed 2 tests, with 1 failure (0 unexpected) in 0.375 (0.500) seconds\n";
+    NSArray<NSString *> *lines = [output componentsSeparatedByString:@"\n"];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    [parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser completed];
+    NSString *parsedReport = [parser generateLog:[[JUnitReporter alloc] init]];
+    [parser cleanup];
+
+    // The same run, reported by testmanagerd with the output arriving alongside
+    parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.structuredResults = YES;
+    [parser onStructuredTestSuiteStarted:@"All tests" atTime:@"2016-10-07 12:52:05.091"];
+    [parser onStructuredTestSuiteStarted:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.092"];
+    [parser onStructuredTestCaseStartedWithName:@"testPass" inClass:@"BPSampleTests"];
+    for (NSString *line in [lines subarrayWithRange:NSMakeRange(0, 4)]) {
+        [parser handleChunkData:[[line stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    [parser onStructuredTestCaseFinishedWithName:@"testPass" inClass:@"BPSampleTests" passed:YES duration:0.125];
+    [parser onStructuredTestCaseStartedWithName:@"testFail" inClass:@"BPSampleTests"];
+    [parser onStructuredTestCaseFailedWithName:@"testFail" inClass:@"BPSampleTests"
+                                        inFile:@"BPSampleTests.m" onLineNumber:42 withMessage:@"XCTAssertTrue failed"];
+    for (NSString *line in [lines subarrayWithRange:NSMakeRange(4, lines.count - 4)]) {
+        [parser handleChunkData:[[line stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    [parser onStructuredTestCaseFinishedWithName:@"testFail" inClass:@"BPSampleTests" passed:NO duration:0.250];
+    [parser onStructuredTestSuiteFinished:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.500"
+                                 runCount:2 failures:1 unexpected:0 totalDuration:0.400];
+    [parser onStructuredTestSuiteFinished:@"All tests" atTime:@"2016-10-07 12:52:05.600"
+                                 runCount:2 failures:1 unexpected:0 totalDuration:0.500];
+    [parser completed];
+    NSString *structuredReport = [parser generateLog:[[JUnitReporter alloc] init]];
+
+    XCTAssert([structuredReport containsString:@"some app output"]);
+    XCTAssert([structuredReport containsString:@"XCTAssertTrue failed"]);
+    XCTAssertEqualObjects(parsedReport, structuredReport);
+}
+
+- (void)testStructuredResultsKeepOutputWithItsTest {
+    NSString *firstTest = @"Test Case '-[BPSampleTests testFirst]' started.\n"
+                          @"output of the first test\n"
+                          @"Test Case '-[BPSampleTests testFirst]' passed (0.125 seconds).\n";
+    NSString *secondTest = @"Test Case '-[BPSampleTests testSecond]' started.\n"
+                           @"output of the second test\n"
+                           @"Test Case '-[BPSampleTests testSecond]' passed (0.125 seconds).\n";
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.structuredResults = YES;
+    [parser onStructuredTestSuiteStarted:@"All tests" atTime:@"2016-10-07 12:52:05.091"];
+    [parser onStructuredTestSuiteStarted:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.092"];
+    // The output of the first test only arrives once the second test has started,
+    [parser onStructuredTestCaseStartedWithName:@"testFirst" inClass:@"BPSampleTests"];
+    [parser onStructuredTestCaseFinishedWithName:@"testFirst" inClass:@"BPSampleTests" passed:YES duration:0.125];
+    [parser onStructuredTestCaseStartedWithName:@"testSecond" inClass:@"BPSampleTests"];
+    [parser handleChunkData:[firstTest dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser onStructuredTestCaseFinishedWithName:@"testSecond" inClass:@"BPSampleTests" passed:YES duration:0.125];
+    // and the output of the first test's second run before that run was reported to start.
+    [parser handleChunkData:[secondTest dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser handleChunkData:[[firstTest stringByReplacingOccurrencesOfString:@"output" withString:@"rerun"]
+                             dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser onStructuredTestCaseStartedWithName:@"testFirst" inClass:@"BPSampleTests"];
+    [parser onStructuredTestCaseFinishedWithName:@"testFirst" inClass:@"BPSampleTests" passed:YES duration:0.125];
+
+    NSArray<BPLogEntry *> *testCases = [parser.assembler.root.children.firstObject children];
+    XCTAssertEqual(testCases.count, 3);
+    XCTAssertEqualObjects(testCases[0].log, @"output of the first test\n");
+    XCTAssertEqualObjects(testCases[1].log, @"output of the second test\n");
+    XCTAssertEqualObjects(testCases[2].log, @"rerun of the first test\n");
+    [parser cleanup];
+}
+
+- (void)testStructuredSkippedTestIsNotAFailure {
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.structuredResults = YES;
+    [parser onStructuredTestSuiteStarted:@"All tests" atTime:@"2016-10-07 12:52:05.091"];
+    [parser onStructuredTestSuiteStarted:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.092"];
+    [parser onStructuredTestCaseStartedWithName:@"testSkip" inClass:@"BPSampleTests"];
+    [parser onStructuredTestCaseSkippedWithName:@"testSkip" inClass:@"BPSampleTests" withMessage:@"Not on this OS"];
+    [parser onStructuredTestCaseFinishedWithName:@"testSkip" inClass:@"BPSampleTests" passed:NO duration:0.010];
+    [parser onStructuredTestSuiteFinished:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.500"
+                                 runCount:1 failures:0 unexpected:0 totalDuration:0.010];
+    [parser onStructuredTestSuiteFinished:@"All tests" atTime:@"2016-10-07 12:52:05.600"
+                                 runCount:1 failures:0 unexpected:0 totalDuration:0.010];
+    [parser completed];
+
+    BPTestCaseLogEntry *testCase = [parser.assembler.root.children.firstObject testCaseWithClass:@"BPSampleTests" andName:@"testSkip"];
+    XCTAssertTrue(testCase.passed);
+    NSString *report = [parser generateLog:[[JUnitReporter alloc] init]];
+    XCTAssertFalse([report containsString:@"<error"]);
+    XCTAssertFalse([report containsString:@"<failure"]);
+    XCTAssert([report containsString:@"Test skipped: Not on this OS"]);
+    [parser cleanup];
+}
+
+- (void)testStructuredOutputOfUnreportedTestIsKept {
+    NSString *output = @"Test Case '-[BPSampleTests testCrash]' started.\n"
+                       @"last words of the crashing test\n";
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.structuredResults = YES;
+    [parser onStructuredTestSuiteStarted:@"All tests" atTime:@"2016-10-07 12:52:05.091"];
+    [parser onStructuredTestSuiteStarted:@"BPSampleTests" atTime:@"2016-10-07 12:52:05.092"];
+    // The app crashes before the start of the test is reported.
+    [parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser completed];
+
+    BPLogEntry *suite = parser.assembler.root.children.firstObject;
+    XCTAssert([suite.log containsString:@"last words of the crashing test"], @"%@", suite.log);
+    [parser cleanup];
+}
+
+- (void)testRunawayOutputIsSpilledToDisk {
+    NSString *spillDirectory = [BPUtils mkdtemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"BPSpill"] withError:nil];
+    NSUInteger numberOfLines = 100000;
+    NSMutableString *output = [NSMutableString stringWithString:@"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                                                                @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"
+                                                                @"Test Case '-[BPSampleTests testChatty]' started.\n"];
+    for (NSUInteger i = 0; i < numberOfLines; i++) {
+        [output appendFormat:@"chatty line %lu\n", (unsigned long)i];
+    }
+    [output appendString:@"Test Case '-[BPSampleTests testChatty]' passed (1.000 seconds).\n"];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.maxLogSize = 4096;
+    parser.logSpillDirectory = spillDirectory;
+    [parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser completed];
+    NSString *report = [parser generateLog:[[JUnitReporter alloc] init]];
+
+    BPTestCaseLogEntry *testCase = [parser.assembler.root.children.firstObject testCaseWithClass:@"BPSampleTests" andName:@"testChatty"];
+    XCTAssertNotNil(testCase.logSpillPath);
+    XCTAssertLessThan([report length], 4 * parser.maxLogSize);
+    XCTAssert([report containsString:@"chatty line 0\n"]);
+    XCTAssert([report containsString:[NSString stringWithFormat:@"chatty line %lu\n", (unsigned long)numberOfLines - 1]]);
+    XCTAssert([report containsString:testCase.logSpillPath]);
+
+    // Nothing is lost: the start, the spilled middle and the end add up to the whole output
+    NSString *spilled = [NSString stringWithContentsOfFile:testCase.logSpillPath encoding:NSUTF8StringEncoding error:nil];
+    NSArray<NSString *> *parts = [testCase.log componentsSeparatedByString:@"\n["];
+    XCTAssertEqual(parts.count, 2);
+    NSString *tail = [parts[1] substringFromIndex:[parts[1] rangeOfString:@"]\n"].location + 2];
+    NSString *whole = [NSString stringWithFormat:@"%@\n%@%@", parts[0], spilled, tail];
+    NSArray<NSString *> *lines = [[whole stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]] componentsSeparatedByString:@"\n"];
+    XCTAssertEqual(lines.count, numberOfLines);
+    for (NSUInteger i = 0; i < lines.count; i++) {
+        XCTAssertEqualObjects(lines[i], ([NSString stringWithFormat:@"chatty line %lu", (unsigned long)i]));
+    }
+
+    [[NSFileManager defaultManager] removeItemAtPath:spillDirectory error:nil];
+}
+
+- (void)testSuiteOutputHasItsOwnLimit {
+    NSUInteger numberOfLines = 1000;
+    NSMutableString *output = [NSMutableString stringWithString:@"Test Suite 'All tests' started at 2016-10-07 12:52:05.091\n"
+                                                                @"Test Suite 'BPSampleTests' started at 2016-10-07 12:52:05.092\n"];
+    for (NSUInteger i = 0; i < numberOfLines; i++) {
+        [output appendFormat:@"setup line %lu\n", (unsigned long)i];
+    }
+    [output appendString:@"Test Case '-[BPSampleTests testChatty]' started.\n"];
+    for (NSUInteger i = 0; i < numberOfLines; i++) {
+        [output appendFormat:@"chatty line %lu\n", (unsigned long)i];
+    }
+    [output appendString:@"Test Case '-[BPSampleTests testChatty]' passed (1.000 seconds).\n"];
+
+    BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+    parser.maxSuiteLogSize = 1024;
+    [parser handleChunkData:[output dataUsingEncoding:NSUTF8StringEncoding]];
+    [parser completed];
+
+    BPTestSuiteLogEntry *suite = (BPTestSuiteLogEntry *)parser.assembler.root.children.firstObject;
+    XCTAssertLessThan([suite.log length], 4 * parser.maxSuiteLogSize);
+    XCTAssert([suite.log containsString:@"setup line 0\n"]);
+    XCTAssert([suite.log containsString:@"bytes of output omitted"]);
+    // Test cases keep all of their output by default
+    BPTestCaseLogEntry *testCase = [suite testCaseWithClass:@"BPSampleTests" andName:@"testChatty"];
+    for (NSUInteger i = 0; i < numberOfLines; i++) {
+        XCTAssert([testCase.log containsString:[NSString stringWithFormat:@"chatty line %lu\n", (unsigned long)i]]);
+    }
+    [parser cleanup];
+}
+
+// Benchmark for test case lookups in a synthetic suite with 20k tests
+- (void)testTestCaseLookupPerformance {
+    NSUInteger numberOfTests = 20000;
+    BPTestSuiteLogEntry *suite = [[BPTestSuiteLogEntry alloc] init];
+    suite.testSuiteName = @"BPSyntheticTests";
+    for (NSUInteger i = 0; i < numberOfTests; i++) {
+        BPTestCaseLogEntry *testCase = [[BPTestCaseLogEntry alloc] init];
+        testCase.testCaseClass = [NSString stringWithFormat:@"BPSyntheticClass%lu", (unsigned long)(i % 100)];
+        testCase.testCaseName = [NSString stringWithFormat:@"test%lu", (unsigned long)i];
+        [suite addChild:testCase];
+    }
+
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < numberOfTests; i++) {
+            NSString *testCaseClass = [NSString stringWithFormat:@"BPSyntheticClass%lu", (unsigned long)(i % 100)];
+            NSString *testCaseName = [NSString stringWithFormat:@"test%lu", (unsigned long)i];
+            BPTestCaseLogEntry *testCase = [suite testCaseWithClass:testCaseClass andName:testCaseName];
+            XCTAssertEqualObjects(testCase.testCaseName, testCaseName);
+        }
+    }];
+
+    XCTAssertNil([suite testCaseWithClass:@"BPSyntheticClass0" andName:@"test1"]);
+}
+
+// Benchmark for the monitor's bookkeeping over 10k test completions
+- (void)testExecutedTestsTrackingPerformance {
+    NSUInteger numberOfTests = 10000;
+    [BPStats sharedStats].attemptNumber = 1;
+
+    [self measureBlock:^{
+        SimulatorMonitor *monitor = [[SimulatorMonitor alloc] initWithConfiguration:self.config];
+        for (NSUInteger i = 0; i < numberOfTests; i++) {
+            NSString *testName = [NSString stringWithFormat:@"test%lu", (unsigned long)i];
+            [monitor onTestCaseBeganWithName:testName inClass:@"BPSyntheticTests"];
+            if (i % 10 == 0) {
+                [monitor onTestCaseFailedWithName:testName inClass:@"BPSyntheticTests" inFile:@"BPSyntheticTests.m" onLineNumber:1 wasException:NO];
+            } else {
+                [monitor onTestCasePassedWithName:testName inClass:@"BPSyntheticTests" reportedDuration:0.001];
+            }
+        }
+        XCTAssertEqual(monitor.executedTests.count, numberOfTests);
+    }];
+}
+
+// Benchmark over the log fixtures. "before" replays the per-line work the parser used to do
+// (build and run every regex for every line), "after" runs the lines through the parser.
+- (void)testParserThroughput {
+    NSMutableArray<NSString *> *lines = [[NSMutableArray alloc] init];
+    for (NSString *logPath in [[NSBundle bundleForClass:[self class]] pathsForResourcesOfType:@"log" inDirectory:nil]) {
+        NSString *wholeFile = [NSString stringWithContentsOfFile:logPath encoding:NSUTF8StringEncoding error:nil];
+        [lines addObjectsFromArray:[wholeFile componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]];
+    }
+    XCTAssert(lines.count > 0);
+    NSArray *patterns = @[TEST_SUITE_ENDED, TEST_SUITE_START, TEST_CASE_STARTED, TEST_CASE_FAILED, TEST_CASE_CRASHED,
+                          TEST_CASE_CRASHED2, TEST_CASE_CRASHED3, TEST_CASE_CRASHED4, UITEST_CASE_FAILED, TEST_CASE_PASSED];
+    NSUInteger rounds = 5;
+
+    NSDate *start = [NSDate date];
+    for (NSUInteger i = 0; i < rounds; i++) {
+        @autoreleasepool {
+            for (NSString *line in lines) {
+                for (NSString *pattern in patterns) {
+                    NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:nil];
+                    [regex matchesInString:line options:0 range:NSMakeRange(0, [line length])];
+                }
+            }
+        }
+    }
+    NSTimeInterval before = [[NSDate date] timeIntervalSinceDate:start];
+
+    start = [NSDate date];
+    for (NSUInteger i = 0; i < rounds; i++) {
+        @autoreleasepool {
+            BPTreeParser *parser = [[BPTreeParser alloc] initWithWriter:[self writer]];
+            for (NSString *line in lines) {
+                [parser parseLine:line];
+            }
+        }
+    }
+    NSTimeInterval after = [[NSDate date] timeIntervalSinceDate:start];
+
+    NSUInteger totalLines = lines.count * rounds;
+    XCTAssertGreaterThan(totalLines / after, totalLines / before);
+}
+
 @end
@@ -0,0 +1,112 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPUtils.h"
+#import "BPWriter.h"
+
+@interface BPWriterTests : XCTestCase
+@property (nonatomic, strong) NSString *path;
+@end
+
+@implementation BPWriterTests
+
+- (void)setUp {
+    [super setUp];
+
+    self.path = [BPUtils mkstemp:[NSTemporaryDirectory() stringByAppendingPathComponent:@"writer"] withError:nil];
+    XCTAssertNotNil(self.path);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+
+    [super tearDown];
+}
+
+- (NSString *)contents {
+    return [NSString stringWithContentsOfFile:self.path encoding:NSUTF8StringEncoding error:nil];
+}
+
+- (NSString *)expectedLines:(NSUInteger)count {
+    NSMutableString *lines = [[NSMutableString alloc] init];
+    for (NSUInteger i = 0; i < count; i++) {
+        [lines appendFormat:@"line %lu\n", (unsigned long)i];
+    }
+    return lines;
+}
+
+- (void)writeLines:(NSUInteger)count withWriter:(BPWriter *)writer {
+    for (NSUInteger i = 0; i < count; i++) {
+        [writer writeLine:@"line %lu", (unsigned long)i];
+    }
+}
+
+- (void)testBufferedWritesReachTheFileOnFlush {
+    BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:self.path];
+    [self writeLines:10 withWriter:writer];
+    // Small writes sit in the buffer until they're flushed
+    XCTAssertEqualObjects([self contents], @"");
+
+    [writer flush];
+    XCTAssertEqualObjects([self contents], [self expectedLines:10]);
+    [writer close];
+}
+
+- (void)testBufferedWritesReachTheFileOnTheirOwn {
+    BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:self.path];
+    [self writeLines:10 withWriter:writer];
+
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:5];
+    while (![[self contents] isEqualToString:[self expectedLines:10]] && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.1];
+    }
+    XCTAssertEqualObjects([self contents], [self expectedLines:10]);
+    [writer close];
+}
+
+- (void)testAsynchronousWritesReachTheFileOnFlush {
+    BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:self.path];
+    writer.asynchronous = YES;
+    [self writeLines:1000 withWriter:writer];
+
+    [writer flush];
+    XCTAssertEqualObjects([self contents], [self expectedLines:1000]);
+    [writer close];
+}
+
+- (void)testCloseAfterPendingWrites {
+    BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:self.path];
+    writer.asynchronous = YES;
+    [self writeLines:1000 withWriter:writer];
+    [writer close];
+    XCTAssertEqualObjects([self contents], [self expectedLines:1000]);
+
+    // Writing after close reopens the file for append
+    [writer writeLine:@"line %d", 1000];
+    [writer close];
+    XCTAssertEqualObjects([self contents], [self expectedLines:1001]);
+}
+
+- (void)testReleasingTheWriterKeepsPendingWrites {
+    @autoreleasepool {
+        BPWriter *writer = [[BPWriter alloc] initWithDestination:BPWriterDestinationFile andPath:self.path];
+        writer.asynchronous = YES;
+        [self writeLines:1000 withWriter:writer];
+    }
+    // The last pending write lets go of the writer on its queue, which closes the file
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:5];
+    while (![[self contents] isEqualToString:[self expectedLines:1000]] && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.1];
+    }
+    XCTAssertEqualObjects([self contents], [self expectedLines:1000]);
+}
+
+@end
@@ -0,0 +1,137 @@
+//  Copyright 2016 LinkedIn Corporation
+//  Licensed under the BSD 2-Clause License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at https://opensource.org/licenses/BSD-2-Clause
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "BPConfiguration.h"
+#import "BPExecutionPhaseProtocol.h"
+#import "BPExitStatus.h"
+#import "BPStats.h"
+#import "BPUtils.h"
+#import "SimulatorMonitor.h"
+
+// Records the tests the monitor aborts.
+@interface BPAbortRecorder : NSObject<BPMonitorCallbackProtocol>
+@property (nonatomic, strong) NSMutableArray<NSString *> *abortedTests;
+@property (nonatomic, strong) NSMutableArray<NSString *> *messages;
+@end
+
+@implementation BPAbortRecorder
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        self.abortedTests = [[NSMutableArray alloc] init];
+        self.messages = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)onTestAbortedWithName:(NSString *)testName inClass:(NSString *)testClass errorMessage:(NSString *)message {
+    [self.abortedTests addObject:[NSString stringWithFormat:@"%@/%@", testClass, testName]];
+    [self.messages addObject:message];
+}
+
+@end
+
+@interface SimulatorMonitorTests : XCTestCase
+@property (nonatomic, strong) SimulatorMonitor *monitor;
+@property (nonatomic, strong) BPAbortRecorder *recorder;
+@end
+
+@implementation SimulatorMonitorTests
+
+- (void)setUp {
+    [super setUp];
+
+    [BPUtils quietMode:[BPUtils isBuildScript]];
+    BPConfiguration *config = [BPConfiguration new];
+    config.stuckTimeout = @60;
+    config.testCaseTimeout = @60;
+    config.testing_NoAppWillRun = YES;
+    self.monitor = [[SimulatorMonitor alloc] initWithConfiguration:config];
+    self.monitor.stats = [[BPStats alloc] init];
+    self.monitor.stats.attemptNumber = 1;
+    self.recorder = [[BPAbortRecorder alloc] init];
+    [self.monitor setMonitorCallback:self.recorder];
+    // The timers only stop the tests of a running app
+    self.monitor.appState = Running;
+    [self.monitor onAllTestsBegan];
+}
+
+// The timers fire on the main queue.
+- (void)spinFor:(NSTimeInterval)seconds {
+    CFRunLoopRunInMode(kCFRunLoopDefaultMode, seconds, NO);
+}
+
+- (void)testStuckOutputAbortsTheTest {
+    self.monitor.maxTimeWithNoOutput = 0.5;
+    [self.monitor onTestCaseBeganWithName:@"testStuck" inClass:@"StuckTests"];
+    [self.monitor onOutputReceived:@"Starting"];
+
+    [self spinFor:0.2];
+    XCTAssertEqual(self.recorder.abortedTests.count, 0);
+    [self spinFor:1.0];
+    XCTAssertEqualObjects(self.recorder.abortedTests, @[@"StuckTests/testStuck"]);
+    XCTAssertEqualObjects(self.recorder.messages.firstObject,
+                          @"Timed out waiting for the test to produce output. Test was aborted.");
+    XCTAssertEqual(self.monitor.exitStatus, BPExitStatusTestTimeout);
+}
+
+- (void)testSteadyOutputKeepsTheTestRunning {
+    self.monitor.maxTimeWithNoOutput = 0.5;
+    [self.monitor onTestCaseBeganWithName:@"testChatty" inClass:@"ChattyTests"];
+
+    // Output comes in on its own thread while the timer fires on the main queue.
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    SimulatorMonitor *monitor = self.monitor;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        for (int i = 0; i < 150; i++) {
+            [monitor onOutputReceived:@"Still going"];
+            [NSThread sleepForTimeInterval:0.01];
+        }
+        dispatch_semaphore_signal(done);
+    });
+    while (dispatch_semaphore_wait(done, DISPATCH_TIME_NOW) != 0) {
+        [self spinFor:0.05];
+    }
+    XCTAssertEqual(self.recorder.abortedTests.count, 0);
+
+    // Once the output stops, the timer that was left armed still catches it.
+    [self spinFor:1.0];
+    XCTAssertEqualObjects(self.recorder.abortedTests, @[@"ChattyTests/testChatty"]);
+}
+
+- (void)testSlowTestIsAborted {
+    self.monitor.maxTestExecutionTime = 0.5;
+    [self.monitor onTestCaseBeganWithName:@"testSlow" inClass:@"SlowTests"];
+
+    [self spinFor:0.2];
+    XCTAssertEqual(self.recorder.abortedTests.count, 0);
+    [self spinFor:1.0];
+    XCTAssertEqualObjects(self.recorder.abortedTests, @[@"SlowTests/testSlow"]);
+    XCTAssertEqualObjects(self.recorder.messages.firstObject, @"Test took too long to execute and was aborted.");
+    XCTAssertEqual(self.monitor.exitStatus, BPExitStatusTestTimeout);
+}
+
+- (void)testNextTestGetsItsOwnDeadline {
+    self.monitor.maxTestExecutionTime = 0.6;
+    [self.monitor onTestCaseBeganWithName:@"testFirst" inClass:@"SlowTests"];
+    [self spinFor:0.4];
+    [self.monitor onTestCasePassedWithName:@"testFirst" inClass:@"SlowTests" reportedDuration:0.4];
+    [self.monitor onTestCaseBeganWithName:@"testSecond" inClass:@"SlowTests"];
+
+    // The first test's deadline goes by without aborting the second one.
+    [self spinFor:0.4];
+    XCTAssertEqual(self.recorder.abortedTests.count, 0);
+    [self spinFor:1.0];
+    XCTAssertEqualObjects(self.recorder.abortedTests, @[@"SlowTests/testSecond"]);
+}
+
+@end